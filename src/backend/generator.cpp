@@ -15,44 +15,53 @@
     rkx -- trash register
 */
 
-static Function_table* FUNCS   = nullptr;
-static Variable_table* LOCALS  = nullptr;
-static Variable_table* GLOBALS = nullptr;
+// State of single generation, passed through all emitters
+struct Generator_context
+{
+    Tree*           tree    = nullptr;
+    Function_table* funcs   = nullptr;
+    Variable_table* locals  = nullptr;
+    Variable_table* globals = nullptr;
+
+    FILE* ostream = nullptr;
 
-static FILE* OSTREAM = nullptr;
+    int indentation = 0;
 
-static generator_err IS_ERROR = GENERATOR_NOERR;
+    generator_err is_error = GENERATOR_NOERR;
+};
 
-#define semantic_error(MSG_, TOK_)                                                      \
+#define semantic_error(MSG_, NODE_)                                                     \
 do                                                                                      \
 {                                                                                       \
-    IS_ERROR = GENERATOR_SEMANTIC_ERROR;                                                \
-    fprintf(stderr, "\x1b[31mSemantic error:\x1b[0m %s : %s\n", (MSG_), std_demangle(TOK_));\
+    ctx->is_error = GENERATOR_SEMANTIC_ERROR;                                           \
+    Token tok_ = node_token(ctx->tree, (NODE_));                                        \
+    fprintf(stderr, "\x1b[31mSemantic error:\x1b[0m %s : %s\n", (MSG_), std_demangle(&tok_));\
     FILE* stream_ = dumpsystem_get_opened_stream();                                     \
                                                                                         \
     if(stream_)                                                                         \
     {                                                                                   \
         fprintf(stream_, "<span class = \"error\">Semantic error: %s : %s\n</span>"     \
                          "\t\t\t\tat %s:%d:%s\n",                                       \
-                         (MSG_), std_demangle(TOK_),                                        \
+                         (MSG_), std_demangle(&tok_),                                        \
                          __FILE__, __LINE__, __PRETTY_FUNCTION__);                      \
                                                                                         \
         return GENERATOR_NOERR;                                                         \
     }                                                                                   \
 } while(0)                                                                              \
 
-#define format_error(MSG_, TOK_)                                                        \
+#define format_error(MSG_, NODE_)                                                       \
 do                                                                                      \
 {                                                                                       \
-    IS_ERROR = GENERATOR_FORMAT_ERROR;                                                  \
-    fprintf(stderr, "\x1b[31mFormat error:\x1b[0m %s : %s\n", (MSG_), std_demangle(TOK_));  \
+    ctx->is_error = GENERATOR_FORMAT_ERROR;                                             \
+    Token tok_ = node_token(ctx->tree, (NODE_));                                        \
+    fprintf(stderr, "\x1b[31mFormat error:\x1b[0m %s : %s\n", (MSG_), std_demangle(&tok_));  \
     FILE* stream_ = dumpsystem_get_opened_stream();                                     \
                                                                                         \
     if(stream_)                                                                         \
     {                                                                                   \
         fprintf(stream_, "<span class = \"error\">Format error: %s : %s\n</span>"       \
                          "\t\t\t\tat %s : %d : %s\n",                                   \
-                         (MSG_), std_demangle(TOK_),                                        \
+                         (MSG_), std_demangle(&tok_),                                        \
                          __FILE__, __LINE__, __PRETTY_FUNCTION__);                      \
                                                                                         \
         return GENERATOR_NOERR;                                                         \
@@ -61,40 +70,38 @@ do
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-static int INDENTATION = 0;
-
-#define print_tab(fmt, ...) fprintf(OSTREAM, "%*s" fmt, INDENTATION * 4, "", ##__VA_ARGS__)
-#define print(fmt, ...)     fprintf(OSTREAM, fmt, ##__VA_ARGS__)
+#define print_tab(fmt, ...) fprintf(ctx->ostream, "%*s" fmt, ctx->indentation * 4, "", ##__VA_ARGS__)
+#define print(fmt, ...)     fprintf(ctx->ostream, fmt, ##__VA_ARGS__)
 
-static generator_err expression(Node* node);
-static generator_err statement(Node* node);
+static generator_err expression(Generator_context* ctx, Node* node);
+static generator_err statement(Generator_context* ctx, Node* node);
 
-static generator_err number(Node* node)
+static generator_err number(Generator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_NUMBER);
+    assert(node_type(node) == TYPE_NUMBER);
 
-    if(node->left || node->right)
-        format_error("Number has descendants", &node->tok);
+    if(node_left(node) || node_right(node))
+        format_error("Number has descendants", node);
 
-    print_tab("push %lg\n", node->tok.val.num);
+    print_tab("push %lg\n", node_num(ctx->tree, node));
 
     return GENERATOR_NOERR;
 }
 
-static generator_err variable(Node* node)
+static generator_err variable(Generator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_ID);
+    assert(node_type(node) == TYPE_ID);
 
-    if(node->left)
-        semantic_error("Variable has 'const' specifier in expression", &node->tok);
+    if(node_left(node))
+        semantic_error("Variable has 'const' specifier in expression", node);
     
     Variable* var = 0;
 
-    if(node->right)
+    if(node_right(node))
     {
-        PASS$(!expression(node->right), return GENERATOR_PASS_ERROR; );
+        PASS$(!expression(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
         
         print_tab("pop rex\n");
         print_tab("push [rex + ");
@@ -104,36 +111,36 @@ static generator_err variable(Node* node)
         print_tab("push [");
     }
 
-    if((var = vartable_find(GLOBALS, node->tok.val.name)) != nullptr)
+    if((var = vartable_find(ctx->globals, node_name(ctx->tree, node))) != nullptr)
     {
         print("rcx + %ld]\n", var->offset);
     }
-    else if((var = vartable_find(LOCALS, node->tok.val.name)) != nullptr)
+    else if((var = vartable_find(ctx->locals, node_name(ctx->tree, node))) != nullptr)
     {
         print("rbx + %ld]\n", var->offset);
     }
     else
     {
-        semantic_error("Variable wasn't declared", &node->tok);
+        semantic_error("Variable wasn't declared", node);
     }
 
     return GENERATOR_NOERR;
 }
 
-static generator_err embedded(Node* node)
+static generator_err embedded(Generator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_EMBED);
+    assert(node_type(node) == TYPE_EMBED);
 
 
-    switch(node->tok.val.emb)
+    switch(node_emb(node))
     {
         case TOK_SIN:
         {
-            if(!node->right || node->left)
-                format_error("Embedded 'sin' requires 1 argument", &node->tok);
+            if(!node_right(node) || node_left(node))
+                format_error("Embedded 'sin' requires 1 argument", node);
 
-            PASS$(!expression(node->right), return GENERATOR_PASS_ERROR; );
+            PASS$(!expression(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
 
             print_tab("pop rex\n");
             print_tab("sin rex\n");
@@ -141,10 +148,10 @@ static generator_err embedded(Node* node)
         }
         case TOK_COS:
         {
-            if(!node->right || node->left)
-                format_error("Embedded 'cos' requires 1 argument", &node->tok);
+            if(!node_right(node) || node_left(node))
+                format_error("Embedded 'cos' requires 1 argument", node);
 
-            PASS$(!expression(node->right), return GENERATOR_PASS_ERROR; );
+            PASS$(!expression(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
 
             print_tab("pop rex\n");
             print_tab("cos rex\n");
@@ -152,10 +159,10 @@ static generator_err embedded(Node* node)
         }
         case TOK_PRINT:
         {
-            if(!node->right)
-                format_error("Embedded 'print' requires 1 argument", &node->tok);
+            if(!node_right(node))
+                format_error("Embedded 'print' requires 1 argument", node);
 
-            PASS$(!expression(node->right), return GENERATOR_PASS_ERROR; );
+            PASS$(!expression(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
 
             print_tab("out\n");
 
@@ -164,27 +171,27 @@ static generator_err embedded(Node* node)
         }
         case TOK_SCAN:
         {
-            if(node->right || node->left)
-                format_error("Embedded 'scan' cannot has arguments", &node->tok);
+            if(node_right(node) || node_left(node))
+                format_error("Embedded 'scan' cannot has arguments", node);
 
             print_tab("in\n");
             break;
         }
         case TOK_SHOW:
         {
-            if(!node->right || !node->left)
-                format_error("Embedded 'show' requires 2 arguments", &node->tok);
+            if(!node_right(node) || !node_left(node))
+                format_error("Embedded 'show' requires 2 arguments", node);
             
             print("\n");
 
-            if(node->left->tok.type != TYPE_ID)
-                format_error("Embedded 'show' requires variable as first argument", &node->left->tok);
+            if(node_type(node_left(node)) != TYPE_ID)
+                format_error("Embedded 'show' requires variable as first argument", node_left(node));
 
             Variable* var = {};
 
-            if(node->left->right)
+            if(node_right(node_left(node)))
             {
-                PASS$(!expression(node->left->right), return GENERATOR_PASS_ERROR; );
+                PASS$(!expression(ctx, node_right(node_left(node))), return GENERATOR_PASS_ERROR; );
                 
                 print_tab("pop rex\n");
                 print_tab("push rex + ");
@@ -194,20 +201,20 @@ static generator_err embedded(Node* node)
                 print_tab("push ");
             }
 
-            if((var = vartable_find(GLOBALS, node->left->tok.val.name)) != nullptr)
+            if((var = vartable_find(ctx->globals, node_name(ctx->tree, node_left(node)))) != nullptr)
             {
                 print("rcx + %ld\n", var->offset);
             }
-            else if((var = vartable_find(LOCALS, node->left->tok.val.name)) != nullptr)
+            else if((var = vartable_find(ctx->locals, node_name(ctx->tree, node_left(node)))) != nullptr)
             {
                 print("rbx + %ld\n", var->offset);
             }
             else
             {
-                semantic_error("Variable wasn't declared", &node->tok);
+                semantic_error("Variable wasn't declared", node);
             }
 
-            PASS$(!expression(node->right), return GENERATOR_PASS_ERROR; );
+            PASS$(!expression(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
 
             print_tab("pop rfx\n");
             print_tab("pop rex\n");
@@ -219,10 +226,10 @@ static generator_err embedded(Node* node)
         }
         case TOK_INT:
         {
-            if(!node->right || node->left)
-                format_error("Embedded 'int' requires 1 argument", &node->tok);
+            if(!node_right(node) || node_left(node))
+                format_error("Embedded 'int' requires 1 argument", node);
 
-            PASS$(!expression(node->right), return GENERATOR_PASS_ERROR; );
+            PASS$(!expression(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
 
             print_tab("pop rex\n");
             print_tab("int rex\n");
@@ -238,23 +245,23 @@ static generator_err embedded(Node* node)
 }
 
 #define PRINT_CMD(MANGLE, TXT)                                        \
-    if(node->tok.val.op == TOK_##MANGLE)                              \
+    if(node_op(node) == TOK_##MANGLE)                              \
     {                                                                 \
-        if(!node->left || !node->right)                               \
-            format_error("Operator wrong descendants", &node->tok);   \
+        if(!node_left(node) || !node_right(node))                               \
+            format_error("Operator wrong descendants", node);   \
         print_tab("%s\n", (TXT));                                     \
     }                                                                 \
     else                                                              \
     
-static generator_err oper(Node* node)
+static generator_err oper(Generator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_OP);
+    assert(node_type(node) == TYPE_OP);
 
-    if(node->tok.val.op == TOK_NOT)
+    if(node_op(node) == TOK_NOT)
     {
-        if(node->left || !node->right)
-            format_error("Operator wrong descendants", &node->tok);
+        if(node_left(node) || !node_right(node))
+            format_error("Operator wrong descendants", node);
         print_tab("push 0\n");
         print_tab("eq\n");
     }
@@ -270,76 +277,74 @@ static generator_err oper(Node* node)
     PRINT_CMD(LESS,  "le")
     PRINT_CMD(LEQ,   "leq")
     PRINT_CMD(GEQ,   "geq")
-    PRINT_CMD(AND,   "and")
-    PRINT_CMD(OR,    "or")
     /* else */
-        format_error("Unknown operator", &node->tok);
+        format_error("Unknown operator", node);
 
     return GENERATOR_NOERR;
 }
 #undef PRINT_CMD
 
-static generator_err call_parameter(Node* node, ptrdiff_t n_args)
+static generator_err call_parameter(Generator_context* ctx, Node* node, ptrdiff_t n_args)
 {
     assert(node);
-    assert(node->tok.type == TYPE_AUX && node->tok.val.aux == TOK_PARAMETER);
+    assert(node_type(node) == TYPE_AUX && node_aux(node) == TOK_PARAMETER);
 
     n_args--;
 
-    if((n_args > 0 && !node->left) || (n_args == 0 && node->left))
-        semantic_error("Wrong amount of arguments", &node->tok);
+    if((n_args > 0 && !node_left(node)) || (n_args == 0 && node_left(node)))
+        semantic_error("Wrong amount of arguments", node);
 
-    if(node->left)
-        PASS$(!call_parameter(node->left, n_args), return GENERATOR_PASS_ERROR; );
+    if(node_left(node))
+        PASS$(!call_parameter(ctx, node_left(node), n_args), return GENERATOR_PASS_ERROR; );
 
-    if(!node->right)
-        format_error("Missing argument", &node->right->tok);
+    if(!node_right(node))
+        format_error("Missing argument", node_right(node));
     
-    PASS$(!expression(node->right), return GENERATOR_PASS_ERROR; );
+    PASS$(!expression(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
 
-    print_tab("pop [rbx + %ld]\n", vartable_end(LOCALS));
+    print_tab("pop [rbx + %ld]\n", vartable_end(ctx->locals));
 
     Variable call_var = {};
     call_var.id = CALL_VARIABLE;
-    PASS$(!vartable_add(LOCALS, call_var), return GENERATOR_PASS_ERROR; );
+    PASS$(!vartable_add(ctx->locals, call_var), return GENERATOR_PASS_ERROR; );
 
     return GENERATOR_NOERR;
 }
 
-static generator_err call(Node* node)
+static generator_err call(Generator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_AUX && node->tok.val.aux == TOK_CALL);
+    assert(node_type(node) == TYPE_AUX && node_aux(node) == TOK_CALL);
 
-    if(node->left->tok.type != TYPE_ID)
-        format_error("Left descendant of call is not function", &node->left->tok);
+    if(node_type(node_left(node)) != TYPE_ID)
+        format_error("Left descendant of call is not function", node_left(node));
 
-    Function* func = functable_find(FUNCS, node->left->tok.val.name);
+    Function* func = functable_find(ctx->funcs, node_name(ctx->tree, node_left(node)));
     if(!func)
-        semantic_error("Function wasn't defined", &node->left->tok);
+        semantic_error("Function wasn't defined", node_left(node));
     
     if(strcmp(MAIN_STD_NAME, func->id) == 0)
-        semantic_error("'main' can't be called", &node->left->tok);
+        semantic_error("'main' can't be called", node_left(node));
     
     print("\n");
     
-    ptrdiff_t call_offset = vartable_end(LOCALS);
-    if((func->n_args == 0 && node->right) || (func->n_args > 0 && !node->right))
-        semantic_error("Wrong amount of arguments", &node->left->tok);
+    ptrdiff_t call_offset = vartable_end(ctx->locals);
+    if((func->n_args == 0 && node_right(node)) || (func->n_args > 0 && !node_right(node)))
+        semantic_error("Wrong amount of arguments", node_left(node));
     
-    INDENTATION++;
+    ctx->indentation++;
 
-    if(node->right)
-        PASS$(!call_parameter(node->right, func->n_args), return GENERATOR_PASS_ERROR; );
+    if(node_right(node))
+        PASS$(!call_parameter(ctx, node_right(node), func->n_args), return GENERATOR_PASS_ERROR; );
     
-    INDENTATION--;
+    ctx->indentation--;
 
     print_tab("push rbx\n");
     print_tab("push %ld\n", call_offset);
     print_tab("add\n");
     print_tab("pop rbx\n");
 
-    char* func_name = node->left->tok.val.name;
+    char* func_name = node_name(ctx->tree, node_left(node));
     print_tab("call func__%lx\n", fnv1_64(func_name, strlen(func_name)));
 
     print_tab("push rbx\n");
@@ -349,124 +354,175 @@ static generator_err call(Node* node)
 
     print_tab("push rax\n\n");
 
-    LOCALS->size -= func->n_args;
+    ctx->locals->size -= func->n_args;
 
     return GENERATOR_NOERR;
 }
 
-static generator_err expression(Node* node)
+// Right operand is evaluated only if left one doesn't decide the result
+static generator_err logical(Generator_context* ctx, Node* node)
 {
     assert(node);
+    assert(node_type(node) == TYPE_OP);
+
+    if(!node_left(node) || !node_right(node))
+        format_error("Operator wrong descendants", node);
+
+    const char* name = (node_op(node) == TOK_AND) ? "and" : "or";
+
+    PASS$(!expression(ctx, node_left(node)), return GENERATOR_PASS_ERROR; );
+
+    print_tab("push 0\n");
+
+    if(node_op(node) == TOK_AND)
+    {
+        print_tab("je %s_short__0x%p\n", name, node);
+    }
+    else
+    {
+        print_tab("je %s_rhs__0x%p\n", name, node);
+        print_tab("push 1\n");
+        print_tab("jmp %s_end__0x%p\n", name, node);
+        print("%s_rhs__0x%p:\n", name, node);
+    }
 
-    if(node->tok.type == TYPE_NUMBER)
+    PASS$(!expression(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
+
+    print_tab("push 0\n");
+    print_tab("neq\n");
+
+    if(node_op(node) == TOK_AND)
     {
-        PASS$(!number(node), return GENERATOR_PASS_ERROR; );
+        print_tab("jmp %s_end__0x%p\n", name, node);
+        print("%s_short__0x%p:\n", name, node);
+        print_tab("push 0\n");
+    }
+
+    print("%s_end__0x%p:\n", name, node);
+
+    return GENERATOR_NOERR;
+}
+
+static generator_err expression(Generator_context* ctx, Node* node)
+{
+    assert(node);
+
+    if(node_type(node) == TYPE_NUMBER)
+    {
+        PASS$(!number(ctx, node), return GENERATOR_PASS_ERROR; );
         return GENERATOR_NOERR;
     }
     
-    if(node->tok.type == TYPE_ID)
+    if(node_type(node) == TYPE_ID)
+    {
+        PASS$(!variable(ctx, node), return GENERATOR_PASS_ERROR; );
+        return GENERATOR_NOERR;
+    }
+
+    if(node_type(node) == TYPE_EMBED)
     {
-        PASS$(!variable(node), return GENERATOR_PASS_ERROR; );
+        PASS$(!embedded(ctx, node), return GENERATOR_PASS_ERROR; );
         return GENERATOR_NOERR;
     }
 
-    if(node->tok.type == TYPE_EMBED)
+    if(node_type(node) == TYPE_AUX && node_aux(node) == TOK_CALL)
     {
-        PASS$(!embedded(node), return GENERATOR_PASS_ERROR; );
+        PASS$(!call(ctx, node), return GENERATOR_PASS_ERROR; );
         return GENERATOR_NOERR;
     }
 
-    if(node->tok.type == TYPE_AUX && node->tok.val.aux == TOK_CALL)
+    if(node_type(node) == TYPE_OP && (node_op(node) == TOK_AND || node_op(node) == TOK_OR))
     {
-        PASS$(!call(node), return GENERATOR_PASS_ERROR; );
+        PASS$(!logical(ctx, node), return GENERATOR_PASS_ERROR; );
         return GENERATOR_NOERR;
     }
 
-    if(node->left)
-        PASS$(!expression(node->left), return GENERATOR_PASS_ERROR; );
+    if(node_left(node))
+        PASS$(!expression(ctx, node_left(node)), return GENERATOR_PASS_ERROR; );
 
-    if(node->right)
-        PASS$(!expression(node->right), return GENERATOR_PASS_ERROR; );
+    if(node_right(node))
+        PASS$(!expression(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
         
-    if(node->tok.type == TYPE_OP)
+    if(node_type(node) == TYPE_OP)
     {
-        PASS$(!oper(node), return GENERATOR_PASS_ERROR; );
+        PASS$(!oper(ctx, node), return GENERATOR_PASS_ERROR; );
         return GENERATOR_NOERR;
     }
         
-    semantic_error("Token can't be used in expression", &node->tok);
+    semantic_error("Token can't be used in expression", node);
 
     return GENERATOR_NOERR;
 }
 
-static generator_err conditional(Node* node)
+static generator_err conditional(Generator_context* ctx, Node* node)
 {
     assert(node);
-    if(!node->left || !node->right || node->right->tok.type != TYPE_AUX || node->right->tok.val.aux != TOK_DECISION)
-        format_error("Conditional statement missing or wrong descendant", &node->tok);
+    if(!node_left(node) || !node_right(node) ||
+       node_type(node_right(node)) != TYPE_AUX || node_aux(node_right(node)) != TOK_DECISION)
+        format_error("Conditional statement missing or wrong descendant", node);
 
-    INDENTATION++;
+    ctx->indentation++;
 
     print("\n");
-    PASS$(!expression(node->left), return GENERATOR_PASS_ERROR; );
+    PASS$(!expression(ctx, node_left(node)), return GENERATOR_PASS_ERROR; );
     
     print_tab("push 0\n");
     print_tab("je if_false__0x%p\n", node);
 
-    if(!node->right->left)
-        semantic_error("Conditional statement missing positive branch (no body statements)", &node->tok);
+    if(!node_left(node_right(node)))
+        semantic_error("Conditional statement missing positive branch (no body statements)", node);
 
-    PASS$(!statement(node->right->left), return GENERATOR_PASS_ERROR; );
+    PASS$(!statement(ctx, node_left(node_right(node))), return GENERATOR_PASS_ERROR; );
 
     print_tab("jmp if_end__0x%p\n", node);
     print("if_false__0x%p:\n", node);
 
-    if(node->right->right)
-        PASS$(!statement(node->right->right), return GENERATOR_PASS_ERROR; );
+    if(node_right(node_right(node)))
+        PASS$(!statement(ctx, node_right(node_right(node))), return GENERATOR_PASS_ERROR; );
 
     print("if_end__0x%p:\n\n", node);
 
-    INDENTATION--;
+    ctx->indentation--;
 
     return GENERATOR_NOERR;
 }
 
-static generator_err cycle(Node* node)
+static generator_err cycle(Generator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_KEYWORD && node->tok.val.key == TOK_WHILE);
+    assert(node_type(node) == TYPE_KEYWORD && node_key(node) == TOK_WHILE);
 
-    if(!node->left || !node->right)
-        format_error("Cycle statement missing or wrong descendant", &node->tok);
+    if(!node_left(node) || !node_right(node))
+        format_error("Cycle statement missing or wrong descendant", node);
 
-    INDENTATION++;
+    ctx->indentation++;
 
     print("\nwhile__0x%p:\n", node);
     
-    PASS$(!expression(node->left), return GENERATOR_PASS_ERROR; );
+    PASS$(!expression(ctx, node_left(node)), return GENERATOR_PASS_ERROR; );
 
     print_tab("push 0\n");
     print_tab("je while_end__0x%p\n\n", node);
 
-    PASS$(!statement(node->right), return GENERATOR_PASS_ERROR; );
+    PASS$(!statement(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
 
     print_tab("jmp while__0x%p\n", node);
     print("while_end__0x%p:\n\n", node);
 
-    INDENTATION--;
+    ctx->indentation--;
 
     return GENERATOR_NOERR;
 }
 
-static generator_err terminational(Node* node)
+static generator_err terminational(Generator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_KEYWORD && node->tok.val.key == TOK_RETURN);
+    assert(node_type(node) == TYPE_KEYWORD && node_key(node) == TOK_RETURN);
 
-    if(node->left || !node->right)
-        format_error("Terminational statement missing or wrong descendant", &node->tok);
+    if(node_left(node) || !node_right(node))
+        format_error("Terminational statement missing or wrong descendant", node);
 
-    PASS$(!expression(node->right), return GENERATOR_PASS_ERROR; );
+    PASS$(!expression(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
 
     print_tab("pop rax\n");
 
@@ -475,80 +531,80 @@ static generator_err terminational(Node* node)
     return GENERATOR_NOERR;
 }
 
-static generator_err assignment(Node* node, Variable_table* vartable)
+static generator_err assignment(Generator_context* ctx, Node* node, Variable_table* vartable)
 {
     assert(node && vartable);
-    assert(node->tok.type == TYPE_OP && node->tok.val.op == TOK_ASSIGN);
+    assert(node_type(node) == TYPE_OP && node_op(node) == TOK_ASSIGN);
 
-    PASS$(!expression(node->right), return GENERATOR_PASS_ERROR; );
+    PASS$(!expression(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
 
-    if(!node->left)
-        format_error("Assignment requires lvalue", &node->tok);
+    if(!node_left(node))
+        format_error("Assignment requires lvalue", node);
 
-    if(node->left->tok.type != TYPE_ID)
-        format_error("Assignment requires identifier as lvalue", &node->left->tok);
+    if(node_type(node_left(node)) != TYPE_ID)
+        format_error("Assignment requires identifier as lvalue", node_left(node));
 
     Variable var = {};
     ptrdiff_t shift = 0;
     bool is_global = false;
 
-    if(node->left->left)
+    if(node_left(node_left(node)))
     {
-        if(node->left->left->tok.type != TYPE_KEYWORD || node->left->left->tok.val.key != TOK_CONST)
-            format_error("Variable has wrong left descendant ('const' expected)", &node->left->left->tok);
+        if(node_type(node_left(node_left(node))) != TYPE_KEYWORD || node_key(node_left(node_left(node))) != TOK_CONST)
+            format_error("Variable has wrong left descendant ('const' expected)", node_left(node_left(node)));
 
         var.is_const = true;          
     }
     
     Variable* ptr = nullptr;
 
-    if((ptr = vartable_find(GLOBALS, node->left->tok.val.name)) != nullptr)
+    if((ptr = vartable_find(ctx->globals, node_name(ctx->tree, node_left(node)))) != nullptr)
     {
         is_global = true;
     }
-    else if((ptr = vartable_find(LOCALS, node->left->tok.val.name)) != nullptr)
+    else if((ptr = vartable_find(ctx->locals, node_name(ctx->tree, node_left(node)))) != nullptr)
     {
         is_global = false;
     }
     else
     {
-        if(functable_find(FUNCS, node->left->tok.val.name) != nullptr)
-            semantic_error("Cannot declare variable with function name", &node->left->tok);
+        if(functable_find(ctx->funcs, node_name(ctx->tree, node_left(node))) != nullptr)
+            semantic_error("Cannot declare variable with function name", node_left(node));
         
-        if(node->left->right)
+        if(node_right(node_left(node)))
         {
-            if(node->left->right->tok.type != TYPE_NUMBER)
-                semantic_error("Size of variable is not compile-time evaluatable", &node->left->tok);
+            if(node_type(node_right(node_left(node))) != TYPE_NUMBER)
+                semantic_error("Size of variable is not compile-time evaluatable", node_left(node));
 
-            shift = (ptrdiff_t) node->left->right->tok.val.num;
+            shift = (ptrdiff_t) node_num(ctx->tree, node_right(node_left(node)));
         }
 
         if(shift < 0)
-            semantic_error("Size of variable is negative", &node->left->tok);
+            semantic_error("Size of variable is negative", node_left(node));
 
         var.size   = shift + 1;
-        var.id     = node->left->tok.val.name;
+        var.id     = node_name(ctx->tree, node_left(node));
         var.offset = vartable_end(vartable);
 
         PASS$(!vartable_add(vartable, var), return GENERATOR_PASS_ERROR; );
 
-        if(vartable == LOCALS)
+        if(vartable == ctx->locals)
             print_tab("pop [rbx + %ld]\n", var.offset + shift);
-        else if(vartable == GLOBALS)
+        else if(vartable == ctx->globals)
             print_tab("pop [rcx + %ld]\n", var.offset + shift);
         
         return GENERATOR_NOERR;
     }
 
     if(var.is_const)
-        semantic_error("'const' specifier in assignment to declared variable", &node->left->tok);
+        semantic_error("'const' specifier in assignment to declared variable", node_left(node));
     
     if(ptr->is_const)
-        semantic_error("Assignment to 'const' variable", &node->left->tok);
+        semantic_error("Assignment to 'const' variable", node_left(node));
         
-    if(node->left->right)
+    if(node_right(node_left(node)))
     {
-        PASS$(!expression(node->left->right), return GENERATOR_PASS_ERROR; );
+        PASS$(!expression(ctx, node_right(node_left(node))), return GENERATOR_PASS_ERROR; );
         print_tab("pop rex\n");
 
         print_tab("pop [rex + ");
@@ -570,195 +626,197 @@ static generator_err assignment(Node* node, Variable_table* vartable)
     return GENERATOR_NOERR;
 }
 
-static generator_err statement(Node* node)
+static generator_err statement(Generator_context* ctx, Node* node)
 {
     assert(node);
 
-    if(node->tok.type != TYPE_AUX || node->tok.val.aux != TOK_STATEMENT)
-        format_error("'statement' expected", &node->tok);
+    if(node_type(node) != TYPE_AUX || node_aux(node) != TOK_STATEMENT)
+        format_error("'statement' expected", node);
 
-    if(node->left)
-        PASS$(!statement(node->left), return GENERATOR_PASS_ERROR; );
+    if(node_left(node))
+        PASS$(!statement(ctx, node_left(node)), return GENERATOR_PASS_ERROR; );
 
-    if(node->right->tok.type == TYPE_KEYWORD)
+    if(node_type(node_right(node)) == TYPE_KEYWORD)
     {
-        if(node->right->tok.val.key == TOK_IF)
+        if(node_key(node_right(node)) == TOK_IF)
         {
-            PASS$(!conditional(node->right), return GENERATOR_PASS_ERROR; );
+            PASS$(!conditional(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
             return GENERATOR_NOERR;
         }
-        else if(node->right->tok.val.key == TOK_WHILE)
+        else if(node_key(node_right(node)) == TOK_WHILE)
         {
-            PASS$(!cycle(node->right), return GENERATOR_PASS_ERROR; );
+            PASS$(!cycle(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
             return GENERATOR_NOERR;
         }
-        else if(node->right->tok.val.key == TOK_RETURN)
+        else if(node_key(node_right(node)) == TOK_RETURN)
         {
-            PASS$(!terminational(node->right), return GENERATOR_PASS_ERROR; );
+            PASS$(!terminational(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
             return GENERATOR_NOERR;
         }
     }
 
-    if(node->right->tok.type == TYPE_OP && node->right->tok.val.op == TOK_ASSIGN)
+    if(node_type(node_right(node)) == TYPE_OP && node_op(node_right(node)) == TOK_ASSIGN)
     {
-        PASS$(!assignment(node->right, LOCALS), return GENERATOR_PASS_ERROR; );
+        PASS$(!assignment(ctx, node_right(node), ctx->locals), return GENERATOR_PASS_ERROR; );
         return GENERATOR_NOERR;
     }
 
-    PASS$(!expression(node->right), return GENERATOR_PASS_ERROR; );
+    PASS$(!expression(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
     print_tab("pop rkx\n");
 
     return GENERATOR_NOERR;
 }
 
-static generator_err parameter(Node* node)
+static generator_err parameter(Generator_context* ctx, Node* node)
 {
     assert(node);
     
-    if(node->tok.type != TYPE_AUX || node->tok.val.aux != TOK_PARAMETER)
-        format_error("'parameter' expected", &node->tok);
+    if(node_type(node) != TYPE_AUX || node_aux(node) != TOK_PARAMETER)
+        format_error("'parameter' expected", node);
 
-    if(node->left)
-        PASS$(!parameter(node->left), return GENERATOR_PASS_ERROR; );
+    if(node_left(node))
+        PASS$(!parameter(ctx, node_left(node)), return GENERATOR_PASS_ERROR; );
     
-    if(node->right->tok.type != TYPE_ID)
-        format_error("Parameter is not id", &node->right->tok);
+    if(node_type(node_right(node)) != TYPE_ID)
+        format_error("Parameter is not id", node_right(node));
 
     Variable var = {};
-    var.id = node->right->tok.val.name;
+    var.id = node_name(ctx->tree, node_right(node));
 
-    if(node->right->right)
-        format_error("Parameter cannot be array", &node->right->tok);
+    if(node_right(node_right(node)))
+        format_error("Parameter cannot be array", node_right(node));
     
     var.size = 1;
 
-    if(node->right->left)
+    if(node_left(node_right(node)))
     {
-        if(node->right->left->tok.type != TYPE_KEYWORD || node->right->left->tok.val.key != TOK_CONST)
-            format_error("Variable has wrong left descendant ('const' expected)", &node->right->tok);
+        if(node_type(node_left(node_right(node))) != TYPE_KEYWORD ||
+           node_key(node_left(node_right(node))) != TOK_CONST)
+            format_error("Variable has wrong left descendant ('const' expected)", node_right(node));
         
         var.is_const = true;
     }
 
-    if(vartable_find(LOCALS, var.id) || vartable_find(GLOBALS, var.id) || functable_find(FUNCS, var.id))
-        semantic_error("Variable redeclaration", &node->right->tok);
+    if(vartable_find(ctx->locals, var.id) ||
+       vartable_find(ctx->globals, var.id) || functable_find(ctx->funcs, var.id))
+        semantic_error("Variable redeclaration", node_right(node));
 
-    PASS$(!vartable_add(LOCALS, var), return GENERATOR_PASS_ERROR; );
+    PASS$(!vartable_add(ctx->locals, var), return GENERATOR_PASS_ERROR; );
 
     return GENERATOR_NOERR;
 }
 
-static generator_err fill_funcs_table(Node* node)
+static generator_err fill_funcs_table(Generator_context* ctx, Node* node)
 {
     assert(node);
 
-    if(node->left)
-        PASS$(!fill_funcs_table(node->left), return GENERATOR_PASS_ERROR; );
+    if(node_left(node))
+        PASS$(!fill_funcs_table(ctx, node_left(node)), return GENERATOR_PASS_ERROR; );
     
-    if(node->tok.type != TYPE_AUX || node->tok.val.aux != TOK_STATEMENT)
-        format_error("'statement' expected (first line)", &node->tok);
+    if(node_type(node) != TYPE_AUX || node_aux(node) != TOK_STATEMENT)
+        format_error("'statement' expected (first line)", node);
     
-    if(!node->right)
-        format_error("Missing 'statement' body (first line)", &node->tok);
+    if(!node_right(node))
+        format_error("Missing 'statement' body (first line)", node);
 
-    if(node->right->tok.type == TYPE_OP && node->right->tok.val.op == TOK_ASSIGN)
+    if(node_type(node_right(node)) == TYPE_OP && node_op(node_right(node)) == TOK_ASSIGN)
         return GENERATOR_NOERR;
 
-    if(node->right->tok.type != TYPE_AUX || node->right->tok.val.aux != TOK_DEFINE)
-        format_error("'define' expected", &node->right->tok);
+    if(node_type(node_right(node)) != TYPE_AUX || node_aux(node_right(node)) != TOK_DEFINE)
+        format_error("'define' expected", node_right(node));
     
-    if(!node->right->left)
-        format_error("'define' missing 'function'", &node->right->tok);
+    if(!node_left(node_right(node)))
+        format_error("'define' missing 'function'", node_right(node));
 
-    if(node->right->left->tok.type != TYPE_AUX || node->right->left->tok.val.aux != TOK_FUNCTION)
-        format_error("'function' expected", &node->right->left->tok);
+    if(node_type(node_left(node_right(node))) != TYPE_AUX || node_aux(node_left(node_right(node))) != TOK_FUNCTION)
+        format_error("'function' expected", node_left(node_right(node)));
 
     Function func = {};
     
-    Node* ptr = node->right->left->right;
+    Node* ptr = node_right(node_left(node_right(node)));
 
     while(ptr)
     {
-        if(ptr->tok.type != TYPE_AUX || ptr->tok.val.aux != TOK_PARAMETER)
-            format_error("'parameter' expected", &ptr->tok);
+        if(node_type(ptr) != TYPE_AUX || node_aux(ptr) != TOK_PARAMETER)
+            format_error("'parameter' expected", ptr);
         
         func.n_args++;
 
-        ptr = ptr->left;
+        ptr = node_left(ptr);
     }
 
-    ptr = node->right->left->left;
+    ptr = node_left(node_left(node_right(node)));
     if(!ptr)
-        format_error("Function name is missing", &node->right->left->tok);
+        format_error("Function name is missing", node_left(node_right(node)));
 
-    if(ptr->tok.type != TYPE_ID)
-        format_error("Function name is not identifier", &ptr->tok);
+    if(node_type(ptr) != TYPE_ID)
+        format_error("Function name is not identifier", ptr);
     
-    func.id = ptr->tok.val.name;
+    func.id = node_name(ctx->tree, ptr);
         
-    if(functable_find(FUNCS, func.id) != nullptr)
-        semantic_error("Function redefinition", &ptr->tok);
+    if(functable_find(ctx->funcs, func.id) != nullptr)
+        semantic_error("Function redefinition", ptr);
 
-    PASS$(!functable_add(FUNCS, &func), return GENERATOR_PASS_ERROR; );
+    PASS$(!functable_add(ctx->funcs, &func), return GENERATOR_PASS_ERROR; );
 
     return GENERATOR_NOERR;
 }
 
-static generator_err generate_globals(Node* node)
+static generator_err generate_globals(Generator_context* ctx, Node* node)
 {
     assert(node);
 
-    if(node->left)
-        PASS$(!generate_globals(node->left), return GENERATOR_PASS_ERROR; );
+    if(node_left(node))
+        PASS$(!generate_globals(ctx, node_left(node)), return GENERATOR_PASS_ERROR; );
     
-    if(node->tok.type != TYPE_AUX || node->tok.val.aux != TOK_STATEMENT)
-        format_error("'statement' expected (first line)", &node->tok);
+    if(node_type(node) != TYPE_AUX || node_aux(node) != TOK_STATEMENT)
+        format_error("'statement' expected (first line)", node);
 
-    if(!node->right)
-        format_error("Missing 'statement' body (first line)", &node->tok);
+    if(!node_right(node))
+        format_error("Missing 'statement' body (first line)", node);
 
-    if(node->right->tok.type == TYPE_AUX && node->right->tok.val.aux == TOK_DEFINE)
+    if(node_type(node_right(node)) == TYPE_AUX && node_aux(node_right(node)) == TOK_DEFINE)
         return GENERATOR_NOERR;
 
-    if(node->right->tok.type != TYPE_OP || node->right->tok.val.op != TOK_ASSIGN)
-        format_error("'=' expected", &node->right->tok);
+    if(node_type(node_right(node)) != TYPE_OP || node_op(node_right(node)) != TOK_ASSIGN)
+        format_error("'=' expected", node_right(node));
 
-    PASS$(!assignment(node->right, GLOBALS), return GENERATOR_PASS_ERROR; );
+    PASS$(!assignment(ctx, node_right(node), ctx->globals), return GENERATOR_PASS_ERROR; );
 
     return GENERATOR_NOERR;
 }
 
-static generator_err generate_funcs(Node* node)
+static generator_err generate_funcs(Generator_context* ctx, Node* node)
 {
     assert(node);
 
-    if(node->left)
-        PASS$(!generate_funcs(node->left), return GENERATOR_PASS_ERROR; );
+    if(node_left(node))
+        PASS$(!generate_funcs(ctx, node_left(node)), return GENERATOR_PASS_ERROR; );
     
-    if(node->right->tok.type != TYPE_AUX || node->right->tok.val.aux != TOK_DEFINE)
+    if(node_type(node_right(node)) != TYPE_AUX || node_aux(node_right(node)) != TOK_DEFINE)
         return GENERATOR_NOERR;
     
-    char* func_name = node->right->left->left->tok.val.name;
+    char* func_name = node_name(ctx->tree, node_left(node_left(node_right(node))));
     print("\n\n\nfunc__%lx:\n", fnv1_64(func_name, strlen(func_name)));
 
-    INDENTATION++;
+    ctx->indentation++;
 
-    Node* param = node->right->left->right;
+    Node* param = node_right(node_left(node_right(node)));
     if(param)
-        PASS$(!parameter(param), return GENERATOR_PASS_ERROR; );
+        PASS$(!parameter(ctx, param), return GENERATOR_PASS_ERROR; );
 
-    Node* stmnt = node->right->right;
+    Node* stmnt = node_right(node_right(node));
     if(stmnt)
-        PASS$(!statement(stmnt), return GENERATOR_PASS_ERROR; );
+        PASS$(!statement(ctx, stmnt), return GENERATOR_PASS_ERROR; );
 
-    if(stmnt->right->tok.type != TYPE_KEYWORD || stmnt->right->tok.val.key != TOK_RETURN)
-        semantic_error("Missing terminational", &node->right->left->left->tok);
+    if(node_type(node_right(stmnt)) != TYPE_KEYWORD || node_key(node_right(stmnt)) != TOK_RETURN)
+        semantic_error("Missing terminational", node_left(node_left(node_right(node))));
 
-    MSG$("Function `%s` variables:", node->right->left->left->tok.val.name);
-    vartable_dump(LOCALS);
-    LOCALS->size = 0;
+    MSG$("Function `%s` variables:", node_name(ctx->tree, node_left(node_left(node_right(node)))));
+    vartable_dump(ctx->locals);
+    ctx->locals->size = 0;
 
-    INDENTATION--;
+    ctx->indentation--;
 
     return GENERATOR_NOERR;
 }
@@ -769,16 +827,14 @@ generator_err generator(Tree* tree, FILE* ostream)
 
     nametable_dump_init(dumpsystem_get_stream(backend_log));
 
-    OSTREAM = ostream;
-
     Variable_table globals = {};
     Variable_table locals  = {};
     Function_table funcs   = {};
-    GLOBALS = &globals;
-    LOCALS  = &locals;
-    FUNCS   = &funcs;
 
-    PASS$(!fill_funcs_table(tree->root), return GENERATOR_PASS_ERROR; );
+    Generator_context  context = {tree, &funcs, &locals, &globals, ostream};
+    Generator_context* ctx     = &context;
+
+    PASS$(!fill_funcs_table(ctx, tree_root(tree)), return GENERATOR_PASS_ERROR; );
     MSG$("Functions:");
     functable_dump(&funcs);
 
@@ -786,7 +842,7 @@ generator_err generator(Tree* tree, FILE* ostream)
               "pop rcx\n",
                MEMORY_GLOBAL);
 
-    PASS$(!generate_globals(tree->root), return GENERATOR_PASS_ERROR; );
+    PASS$(!generate_globals(ctx, tree_root(tree)), return GENERATOR_PASS_ERROR; );
     MSG$("Global variables:");
     vartable_dump(&globals);
 
@@ -798,16 +854,11 @@ generator_err generator(Tree* tree, FILE* ostream)
 
     print_tab("hlt\n");
 
-    PASS$(!generate_funcs(tree->root), return GENERATOR_PASS_ERROR; );
+    PASS$(!generate_funcs(ctx, tree_root(tree)), return GENERATOR_PASS_ERROR; );
 
-    GLOBALS = nullptr;
-    LOCALS  = nullptr;
-    FUNCS   = nullptr;
     vartable_dstr(&locals);
     vartable_dstr(&globals);
     functable_dstr(&funcs);
 
-    OSTREAM = nullptr;
-
-    return IS_ERROR;
+    return ctx->is_error;
 }
@@ -3,7 +3,7 @@
 #include <assert.h>
 #include "args.h"
 
-args_msg process_args(int argc, char* argv[], char infile_name[], char outfile_name[])
+args_msg process_args(int argc, char* argv[], char infile_name[], char outfile_name[], unsigned* flags)
 {
     assert(argv);
 
@@ -43,6 +43,10 @@ args_msg process_args(int argc, char* argv[], char infile_name[], char outfile_n
             if(memccpy(outfile_name, argv[iter], '\0', FILENAME_MAX) == nullptr)
                 return ARGS_FLNAME_OVRFLW; //LONG_FILENAME
         }
+        else if(flags && strcmp(argv[iter], "--no-peephole") == 0)
+        {
+            *flags |= ARGS_FLAG_NO_PEEPHOLE;
+        }
         else
         {
             return ARGS_BAD_CMD;
@@ -20,9 +20,16 @@ enum args_msg
     ARGS_UNEXPCTD_ERR    = 10, ///     
 };
 
+enum args_flags
+{
+    ARGS_FLAG_NONE        = 0,      /// no optional flags
+    ARGS_FLAG_NO_PEEPHOLE = 1 << 0, /// disable peephole optimizer (ELF backend)
+};
+
 const char HELP[]              = "-h, --help             reference\n"
                                  "--src <filename>       input file\n"
-                                 "--dst <filename>       output file\n";
+                                 "--dst <filename>       output file\n"
+                                 "--no-peephole          disable peephole optimizer (ELF backend only)\n";
 
 const char NOTE[]              = "(program ignores other options if -h entered)\n";
 const char NO_OPTIONS[]        = "\x1b[31;1mError:\x1b[0m enter options (-h to open reference)\n";
@@ -46,9 +53,10 @@ void response_args(args_msg param, FILE* const ostream = stderr);
     \param [in]  argv         Array of arguments
     \param [out] infile_name  Name of input file
     \param [out] outfile_name Name of output file
+    \param [out] flags        Optional args_flags, nullptr if program has no flags
 
     \return ARGS_NOMSG, args_msg with error otherwise
 */
-args_msg process_args(int argc, char* argv[], char infile_name[], char outfile_name[]);
+args_msg process_args(int argc, char* argv[], char infile_name[], char outfile_name[], unsigned* flags = nullptr);
 
 #endif // ARGS_H
@@ -51,6 +51,19 @@ static int dep_resize(Dependencies* deps)
     return DEP_NOERR;
 }
 
+Dep* dep_find(const Dependencies* deps, const char name[])
+{
+    assert(deps && name);
+
+    for(size_t iter = 0; iter < deps->buffer_sz; iter++)
+    {
+        if(strcmp(deps->buffer[iter].func.val.name, name) == 0)
+            return &deps->buffer[iter];
+    }
+
+    return nullptr;
+}
+
 void dep_dtor(Dependencies* deps)
 {
     assert(deps);
@@ -91,28 +104,41 @@ void dep_write(Dependencies* deps, FILE* stream)
     }
 }
 
-int dep_read(Dependencies* deps, char* data, size_t file_sz)
+// Each line is "<name> <number of arguments>", names are interned in 'tok_table'
+int dep_read(Dependencies* deps, Token_nametable* tok_table, const char data[], size_t file_sz)
 {
-    assert(data && deps);
+    assert(data && deps && tok_table);
 
     size_t pos = 0;
+    while(pos < file_sz && isspace(data[pos]))
+        pos++;
+
     while(pos < file_sz)
     {
         Dep dep = {};
         dep.func.type = TYPE_ID;
-        dep.func.val.name = data + pos;
 
-        int n_read = 0;
-        int name_len = 0;
-        ASSERT_RET$(sscanf(data + pos, "%*s%n %lu%n", &name_len, &dep.n_args, &n_read) != EOF, DEP_BAD_READ);
+        size_t name_start = pos;
+        while(pos < file_sz && !isspace(data[pos]))
+            pos++;
+
+        ASSERT_RET$(!token_nametable_add(tok_table, &dep.func.val.name, data + name_start, (ptrdiff_t) (pos - name_start)),
+                    DEP_BAD_ALLOC);
 
-        data[pos + (size_t) name_len] = '\0';
-        pos += (size_t) n_read;
+        while(pos < file_sz && isspace(data[pos]))
+            pos++;
+
+        ASSERT_RET$(pos < file_sz && isdigit(data[pos]), DEP_BAD_READ);
+        while(pos < file_sz && isdigit(data[pos]))
+        {
+            dep.n_args = dep.n_args * 10 + (size_t) (data[pos] - '0');
+            pos++;
+        }
 
         int err = dep_add(deps, dep);
         PASS$(!err, return err; );
 
-        while(isspace(data[pos]))
+        while(pos < file_sz && isspace(data[pos]))
             pos++;
     }
 
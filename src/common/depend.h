@@ -25,8 +25,9 @@ struct Dependencies
 int dep_get_filename(char** dst, const char* src);
 
 int  dep_add  (Dependencies* deps, Dep dep);
+Dep* dep_find (const Dependencies* deps, const char name[]);
 void dep_write(Dependencies* deps, FILE* stream);
-int  dep_read (Dependencies* deps, char* data, size_t file_sz);
+int  dep_read (Dependencies* deps, Token_nametable* tok_table, const char data[], size_t file_sz);
 void dep_dtor (Dependencies* deps);
 
 #endif // DEPEND_H
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "input.h"
+#include "../../include/logs/logs.h"
+
+static const size_t INPUT_READ_CHUNK = 1 << 16;
+
+// Non-empty view for empty file, so readers may assert data
+static const char EMPTY_DATA_[] = "";
+
+static int input_read_(Input* input, int fd)
+{
+    assert(input);
+
+    size_t size = 0;
+    size_t cap  = 0;
+
+    while(true)
+    {
+        if(cap - size < INPUT_READ_CHUNK)
+        {
+            cap += INPUT_READ_CHUNK;
+
+            char* ptr = (char*) realloc(input->buffer, cap);
+            ASSERT_RET$(ptr, INPUT_BAD_ALLOC);
+
+            input->buffer = ptr;
+        }
+
+        ssize_t n_read = read(fd, input->buffer + size, cap - size);
+        ASSERT_RET$(n_read >= 0, INPUT_READ_FAIL);
+
+        if(n_read == 0)
+            break;
+
+        size += (size_t) n_read;
+    }
+
+    input->data = input->buffer;
+    input->size = (ptrdiff_t) size;
+
+    return INPUT_NOERR;
+}
+
+int input_open(Input* input, const char filename[])
+{
+    assert(input && filename);
+
+    *input = {};
+
+    int fd = open(filename, O_RDONLY);
+    ASSERT_RET$(fd != -1, INPUT_OPEN_FAIL);
+
+    struct stat buff = {};
+    if(fstat(fd, &buff) == -1)
+    {
+        close(fd);
+        ASSERT_RET$(0, INPUT_OPEN_FAIL);
+    }
+
+    int err = INPUT_NOERR;
+
+    if(!S_ISREG(buff.st_mode))
+    {
+        err = input_read_(input, fd);
+    }
+    else if(buff.st_size > 0)
+    {
+        void* ptr = mmap(nullptr, (size_t) buff.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if(ptr != MAP_FAILED)
+        {
+            input->map  = ptr;
+            input->data = (const char*) ptr;
+            input->size = buff.st_size;
+
+            madvise(ptr, (size_t) buff.st_size, MADV_SEQUENTIAL);
+        }
+        else
+        {
+            err = input_read_(input, fd);
+        }
+    }
+
+    close(fd);
+
+    if(err)
+    {
+        input_close(input);
+        return err;
+    }
+
+    if(!input->data)
+        input->data = EMPTY_DATA_;
+
+    return INPUT_NOERR;
+}
+
+void input_close(Input* input)
+{
+    assert(input);
+
+    if(input->map)
+        munmap(input->map, (size_t) input->size);
+
+    free(input->buffer);
+
+    *input = {};
+}
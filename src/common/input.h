@@ -0,0 +1,28 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stddef.h>
+
+enum input_err
+{
+    INPUT_NOERR     = 0,
+    INPUT_OPEN_FAIL = 1,
+    INPUT_READ_FAIL = 2,
+    INPUT_BAD_ALLOC = 3,
+};
+
+// Read-only view of whole file. Regular files are mapped, others (pipes, terminals) are read
+// into buffer. View is not null-terminated, readers must stay within 'size'
+struct Input
+{
+    const char* data      = nullptr;
+    ptrdiff_t   size      = 0;
+
+    void*       map       = nullptr;   // mapping of regular file
+    char*       buffer    = nullptr;   // copy of non-regular file
+};
+
+int  input_open (Input* input, const char filename[]);
+void input_close(Input* input);
+
+#endif // INPUT_H
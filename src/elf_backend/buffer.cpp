@@ -11,7 +11,7 @@ static int buffer_resize(Buffer* buffer, size_t new_cap)
 {
     assert(buffer);
 
-    new_cap = (new_cap / (BUFFER_CHUNK_SIZE + 1) + 1) * BUFFER_CHUNK_SIZE;
+    new_cap = (new_cap / BUFFER_CHUNK_SIZE + 1) * BUFFER_CHUNK_SIZE;
 
     uint8_t* ptr = (uint8_t*) realloc(buffer->buf, new_cap * sizeof(uint8_t));
     if(!ptr)
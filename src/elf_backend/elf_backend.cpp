@@ -1,6 +1,5 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/stat.h>
 
 #include "elf_backend.h"
 #include "elf_generator.h"
@@ -9,17 +8,7 @@
 #include "../common/depend.h"
 #include "../common/jumps.h"
 #include "../common/args.h"
-
-static int get_file_sz_(const char filename[], size_t* sz)
-{
-    struct stat buff = {};
-    if(stat(filename, &buff) == -1)
-        return -1;
-    
-    *sz = (size_t) buff.st_size;
-    
-    return 0;
-}
+#include "../common/input.h"
 
 int main(int argc, char* argv[])
 {
@@ -31,22 +20,18 @@ int main(int argc, char* argv[])
     char  outfile_name[FILENAME_MAX] = "";
     char* depfile_name = nullptr;
 
-    char* data    = nullptr;
-    char* depdata = nullptr;
-    size_t infile_sz  = 0;
-    size_t depfile_sz = 0;
-
-    FILE* istream = nullptr;
     FILE* ostream = nullptr;
 
+    Input           input     = {};
     Binary          bin       = {};
     Tree            tree      = {};
     Dependencies    deps      = {};
     Token_nametable tok_table = {};
     
-    args_msg msg = ARGS_NOMSG;
+    args_msg msg   = ARGS_NOMSG;
+    unsigned flags = ARGS_FLAG_NONE;
 
-    msg = process_args(argc, argv, infile_name, outfile_name);
+    msg = process_args(argc, argv, infile_name, outfile_name, &flags);
     if(msg)
     {
         response_args(msg);
@@ -57,44 +42,23 @@ int main(int argc, char* argv[])
 TRY__
     ASSERT$(!dep_get_filename(&depfile_name, infile_name),
                                                             BACKEND_ELF_INFILE_FAIL,    FAIL__);
-    ASSERT$(get_file_sz_(infile_name,  &infile_sz)  != -1,
-                                                            BACKEND_ELF_INFILE_FAIL,    FAIL__);
     // FIXME assume that program has no dependencies if cannot find or open such file
-    ASSERT$(get_file_sz_(depfile_name, &depfile_sz) != -1,
-                                                            BACKEND_ELF_INFILE_FAIL,    FAIL__);
-
-    depdata = (char*) calloc(depfile_sz + 1, sizeof(char));
-    ASSERT$(depdata,                                        BACKEND_ELF_BAD_ALLOC,      FAIL__);
+    ASSERT$(!input_open(&input, depfile_name),              BACKEND_ELF_INFILE_FAIL,    FAIL__);
 
-    istream = fopen(depfile_name, "r");
-    ASSERT$(istream,                                        BACKEND_ELF_INFILE_FAIL,    FAIL__);
-
-    depfile_sz = fread(depdata, sizeof(char), depfile_sz, istream);
-    ASSERT$(!ferror(istream),                               BACKEND_ELF_READ_FAIL,      FAIL__);
-    fclose(istream);
-    istream = nullptr;
-
-    ASSERT$(!dep_read(&deps, depdata, depfile_sz),          BACKEND_ELF_INFILE_FAIL,    FAIL__);
-
-    data = (char*) calloc(infile_sz + 1, sizeof(char));
-    ASSERT$(data,                                           BACKEND_ELF_BAD_ALLOC,      FAIL__);
-
-    istream = fopen(infile_name, "r");
-    ASSERT$(istream,                                        BACKEND_ELF_INFILE_FAIL,    FAIL__);
-
-    infile_sz = fread(data, sizeof(char), infile_sz, istream);
-    ASSERT$(!ferror(istream),                               BACKEND_ELF_READ_FAIL,      FAIL__);
-    fclose(istream);
-    istream = nullptr;
+    ASSERT$(!dep_read(&deps, &tok_table, input.data, (size_t) input.size),
+                                                            BACKEND_ELF_INFILE_FAIL,    FAIL__);
+    input_close(&input);
 
-    data = (char*) realloc(data, (infile_sz + 1) * sizeof(char));
-    ASSERT$(data,                                           BACKEND_ELF_BAD_ALLOC,      FAIL__);
-    data[infile_sz] = 0; // null-termination of buffer
+    ASSERT$(!input_open(&input, infile_name),               BACKEND_ELF_INFILE_FAIL,    FAIL__);
 
-    ASSERT$(!tree_read(&tree, &tok_table, data, (ptrdiff_t) infile_sz),   
+    ASSERT$(!tree_read(&tree, &tok_table, input.data, input.size),   
                                                             BACKEND_ELF_FORMAT_ERROR,   FAIL__);
+    // Input stays mapped: binary tree refers to names in it
 
-    ASSERT$(!generator(&tree, &deps, &bin),                 BACKEND_ELF_GENERATOR_FAIL, FAIL__);
+    ASSERT$(!tree_fold(&tree, TREE_FOLD_INTEGER),          BACKEND_ELF_BAD_ALLOC,      FAIL__);
+
+    ASSERT$(!generator(&tree, &deps, &bin, !(flags & ARGS_FLAG_NO_PEEPHOLE)),
+                                                            BACKEND_ELF_GENERATOR_FAIL, FAIL__);
     
     ostream = fopen(outfile_name, "wb");
     ASSERT$(ostream,                                        BACKEND_ELF_OUTFILE_FAIL,   FAIL__);
@@ -107,15 +71,11 @@ TRY__
 CATCH__
     ERROR__ = 1;
 
-    if(istream)
-        fclose(istream);
-    
     if(ostream)
         fclose(ostream);
     
 FINALLY__
-    free(data);
-    free(depdata);
+    input_close(&input);
     free(depfile_name);
     
     dep_dtor            (&deps);
@@ -7,490 +7,1008 @@
 #include "encode.h"
 #include "elf_wrap.h"
 #include "relocation.h"
+#include "regalloc.h"
+#include "ir.h"
+#include "peephole.h"
 #include "../../include/logs/logs.h"
 #include "../reserved_names.h"
 
-static Symtable*    SYMTABLE    = nullptr;
-static Localtable*  LOCALTABLE  = nullptr;
-static Relocations* RELOCATIONS = nullptr;
 
-static Section* DATA = nullptr;
-// static Section* INIT = nullptr;
-static Section* TEXT = nullptr;
-
-static generator_err IS_ERROR = GENERATOR_NOERR;
-
-#define semantic_error(MSG_, TOK_)                                                      \
+#define semantic_error(MSG_, NODE_)                                                     \
 do                                                                                      \
 {                                                                                       \
-    IS_ERROR = GENERATOR_SEMANTIC_ERROR;                                                \
-    fprintf(stderr, "\x1b[31mSemantic error:\x1b[0m %s : %s\n", (MSG_), std_demangle(TOK_));\
+    ctx->is_error = GENERATOR_SEMANTIC_ERROR;                                           \
+    Token tok_ = node_token(ctx->tree, (NODE_));                                        \
+    fprintf(stderr, "\x1b[31mSemantic error:\x1b[0m %s : %s\n", (MSG_), std_demangle(&tok_));\
     FILE* stream_ = logs_get();                                                         \
                                                                                         \
     if(stream_)                                                                         \
     {                                                                                   \
         fprintf(stream_, "<span class = \"error\">Semantic error: %s : %s\n</span>"     \
                          "\t\t\t\tat %s:%d:%s\n",                                       \
-                         (MSG_), std_demangle(TOK_),                                        \
+                         (MSG_), std_demangle(&tok_),                                        \
                          __FILE__, __LINE__, __PRETTY_FUNCTION__);                      \
-                                                                                        \
-        return GENERATOR_NOERR;                                                         \
     }                                                                                   \
+                                                                                        \
+    return GENERATOR_NOERR;                                                             \
 } while(0)                                                                              \
 
-#define format_error(MSG_, TOK_)                                                        \
+#define format_error(MSG_, NODE_)                                                       \
 do                                                                                      \
 {                                                                                       \
-    IS_ERROR = GENERATOR_FORMAT_ERROR;                                                  \
-    fprintf(stderr, "\x1b[31mFormat error:\x1b[0m %s : %s\n", (MSG_), std_demangle(TOK_));  \
+    ctx->is_error = GENERATOR_FORMAT_ERROR;                                             \
+    Token tok_ = node_token(ctx->tree, (NODE_));                                        \
+    fprintf(stderr, "\x1b[31mFormat error:\x1b[0m %s : %s\n", (MSG_), std_demangle(&tok_));  \
     FILE* stream_ = logs_get();                                                         \
                                                                                         \
     if(stream_)                                                                         \
     {                                                                                   \
         fprintf(stream_, "<span class = \"error\">Format error: %s : %s\n</span>"       \
                          "\t\t\t\tat %s : %d : %s\n",                                   \
-                         (MSG_), std_demangle(TOK_),                                        \
+                         (MSG_), std_demangle(&tok_),                                        \
                          __FILE__, __LINE__, __PRETTY_FUNCTION__);                      \
-                                                                                        \
-        return GENERATOR_NOERR;                                                         \
     }                                                                                   \
+                                                                                        \
+    return GENERATOR_NOERR;                                                             \
 } while(0)                                                                              \
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Expressions are evaluated in scratch registers. Operands of binary operators are ordered by
+// Sethi-Ullman numbers, leaves (numbers and variables with constant index) are used directly as
+// immediate or memory operands. If scratch registers run out, evaluated operand is spilled on stack.
+// RAX and RDX are not scratch registers: CQO, IDIV, SETcc and calls use them implicitly.
+
+static const Operand* const SCRATCH[] = {&RDI, &RSI, &RCX, &R8, &R9, &R10, &R11};
+static const int SCRATCH_SZ = (int) (sizeof(SCRATCH) / sizeof(SCRATCH[0]));
+
+static const Operand* const ARG_REGS[] = {&RDI, &RSI, &RDX, &RCX, &R8, &R9};
+static const size_t ARG_REGS_SZ = sizeof(ARG_REGS) / sizeof(ARG_REGS[0]);
+
+// Scalar locals are allocated in callee-saved registers, which are saved in the first frame slots
+static const Operand* const CALLEE_SAVED[] = {&RBX, &R12, &R13, &R14, &R15};
+static const int CALLEE_SAVED_SZ = (int) (sizeof(CALLEE_SAVED) / sizeof(CALLEE_SAVED[0]));
+
+// Everything generator() works on, so that separate objects can be generated at once
+struct Generator_context
+{
+    Tree*        tree        = nullptr;
+    Symtable*    symtable    = nullptr;
+    Localtable*  localtable  = nullptr;
+    Relocations* relocations = nullptr;
+    Regalloc*    regalloc    = nullptr;
+    Ir*          ir          = nullptr; // instructions of current function
+
+    Peephole_stats* peephole = nullptr; // nullptr if peephole optimizer is disabled
+
+    Section* data = nullptr;
+    // Section* init = nullptr;
+    Section* text = nullptr;
+
+    uint32_t scratch_used = 0; // bitmask of occupied SCRATCH registers
+    int32_t  stack_depth  = 0; // qwords pushed on top of local variables
+
+    uint32_t callee_used = 0;
+    int32_t  callee_slots[CALLEE_SAVED_SZ];
+
+    generator_err is_error = GENERATOR_NOERR;
+};
+
+static bool is_register(Operand op, Operand reg)
+{
+    return op.type == OP_REGISTER && op.reg.id == reg.reg.id;
+}
+
+static int scratch_index(Operand reg)
+{
+    for(int iter = 0; iter < SCRATCH_SZ; iter++)
+    {
+        if(is_register(reg, *SCRATCH[iter]))
+            return iter;
+    }
+
+    return -1;
+}
+
+static int scratch_free_num(Generator_context* ctx)
+{
+    return SCRATCH_SZ - __builtin_popcount(ctx->scratch_used);
+}
+
+// Takes 'hint' if it is free scratch register, otherwise first free one
+static Operand scratch_alloc(Generator_context* ctx, Operand hint)
+{
+    int index = scratch_index(hint);
+
+    if(index < 0 || (ctx->scratch_used & (1u << index)))
+    {
+        for(index = 0; index < SCRATCH_SZ; index++)
+        {
+            if(!(ctx->scratch_used & (1u << index)))
+                break;
+        }
+    }
+
+    assert(index < SCRATCH_SZ && "Out of scratch registers");
+
+    ctx->scratch_used |= 1u << index;
+
+    return *SCRATCH[index];
+}
+
+static void scratch_release(Generator_context* ctx, Operand reg)
+{
+    int index = scratch_index(reg);
+
+    if(index >= 0)
+        ctx->scratch_used &= ~(1u << index);
+}
+
+static void stack_push(Generator_context* ctx, Ir* ir, Operand reg)
+{
+    ir_emit(ir, {PUSH, reg, {}});
+    ctx->stack_depth++;
+}
+
+static void stack_pop(Generator_context* ctx, Ir* ir, Operand reg)
+{
+    ir_emit(ir, {POP, reg, {}});
+    ctx->stack_depth--;
+}
+
+// Binds new local to register chosen by register allocator
+static void local_register(Generator_context* ctx, Local_var* var)
+{
+    int reg = -1;
+
+    if(var->size == 1 && regalloc_find(ctx->regalloc, var->id, &reg) == 0 && reg >= 0)
+    {
+        var->is_register = true;
+        var->reg         = CALLEE_SAVED[reg]->reg.id;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Operand which can be used without loading in register
+struct Location
+{
+    Operand  op;
+    bool     is_reloc;  // RIP-relative reference to symbol 'sym_index'
+    uint64_t sym_index;
+    int32_t  addend;
+};
+
+static void emit_loc(Ir* ir, Instruction instr, const Location* loc)
+{
+    if(loc->is_reloc)
+        ir_emit_reloc(ir, instr, loc->sym_index, loc->addend);
+    else
+        ir_emit(ir, instr);
+}
+
+static bool leaf_location(Generator_context* ctx, Node* node, Location* loc)
+{
+    assert(node && loc);
+
+    if(node_type(node) == TYPE_NUMBER && !node_left(node) && !node_right(node))
+    {
+        *loc = {.op = IMM32((int32_t) node_num(ctx->tree, node))};
+        return true;
+    }
+
+    if(node_type(node) != TYPE_ID || node_left(node))
+        return false;
+
+    int32_t shift = 0;
+    if(node_right(node))
+    {
+        if(node_type(node_right(node)) != TYPE_NUMBER || node_left(node_right(node)) || node_right(node_right(node)))
+            return false;
+
+        shift = (int32_t) node_num(ctx->tree, node_right(node)) * 8;
+    }
+
+    Symbol    sym       = {};
+    uint64_t  sym_index = 0;
+    Local_var local     = {};
+
+    if(symtable_find(ctx->symtable, node_name(ctx->tree, node), &sym, &sym_index) == 0)
+    {
+        if(sym.type != SYMBOL_TYPE_VARIABLE)
+            return false;
+
+        *loc = {.op = MEM(0, {}, {}, 0x0), .is_reloc = true, .sym_index = sym_index, .addend = shift};
+        return true;
+    }
+
+    if(localtable_find(ctx->localtable, node_name(ctx->tree, node), &local) == 0)
+    {
+        assert(!local.is_register || !shift);
+
+        *loc = {.op = local.is_register ? REG(local.reg) : MEM(0, {}, RBP, local.offset + shift)};
+        return true;
+    }
+
+    return false;
+}
+
+struct Expr_info
+{
+    int  need;          // Sethi-Ullman number
+    bool has_call;
+    bool reads_global;  // result may be changed by call
+};
+
+static Expr_info expr_info(Generator_context* ctx, Node* node)
+{
+    assert(node);
+
+    Expr_info info = {.need = 1};
+
+    if(node_type(node) == TYPE_ID)
+    {
+        info.reads_global = symtable_find(ctx->symtable, node_name(ctx->tree, node)) == 0;
+
+        if(node_right(node))
+        {
+            Expr_info index = expr_info(ctx, node_right(node));
+
+            info.need          = index.need;
+            info.has_call      = index.has_call;
+            info.reads_global |= index.reads_global;
+        }
+    }
+    else if(node_type(node) == TYPE_AUX && node_aux(node) == TOK_CALL)
+    {
+        // Call saves scratch registers itself, so it needs only one for result
+        info.has_call = true;
+
+        for(Node* arg = node_right(node); arg; arg = node_left(arg))
+        {
+            if(node_right(arg))
+                info.reads_global |= expr_info(ctx, node_right(arg)).reads_global;
+        }
+    }
+    else if(node_type(node) == TYPE_OP && node_left(node) && node_right(node))
+    {
+        Expr_info lhs = expr_info(ctx, node_left(node));
+        Expr_info rhs = expr_info(ctx, node_right(node));
+
+        Location loc = {};
+        if(leaf_location(ctx, node_right(node), &loc))
+            rhs.need = 0;
+
+        info.need         = (lhs.need == rhs.need) ? lhs.need + 1 : (lhs.need > rhs.need ? lhs.need : rhs.need);
+
+        // Operands of logical operator are never live at the same time
+        if(node_op(node) == TOK_AND || node_op(node) == TOK_OR)
+        {
+            info.need = (lhs.need > rhs.need) ? lhs.need : rhs.need;
+            info.need = (info.need > 1) ? info.need : 1;
+        }
+
+        info.has_call     = lhs.has_call     || rhs.has_call;
+        info.reads_global = lhs.reads_global || rhs.reads_global;
+    }
+    else if(node_type(node) == TYPE_OP && node_right(node))
+    {
+        info = expr_info(ctx, node_right(node));
+    }
+
+    return info;
+}
+
+// Subtrees can be evaluated in any order
+static bool is_independent(Expr_info first, Expr_info second)
+{
+    return !(first.has_call  && (second.has_call || second.reads_global)) &&
+           !(second.has_call && first.reads_global);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-static generator_err expression(Section* sect, Node* node);
-static generator_err statement(Node* node);
+static generator_err expression(Generator_context* ctx, Ir* ir, Node* node, Operand* dst);
+static generator_err condition (Generator_context* ctx, Ir* ir, Node* node, bool is_true, size_t label);
+static generator_err statement(Generator_context* ctx, Node* node);
 
-static generator_err number(Section* sect, Node* node)
+static generator_err number(Generator_context* ctx, Ir* ir, Node* node, Operand* dst)
 {
     assert(node);
-    assert(node->tok.type == TYPE_NUMBER);
+    assert(node_type(node) == TYPE_NUMBER);
 
-    if(node->left || node->right)
-        format_error("Number has descendants", &node->tok);
+    if(node_left(node) || node_right(node))
+        format_error("Number has descendants", node);
 
-    encode(&sect->buffer, {PUSH, IMM32((int32_t) node->tok.val.num)});
+    *dst = scratch_alloc(ctx, *dst);
+    ir_emit(ir, {MOV, *dst, IMM32((int32_t) node_num(ctx->tree, node))});
 
     return GENERATOR_NOERR;
 }
 
-static generator_err variable(Section* sect, Node* node)
+static generator_err variable(Generator_context* ctx, Ir* ir, Node* node, Operand* dst)
 {
     assert(node);
-    assert(node->tok.type == TYPE_ID);
+    assert(node_type(node) == TYPE_ID);
 
-    if(node->left)
-        semantic_error("Variable has 'const' specifier in expression", &node->tok);
-    
-    Operand index_reg = {};
-    uint8_t scale = 0;
+    if(node_left(node))
+        semantic_error("Variable has 'const' specifier in expression", node);
 
-    if(node->right)
+    Location loc = {};
+    if(leaf_location(ctx, node, &loc))
     {
-        PASS$(!expression(sect, node->right), return GENERATOR_PASS_ERROR; );
-        
-        encode(&sect->buffer, {POP, RCX, {}});
-        index_reg = RCX;
-        scale     = 8;
+        *dst = scratch_alloc(ctx, *dst);
+        emit_loc(ir, {MOV, *dst, loc.op}, &loc);
+
+        return GENERATOR_NOERR;
     }
 
-    Symbol    sym = {};
+    Symbol    sym       = {};
     uint64_t  sym_index = 0;
-    Local_var local = {};
+    Local_var local     = {};
 
-    if(symtable_find(SYMTABLE, node->tok.val.name, &sym, &sym_index) == 0)
+    if(symtable_find(ctx->symtable, node_name(ctx->tree, node), &sym, &sym_index) == 0)
     {
-        assert(sym.type == SYMBOL_TYPE_VARIABLE);
+        if(sym.type != SYMBOL_TYPE_VARIABLE)
+            semantic_error("Function can't be used as variable", node);
 
-        encode(&sect->buffer, {LEA, RAX, MEM(0, {}, {}, 0x0)});
+        assert(node_right(node));
 
-        Reloc reloc = {.dst_section_descriptor = sect->descriptor,
-                       .dst_offset = sect->buffer.pos - sizeof(int32_t),
-                       .dst_init_val = - (int32_t) sizeof(int32_t),
-                       .src_nametable_index = sym_index
-                      };
-        
-        relocations_insert(RELOCATIONS, reloc);
+        // Index is evaluated in register which receives value
+        PASS$(!expression(ctx, ir, node_right(node), dst), return GENERATOR_PASS_ERROR; );
+
+        loc = {.op = MEM(0, {}, {}, 0x0), .is_reloc = true, .sym_index = sym_index};
+        emit_loc(ir, {LEA, RAX, loc.op}, &loc);
 
-        encode(&sect->buffer, {PUSH, MEM(scale, index_reg, RAX, 0), {}});
+        ir_emit(ir, {MOV, *dst, MEM(8, *dst, RAX, 0)});
     }
-    else if(localtable_find(LOCALTABLE, node->tok.val.name, &local) == 0)
+    else if(localtable_find(ctx->localtable, node_name(ctx->tree, node), &local) == 0)
     {
-        encode(&sect->buffer, {PUSH, MEM(scale, index_reg, RBP, local.offset), {}});
+        assert(node_right(node));
+
+        PASS$(!expression(ctx, ir, node_right(node), dst), return GENERATOR_PASS_ERROR; );
+
+        ir_emit(ir, {MOV, *dst, MEM(8, *dst, RBP, local.offset)});
     }
     else
     {
-        semantic_error("Variable wasn't declared", &node->tok);
+        semantic_error("Variable wasn't declared", node);
     }
 
     return GENERATOR_NOERR;
 }
 
+// Operator can be applied to 'loc' operand by combine()
+static bool is_combinable(token_operators op, const Location* loc)
+{
+    if(loc->op.type != OP_IMM32)
+        return true;
+
+    return op != TOK_DIV;
+}
+
+// Operator with swapped operands
+static bool mirror(token_operators op, token_operators* mirrored)
+{
+    switch(op)
+    {
+        case TOK_ADD: case TOK_MUL: case TOK_EQ: case TOK_NEQ:
+            *mirrored = op;
+            return true;
+        case TOK_LESS:
+            *mirrored = TOK_GREAT;
+            return true;
+        case TOK_GREAT:
+            *mirrored = TOK_LESS;
+            return true;
+        case TOK_LEQ:
+            *mirrored = TOK_GEQ;
+            return true;
+        case TOK_GEQ:
+            *mirrored = TOK_LEQ;
+            return true;
+        case TOK_SUB:   case TOK_DIV:   case TOK_SHIFT:  case TOK_POWER: case TOK_NOT:
+        case TOK_AND:   case TOK_OR:
+        case TOK_LRPAR: case TOK_RRPAR: case TOK_ASSIGN: case TOK_LFPAR: case TOK_RFPAR:
+        case TOK_LQPAR: case TOK_RQPAR: case TOK_COMMA:  case TOK_SEMICOLON:
+        default:
+            return false;
+    }
+}
+
 #define DEF_OPER(MANGLE, OPCODE)                                    \
     case TOK_##MANGLE:                                              \
     {                                                               \
-        encode(&sect->buffer, {OPCODE, RAX, RBX});                  \
-        encode(&sect->buffer, {PUSH, RAX, {}});                     \
+        emit_loc(ir, {OPCODE, dst, src->op}, src);                  \
         break;                                                      \
     }                                                               \
 
 #define DEF_LOGICAL(MANGLE, OPCODE)                                 \
     case TOK_##MANGLE:                                              \
     {                                                               \
-        encode(&sect->buffer, {XOR, RDX, RDX});                     \
-        encode(&sect->buffer, {CMP, RAX, RBX});                     \
-        encode(&sect->buffer, {OPCODE, RDX, {}});                   \
-        encode(&sect->buffer, {PUSH, RDX, {}});                     \
+        if(is_flags)                                                \
+        {                                                           \
+            emit_loc(ir, {CMP, dst, src->op}, src);                 \
+            break;                                                  \
+        }                                                           \
+                                                                    \
+        ir_emit(ir, {XOR, RDX, RDX});                               \
+        emit_loc(ir, {CMP, dst, src->op}, src);                     \
+        ir_emit(ir, {OPCODE, RDX, {}});                             \
+        ir_emit(ir, {MOV, dst, RDX});                               \
         break;                                                      \
     }                                                               \
 
-#define DEF_UNIMPLEMENTED(MANGLE)    \
-    case TOK_##MANGLE:               \
+// dst = dst (op) src, relational operators only set flags if 'is_flags'
+static void combine(Ir* ir, token_operators op, Operand dst, const Location* src, bool is_flags = false)
+{
+    switch(op)
+    {
+        DEF_OPER(ADD, ADD)
+        DEF_OPER(SUB, SUB)
+        DEF_OPER(MUL, IMUL)
+        case TOK_DIV:
+        {
+            if(!is_register(dst, RAX))
+                ir_emit(ir, {MOV, RAX, dst});
+
+            ir_emit(ir, {CQO, {}, {}});
+            emit_loc(ir, {IDIV, src->op, {}}, src);
+
+            if(!is_register(dst, RAX))
+                ir_emit(ir, {MOV, dst, RAX});
+            break;
+        }
+        DEF_LOGICAL(EQ, SETE)
+        DEF_LOGICAL(NEQ, SETNE)
+        DEF_LOGICAL(GEQ, SETGE)
+        DEF_LOGICAL(LEQ, SETLE)
+        DEF_LOGICAL(GREAT, SETG)
+        DEF_LOGICAL(LESS, SETL)
+
+        // && and || are lowered to jumps by logical()
+        case TOK_AND:   case TOK_OR:
+        case TOK_SHIFT: case TOK_POWER: case TOK_NOT:
+        case TOK_LRPAR: case TOK_RRPAR: case TOK_ASSIGN: case TOK_LFPAR: case TOK_RFPAR:
+        case TOK_LQPAR: case TOK_RQPAR: case TOK_COMMA:  case TOK_SEMICOLON:
+        default:
+            assert(0 && "Operator can't be combined");
+    }
+}
+
+#undef DEF_OPER
+#undef DEF_LOGICAL
+
+static bool is_relational(token_operators op)
+{
+    return op == TOK_EQ || op == TOK_NEQ || op == TOK_GEQ || op == TOK_LEQ || op == TOK_GREAT || op == TOK_LESS;
+}
+
+// Value of logical operator is materialized by jumps of condition(ctx)
+static generator_err logical(Generator_context* ctx, Ir* ir, Node* node, Operand* dst)
+{
+    assert(node);
+
+    size_t false_label = ir_label(ir);
+    size_t end_label   = ir_label(ir);
+
+    PASS$(!condition(ctx, ir, node, false, false_label), return GENERATOR_PASS_ERROR; );
+
+    *dst = scratch_alloc(ctx, *dst);
+
+    ir_emit(ir, {MOV, *dst, IMM32(1)});
+    ir_emit_jump(ir, JMP, end_label);
+
+    ir_bind(ir, false_label);
+    ir_emit(ir, {MOV, *dst, IMM32(0)});
+
+    ir_bind(ir, end_label);
+
+    return GENERATOR_NOERR;
+}
 
-static generator_err oper(Section* sect, Node* node)
+// Relational operator is only compared if 'cmp_op' is set, it receives operator matching flags
+static generator_err oper(Generator_context* ctx, Ir* ir, Node* node, Operand* dst, token_operators* cmp_op = nullptr)
 {
     assert(node);
-    assert(node->tok.type == TYPE_OP);
+    assert(node_type(node) == TYPE_OP);
+
+    token_operators op       = node_op(node);
+    bool            is_flags = cmp_op != nullptr;
 
-    if(node->left && node->right)
+    assert(!is_flags || is_relational(op));
+
+    if(cmp_op)
+        *cmp_op = op;
+
+    if(!node_left(node) && node_right(node) && op == TOK_NOT)
     {
-        encode(&sect->buffer, {POP, RBX, {}});
-        encode(&sect->buffer, {POP, RAX, {}});
+        PASS$(!expression(ctx, ir, node_right(node), dst), return GENERATOR_PASS_ERROR; );
 
-        switch(node->tok.val.op)
-        {
-            DEF_OPER(ADD, ADD)
-            DEF_OPER(SUB, SUB)
-            DEF_OPER(MUL, IMUL)
-            case TOK_DIV:
-            {
-                encode(&sect->buffer, {CQO, {}, {}});
-                encode(&sect->buffer, {IDIV, RBX, {}});
-                encode(&sect->buffer, {PUSH, RAX, {}});
-                break;
-            }
-            case TOK_OR:
-            {
-                encode(&sect->buffer, {XOR, RDX, RDX});
-                encode(&sect->buffer, {OR, RAX, RBX});
-                encode(&sect->buffer, {SETNE, RDX, {}});
-                encode(&sect->buffer, {PUSH, RDX, {}});
-                break;
-            }
-            case TOK_AND:
-            {                
-                encode(&sect->buffer, {TEST, RAX, RAX});
-                encode(&sect->buffer, {SETNE, RAX, {}});
-                encode(&sect->buffer, {XOR, RDX, RDX});
-                encode(&sect->buffer, {TEST, RBX, RBX});
-                encode(&sect->buffer, {SETNE, RDX});
-                encode(&sect->buffer, {AND, RAX, RDX});
-                encode(&sect->buffer, {PUSH, RAX, {}});
-                break;
-            }
+        ir_emit(ir, {XOR, RDX, RDX});
+        ir_emit(ir, {TEST, *dst, *dst});
+        ir_emit(ir, {SETE, RDX, {}});
+        ir_emit(ir, {MOV, *dst, RDX});
 
-            DEF_LOGICAL(EQ, SETE)
-            DEF_LOGICAL(NEQ, SETNE)
-            DEF_LOGICAL(GEQ, SETGE)
-            DEF_LOGICAL(LEQ, SETLE)
-            DEF_LOGICAL(GREAT, SETG)
-            DEF_LOGICAL(LESS, SETL)
+        return GENERATOR_NOERR;
+    }
 
-            DEF_UNIMPLEMENTED(POWER)
-            default:
-                format_error("Unknown or unimplemented operator", &node->tok);
-        }
+    if(!node_left(node) || !node_right(node))
+        format_error("Invalid operator descendants combination", node);
+
+    if(op == TOK_AND || op == TOK_OR)
+    {
+        PASS$(!logical(ctx, ir, node, dst), return GENERATOR_PASS_ERROR; );
+        return GENERATOR_NOERR;
     }
-    else if(!node->left && node->right && node->tok.val.op == TOK_NOT)
+
+    switch(op)
     {
-        encode(&sect->buffer, {POP, RAX, {}});
-        encode(&sect->buffer, {XOR, RDX, RDX});
-        encode(&sect->buffer, {TEST, RAX, RAX});
-        encode(&sect->buffer, {SETE, RDX, {}});
-        encode(&sect->buffer, {PUSH, RDX, {}});
+        case TOK_ADD: case TOK_SUB: case TOK_MUL: case TOK_DIV:
+        case TOK_EQ:  case TOK_NEQ: case TOK_GEQ: case TOK_LEQ: case TOK_GREAT: case TOK_LESS:
+            break;
+        case TOK_AND:   case TOK_OR:
+        case TOK_SHIFT: case TOK_POWER: case TOK_NOT:
+        case TOK_LRPAR: case TOK_RRPAR: case TOK_ASSIGN: case TOK_LFPAR: case TOK_RFPAR:
+        case TOK_LQPAR: case TOK_RQPAR: case TOK_COMMA:  case TOK_SEMICOLON:
+        default:
+            format_error("Unknown or unimplemented operator", node);
+    }
+
+    Location        loc      = {};
+    token_operators mirrored = op;
+
+    if(leaf_location(ctx, node_right(node), &loc) && is_combinable(op, &loc))
+    {
+        PASS$(!expression(ctx, ir, node_left(node), dst), return GENERATOR_PASS_ERROR; );
+        combine(ir, op, *dst, &loc, is_flags);
+
+        return GENERATOR_NOERR;
+    }
+
+    // Global can't be read after call, which can change it
+    if(leaf_location(ctx, node_left(node), &loc) && is_combinable(op, &loc) && mirror(op, &mirrored) &&
+       (!loc.is_reloc || !expr_info(ctx, node_right(node)).has_call))
+    {
+        PASS$(!expression(ctx, ir, node_right(node), dst), return GENERATOR_PASS_ERROR; );
+        combine(ir, mirrored, *dst, &loc, is_flags);
+
+        if(cmp_op)
+            *cmp_op = mirrored;
+
+        return GENERATOR_NOERR;
+    }
+
+    Expr_info lhs_info = expr_info(ctx, node_left(node));
+    Expr_info rhs_info = expr_info(ctx, node_right(node));
+
+    // Subtree with call goes first, so fewer registers are saved around it
+    bool is_rhs_first = is_independent(lhs_info, rhs_info) &&
+                        ((rhs_info.has_call && !lhs_info.has_call) || rhs_info.need > lhs_info.need);
+
+    Node*     first       = is_rhs_first ? node_right(node) : node_left(node);
+    Node*     second      = is_rhs_first ? node_left(node)  : node_right(node);
+    Expr_info second_info = is_rhs_first ? lhs_info    : rhs_info;
+
+    Operand first_reg  = is_rhs_first ? Operand{} : *dst;
+    Operand second_reg = is_rhs_first ? *dst : Operand{};
+
+    PASS$(!expression(ctx, ir, first, &first_reg), return GENERATOR_PASS_ERROR; );
+
+    bool is_spilled = second_info.need > scratch_free_num(ctx);
+    if(is_spilled)
+    {
+        stack_push(ctx, ir, first_reg);
+        scratch_release(ctx, first_reg);
+    }
+
+    PASS$(!expression(ctx, ir, second, &second_reg), return GENERATOR_PASS_ERROR; );
+
+    if(!is_spilled)
+    {
+        Operand lhs = is_rhs_first ? second_reg : first_reg;
+        Operand rhs = is_rhs_first ? first_reg  : second_reg;
+
+        loc = {.op = rhs};
+        combine(ir, op, lhs, &loc, is_flags);
+        scratch_release(ctx, rhs);
+
+        *dst = lhs;
+    }
+    else if(!is_rhs_first)
+    {
+        // Spilled left operand is restored in RAX
+        stack_pop(ctx, ir, RAX);
+
+        loc = {.op = second_reg};
+        combine(ir, op, RAX, &loc, is_flags);
+        ir_emit(ir, {MOV, second_reg, RAX});
+
+        *dst = second_reg;
     }
     else
     {
-        format_error("Invalid operator descendants combination", &node->tok);
+        // Spilled right operand is used from stack
+        loc = {.op = MEM(0, {}, RSP, 0)};
+        combine(ir, op, second_reg, &loc, is_flags);
+
+        ir_emit(ir, {LEA, RSP, MEM(0, {}, RSP, 8)});
+        ctx->stack_depth--;
+
+        *dst = second_reg;
     }
 
     return GENERATOR_NOERR;
 }
 
-#undef DEF_OPER
-#undef DEF_LOGICAL
-#undef DEF_UNIMPLEMENTED
-
-static generator_err call_argument(Section* sect, Node* node, size_t n_args)
+static generator_err call_argument(Generator_context* ctx, Ir* ir, Node* node, size_t n_args, Operand* arg_regs)
 {
     assert(node);
-    assert(node->tok.type == TYPE_AUX && node->tok.val.aux == TOK_PARAMETER);
+    assert(node_type(node) == TYPE_AUX && node_aux(node) == TOK_PARAMETER);
 
-    if((n_args > 1 && !node->left) || (n_args == 1 && node->left))
-        semantic_error("Wrong amount of arguments", &node->tok);
+    if((n_args > 1 && !node_left(node)) || (n_args == 1 && node_left(node)))
+        semantic_error("Wrong amount of arguments", node);
 
-    if(node->left)
-        PASS$(!call_argument(sect, node->left, n_args - 1), return GENERATOR_PASS_ERROR; );
+    if(node_left(node))
+        PASS$(!call_argument(ctx, ir, node_left(node), n_args - 1, arg_regs), return GENERATOR_PASS_ERROR; );
 
-    if(!node->right)
-        format_error("Missing argument", &node->right->tok);
-    
-    PASS$(!expression(sect, node->right), return GENERATOR_PASS_ERROR; );
+    if(!node_right(node))
+        format_error("Missing argument", node);
 
-    switch(n_args)
+    if(n_args <= ARG_REGS_SZ)
     {
-        case 6:
-            encode(&sect->buffer, {POP, R9, {}});
-            break;
-        case 5:
-            encode(&sect->buffer, {POP, R8, {}});
-            break;
-        case 4:
-            encode(&sect->buffer, {POP, RCX, {}});
-            break;
-        case 3:
-            encode(&sect->buffer, {POP, RDX, {}});
-            break;
-        case 2:
-            encode(&sect->buffer, {POP, RSI, {}});
-            break;
-        case 1:
-            encode(&sect->buffer, {POP, RDI, {}});
-            break;
-        default:
-            void(0);
+        arg_regs[n_args - 1] = *ARG_REGS[n_args - 1];
+        PASS$(!expression(ctx, ir, node_right(node), &arg_regs[n_args - 1]), return GENERATOR_PASS_ERROR; );
+
+        return GENERATOR_NOERR;
     }
 
+    // Stack arguments are stored right in reserved area
+    Operand reg = {};
+    PASS$(!expression(ctx, ir, node_right(node), &reg), return GENERATOR_PASS_ERROR; );
+
+    ir_emit(ir, {MOV, MEM(0, {}, RSP, 8 * (int32_t) (n_args - ARG_REGS_SZ - 1)), reg});
+    scratch_release(ctx, reg);
+
     return GENERATOR_NOERR;
 }
 
-static generator_err call(Section* sect, Node* node)
+// Moves arguments from scratch registers to ARG_REGS, breaking cycles with RAX
+static void move_arguments(Ir* ir, Operand* arg_regs, size_t n_args)
+{
+    bool   is_moved[ARG_REGS_SZ] = {};
+    size_t n_left = 0;
+
+    for(size_t iter = 0; iter < n_args; iter++)
+    {
+        is_moved[iter] = is_register(arg_regs[iter], *ARG_REGS[iter]);
+        n_left += !is_moved[iter];
+    }
+
+    while(n_left)
+    {
+        bool is_progress = false;
+
+        for(size_t iter = 0; iter < n_args; iter++)
+        {
+            if(is_moved[iter])
+                continue;
+
+            bool is_blocked = false;
+            for(size_t other = 0; other < n_args; other++)
+            {
+                if(other != iter && !is_moved[other] && is_register(arg_regs[other], *ARG_REGS[iter]))
+                    is_blocked = true;
+            }
+
+            if(is_blocked)
+                continue;
+
+            ir_emit(ir, {MOV, *ARG_REGS[iter], arg_regs[iter]});
+            is_moved[iter] = true;
+            is_progress    = true;
+            n_left--;
+        }
+
+        if(is_progress)
+            continue;
+
+        for(size_t iter = 0; iter < n_args; iter++)
+        {
+            if(!is_moved[iter])
+            {
+                ir_emit(ir, {MOV, RAX, arg_regs[iter]});
+                arg_regs[iter] = RAX;
+                break;
+            }
+        }
+    }
+}
+
+static generator_err call(Generator_context* ctx, Ir* ir, Node* node, Operand* dst)
 {
     assert(node);
-    assert(node->tok.type == TYPE_AUX && node->tok.val.aux == TOK_CALL);
+    assert(node_type(node) == TYPE_AUX && node_aux(node) == TOK_CALL);
 
-    if(node->left->tok.type != TYPE_ID)
-        format_error("Left descendant of call is not function", &node->left->tok);
+    if(node_type(node_left(node)) != TYPE_ID)
+        format_error("Left descendant of call is not function", node_left(node));
 
     Symbol   sym       = {};
     uint64_t sym_index = 0;
-    if(symtable_find(SYMTABLE, node->left->tok.val.name, &sym, &sym_index) != 0)
-        semantic_error("Function wasn't defined", &node->left->tok);
+    if(symtable_find(ctx->symtable, node_name(ctx->tree, node_left(node)), &sym, &sym_index) != 0)
+        semantic_error("Function wasn't defined", node_left(node));
 
     if(sym.type != SYMBOL_TYPE_FUNCTION)
-        semantic_error("Call of non-function object", &node->left->tok);
+        semantic_error("Call of non-function object", node_left(node));
 
     if(strcmp(MAIN_STD_NAME, sym.id) == 0)
-        semantic_error("'main' can't be called", &node->left->tok);
+        semantic_error("'main' can't be called", node_left(node));
         
-    if((sym.func.n_args == 0 && node->right) || (sym.func.n_args > 0 && !node->right))
-        semantic_error("Wrong amount of arguments", &node->left->tok);
-    
-    if(node->right)
-        PASS$(!call_argument(sect, node->right, sym.func.n_args), return GENERATOR_PASS_ERROR; );
-    
-    if(LOCALTABLE->offset_top % 16)
-        encode(&sect->buffer, {SUB, RSP, IMM32(0x8)});
-    
-    encode(&sect->buffer, {XOR, RAX, RAX});
-    encode(&sect->buffer, {CALL, IMM32(0x0), {}});
-
-    Reloc reloc = {.dst_section_descriptor = sect->descriptor,
-                   .dst_offset = sect->buffer.pos - sizeof(int32_t),
-                   .dst_init_val = - (int32_t) sizeof(int32_t),
-                   .src_nametable_index = sym_index,
-                  };
-    
-    relocations_insert(RELOCATIONS, reloc);
+    if((sym.func.n_args == 0 && node_right(node)) || (sym.func.n_args > 0 && !node_right(node)))
+        semantic_error("Wrong amount of arguments", node_left(node));
+
+    // Scratch registers are caller-saved
+    uint32_t saved = ctx->scratch_used;
+    for(int iter = 0; iter < SCRATCH_SZ; iter++)
+    {
+        if(saved & (1u << iter))
+            stack_push(ctx, ir, *SCRATCH[iter]);
+    }
+    ctx->scratch_used = 0;
+
+    // Frame is aligned by 16 in prologue, so only pushed qwords and stack arguments
+    // (right above return address) may need padding
+    int32_t n_stack_args = (sym.func.n_args > ARG_REGS_SZ) ? (int32_t) (sym.func.n_args - ARG_REGS_SZ) : 0;
+    int32_t padding      = (ctx->stack_depth + n_stack_args) % 2;
+    int32_t reserved     = n_stack_args + padding;
+
+    if(reserved)
+    {
+        ir_emit(ir, {SUB, RSP, IMM32(8 * reserved)});
+        ctx->stack_depth += reserved;
+    }
+
+    Operand arg_regs[ARG_REGS_SZ] = {};
+    if(node_right(node))
+        PASS$(!call_argument(ctx, ir, node_right(node), sym.func.n_args, arg_regs), return GENERATOR_PASS_ERROR; );
 
-    if(LOCALTABLE->offset_top % 16)
-        encode(&sect->buffer, {ADD, RSP, IMM32(0x8)});
+    move_arguments(ir, arg_regs, sym.func.n_args < ARG_REGS_SZ ? sym.func.n_args : ARG_REGS_SZ);
+    ctx->scratch_used = 0;
 
-    if(sym.func.n_args > 6)
-        encode(&sect->buffer, {ADD, RSP, IMM32(8 * (int32_t) (sym.func.n_args - 6))});
+    ir_emit(ir, {XOR, RAX, RAX});
+    ir_emit_reloc(ir, {CALL, IMM32(0x0), {}}, sym_index, 0);
+
+    if(reserved)
+    {
+        ir_emit(ir, {ADD, RSP, IMM32(8 * reserved)});
+        ctx->stack_depth -= reserved;
+    }
+
+    for(int iter = SCRATCH_SZ - 1; iter >= 0; iter--)
+    {
+        if(saved & (1u << iter))
+            stack_pop(ctx, ir, *SCRATCH[iter]);
+    }
+    ctx->scratch_used = saved;
 
-    encode(&sect->buffer, {PUSH, RAX, {}});
+    *dst = scratch_alloc(ctx, *dst);
+    ir_emit(ir, {MOV, *dst, RAX});
     
     return GENERATOR_NOERR;
 }
 
-static generator_err expression(Section* sect, Node* node)
+// Evaluates expression in scratch register 'dst', initial value of 'dst' is a preferred register
+static generator_err expression(Generator_context* ctx, Ir* ir, Node* node, Operand* dst)
 {
-    assert(node);
+    assert(node && dst);
 
-    if(node->tok.type == TYPE_NUMBER)
+    if(node_type(node) == TYPE_NUMBER)
     {
-        PASS$(!number(sect, node), return GENERATOR_PASS_ERROR; );
+        PASS$(!number(ctx, ir, node, dst), return GENERATOR_PASS_ERROR; );
         return GENERATOR_NOERR;
     }
     
-    if(node->tok.type == TYPE_ID)
+    if(node_type(node) == TYPE_ID)
     {
-        PASS$(!variable(sect, node), return GENERATOR_PASS_ERROR; );
+        PASS$(!variable(ctx, ir, node, dst), return GENERATOR_PASS_ERROR; );
         return GENERATOR_NOERR;
     }
 
-    if(node->tok.type == TYPE_EMBED)
+    if(node_type(node) == TYPE_EMBED)
     {
-        format_error("Embedded functions are not supported in ELF compilator", &node->tok);
+        format_error("Embedded functions are not supported in ELF compilator", node);
     }
 
-    if(node->tok.type == TYPE_AUX && node->tok.val.aux == TOK_CALL)
+    if(node_type(node) == TYPE_AUX && node_aux(node) == TOK_CALL)
     {
-        PASS$(!call(sect, node), return GENERATOR_PASS_ERROR; );
+        PASS$(!call(ctx, ir, node, dst), return GENERATOR_PASS_ERROR; );
         return GENERATOR_NOERR;
     }
 
-    if(node->left)
-    {
-        PASS$(!expression(sect, node->left), return GENERATOR_PASS_ERROR; );
-    }
-    if(node->right)
+    if(node_type(node) == TYPE_OP)
     {
-        PASS$(!expression(sect, node->right), return GENERATOR_PASS_ERROR; );
-    }
-    if(node->tok.type == TYPE_OP)
-    {
-        PASS$(!oper(sect, node), return GENERATOR_PASS_ERROR; );
+        PASS$(!oper(ctx, ir, node, dst), return GENERATOR_PASS_ERROR; );
         return GENERATOR_NOERR;
     }
         
-    semantic_error("Token can't be used in expression", &node->tok);
+    semantic_error("Token can't be used in expression", node);
 
     return GENERATOR_NOERR;
 }
 
-static generator_err conditional(Node* node)
+// Conditional jump taken if 'op' holds, or if it doesn't hold when 'is_inverted'
+static Mnemonic branch(token_operators op, bool is_inverted)
+{
+    switch(op)
+    {
+        case TOK_EQ:    return is_inverted ? JNE : JE;
+        case TOK_NEQ:   return is_inverted ? JE  : JNE;
+        case TOK_GEQ:   return is_inverted ? JL  : JGE;
+        case TOK_LEQ:   return is_inverted ? JG  : JLE;
+        case TOK_GREAT: return is_inverted ? JLE : JG;
+        case TOK_LESS:  return is_inverted ? JGE : JL;
+        case TOK_ADD:   case TOK_SUB:   case TOK_MUL:    case TOK_DIV:   case TOK_POWER:
+        case TOK_SHIFT: case TOK_AND:   case TOK_OR:     case TOK_NOT:
+        case TOK_LRPAR: case TOK_RRPAR: case TOK_ASSIGN: case TOK_LFPAR: case TOK_RFPAR:
+        case TOK_LQPAR: case TOK_RQPAR: case TOK_COMMA:  case TOK_SEMICOLON:
+        default:
+            assert(0 && "Operator is not relational");
+            return INVALID_INSTR;
+    }
+}
+
+// Jumps to 'label' if condition value is equal to 'is_true'
+static generator_err condition(Generator_context* ctx, Ir* ir, Node* node, bool is_true, size_t label)
 {
     assert(node);
-    if(!node->left || !node->right || node->right->tok.type != TYPE_AUX || node->right->tok.val.aux != TOK_DECISION)
-        format_error("Conditional statement missing or wrong descendant", &node->tok);
 
-    uint64_t false_offset     = 0;
-    uint64_t end_offset       = 0;
-    uint64_t jmp_false_offset = 0;
-    uint64_t jmp_false_rip    = 0;
-    uint64_t jmp_end_offset   = 0;
-    uint64_t jmp_end_rip      = 0;
+    if(node_type(node) == TYPE_OP && !node_left(node) && node_right(node) && node_op(node) == TOK_NOT)
+        return condition(ctx, ir, node_right(node), !is_true, label);
 
-    PASS$(!expression(TEXT, node->left), return GENERATOR_PASS_ERROR; );
-    
-    encode(&TEXT->buffer, {POP, RAX, {}});
-    encode(&TEXT->buffer, {TEST, RAX, RAX});
+    // Right operand of logical operator is skipped if left one decides
+    if(node_type(node) == TYPE_OP && node_left(node) && node_right(node) &&
+       (node_op(node) == TOK_AND || node_op(node) == TOK_OR))
+    {
+        bool is_and = node_op(node) == TOK_AND;
+
+        if(is_and != is_true)
+        {
+            PASS$(!condition(ctx, ir, node_left(node),  is_true, label), return GENERATOR_PASS_ERROR; );
+            PASS$(!condition(ctx, ir, node_right(node), is_true, label), return GENERATOR_PASS_ERROR; );
 
-    jmp_false_offset = TEXT->buffer.pos;
-    encode(&TEXT->buffer, {JE, IMM32(0xADDE), {}});
-    jmp_false_rip = TEXT->buffer.pos;
+            return GENERATOR_NOERR;
+        }
 
-    if(!node->right->left)
-        semantic_error("Conditional statement missing positive branch (no body statements)", &node->tok);
+        size_t skip_label = ir_label(ir);
 
-    PASS$(!statement(node->right->left), return GENERATOR_PASS_ERROR; );
+        PASS$(!condition(ctx, ir, node_left(node), !is_true, skip_label), return GENERATOR_PASS_ERROR; );
+        PASS$(!condition(ctx, ir, node_right(node), is_true, label),      return GENERATOR_PASS_ERROR; );
 
-    jmp_end_offset = TEXT->buffer.pos;
-    encode(&TEXT->buffer, {JMP, IMM32(0xADDE)});
-    jmp_end_rip = TEXT->buffer.pos;
+        ir_bind(ir, skip_label);
+
+        return GENERATOR_NOERR;
+    }
+
+    // Relational operator is compared right before jump, without 0/1 value
+    if(node_type(node) == TYPE_OP && node_left(node) && node_right(node) && is_relational(node_op(node)))
+    {
+        Operand         reg    = {};
+        token_operators cmp_op = node_op(node);
 
-    false_offset = TEXT->buffer.pos;
+        PASS$(!oper(ctx, ir, node, &reg, &cmp_op), return GENERATOR_PASS_ERROR; );
+        scratch_release(ctx, reg);
 
-    if(node->right->right)
-        PASS$(!statement(node->right->right), return GENERATOR_PASS_ERROR; );
+        ir_emit_jump(ir, branch(cmp_op, !is_true), label);
 
-    end_offset = TEXT->buffer.pos;
+        return GENERATOR_NOERR;
+    }
 
-    buffer_seek(&TEXT->buffer, jmp_false_offset);
-    encode(&TEXT->buffer, {JE, IMM32((int32_t) (false_offset - jmp_false_rip)), {}});
+    Operand cond = {};
+    PASS$(!expression(ctx, ir, node, &cond), return GENERATOR_PASS_ERROR; );
 
-    buffer_seek(&TEXT->buffer, jmp_end_offset);
-    encode(&TEXT->buffer, {JMP, IMM32((int32_t) (end_offset - jmp_end_rip)), {}});
+    ir_emit(ir, {TEST, cond, cond});
+    scratch_release(ctx, cond);
 
-    buffer_rewind(&TEXT->buffer);
+    ir_emit_jump(ir, is_true ? JNE : JE, label);
 
     return GENERATOR_NOERR;
 }
 
-static generator_err cycle(Node* node)
+static generator_err conditional(Generator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_KEYWORD && node->tok.val.key == TOK_WHILE);
+    if(!node_left(node) || !node_right(node) ||
+       node_type(node_right(node)) != TYPE_AUX || node_aux(node_right(node)) != TOK_DECISION)
+        format_error("Conditional statement missing or wrong descendant", node);
 
-    if(!node->left || !node->right)
-        format_error("Cycle statement missing or wrong descendant", &node->tok);
+    size_t false_label = ir_label(ctx->ir);
+    size_t end_label   = ir_label(ctx->ir);
 
-    uint64_t begin_offset     = 0;
-    uint64_t cond_offset      = 0;
-    uint64_t jmp_begin_offset = 0;
-    uint64_t jmp_begin_rip    = 0;
-    uint64_t jmp_cond_offset  = 0;
-    uint64_t jmp_cond_rip     = 0;
+    PASS$(!condition(ctx, ctx->ir, node_left(node), false, false_label), return GENERATOR_PASS_ERROR; );
 
-    jmp_begin_offset = TEXT->buffer.pos;
-    encode(&TEXT->buffer, {JMP, IMM32(0xADDE)});
-    jmp_begin_rip    = TEXT->buffer.pos;
+    if(!node_left(node_right(node)))
+        semantic_error("Conditional statement missing positive branch (no body statements)", node);
 
-    begin_offset = TEXT->buffer.pos;
+    PASS$(!statement(ctx, node_left(node_right(node))), return GENERATOR_PASS_ERROR; );
 
-    PASS$(!statement(node->right), return GENERATOR_PASS_ERROR; );
+    ir_emit_jump(ctx->ir, JMP, end_label);
+    ir_bind(ctx->ir, false_label);
 
-    cond_offset = TEXT->buffer.pos;
+    if(node_right(node_right(node)))
+        PASS$(!statement(ctx, node_right(node_right(node))), return GENERATOR_PASS_ERROR; );
 
-    PASS$(!expression(TEXT, node->left), return GENERATOR_PASS_ERROR; );
+    ir_bind(ctx->ir, end_label);
 
-    encode(&TEXT->buffer, {POP, RAX, {}});
-    encode(&TEXT->buffer, {TEST, RAX, RAX});
+    return GENERATOR_NOERR;
+}
 
-    jmp_cond_offset = TEXT->buffer.pos;
-    encode(&TEXT->buffer, {JNE, IMM32(0xADDE)});
-    jmp_cond_rip    = TEXT->buffer.pos;
+static generator_err cycle(Generator_context* ctx, Node* node)
+{
+    assert(node);
+    assert(node_type(node) == TYPE_KEYWORD && node_key(node) == TOK_WHILE);
 
-    buffer_seek(&TEXT->buffer, jmp_begin_offset);
-    encode(&TEXT->buffer, {JMP, IMM32((int32_t) (cond_offset - jmp_begin_rip)), {}});
+    if(!node_left(node) || !node_right(node))
+        format_error("Cycle statement missing or wrong descendant", node);
 
-    buffer_seek(&TEXT->buffer, jmp_cond_offset);
-    encode(&TEXT->buffer, {JNE, IMM32((int32_t) (begin_offset - jmp_cond_rip)), {}});
+    size_t begin_label = ir_label(ctx->ir);
+    size_t cond_label  = ir_label(ctx->ir);
 
-    buffer_rewind(&TEXT->buffer);
+    ir_emit_jump(ctx->ir, JMP, cond_label);
+    ir_bind(ctx->ir, begin_label);
+
+    PASS$(!statement(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
+
+    ir_bind(ctx->ir, cond_label);
+
+    PASS$(!condition(ctx, ctx->ir, node_left(node), true, begin_label), return GENERATOR_PASS_ERROR; );
 
     return GENERATOR_NOERR;
 }
 
-static generator_err terminational(Node* node)
+static generator_err terminational(Generator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_KEYWORD && node->tok.val.key == TOK_RETURN);
+    assert(node_type(node) == TYPE_KEYWORD && node_key(node) == TOK_RETURN);
 
-    if(node->left || !node->right)
-        format_error("Terminational statement missing or wrong descendant", &node->tok);
+    if(node_left(node) || !node_right(node))
+        format_error("Terminational statement missing or wrong descendant", node);
 
-    PASS$(!expression(TEXT, node->right), return GENERATOR_PASS_ERROR; );
+    Operand value = {};
+    PASS$(!expression(ctx, ctx->ir, node_right(node), &value), return GENERATOR_PASS_ERROR; );
 
-    encode(&TEXT->buffer, {POP, RAX, {}});
+    ir_emit(ctx->ir, {MOV, RAX, value});
+    scratch_release(ctx, value);
 
-    encode(&TEXT->buffer, {MOV, RSP, RBP});
-    encode(&TEXT->buffer, {POP, RBP, {}});
-    encode(&TEXT->buffer, {RET, {},  {}});
+    for(int iter = 0; iter < CALLEE_SAVED_SZ; iter++)
+    {
+        if(ctx->callee_used & (1u << iter))
+            ir_emit(ctx->ir, {MOV, *CALLEE_SAVED[iter], MEM(0, {}, RBP, ctx->callee_slots[iter])});
+    }
+
+    ir_emit(ctx->ir, {MOV, RSP, RBP});
+    ir_emit(ctx->ir, {POP, RBP, {}});
+    ir_emit(ctx->ir, {RET, {},  {}});
 
     return GENERATOR_NOERR;
 }
 
-static generator_err assignment(Node* node)
+static generator_err assignment(Generator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_OP && node->tok.val.op == TOK_ASSIGN);
+    assert(node_type(node) == TYPE_OP && node_op(node) == TOK_ASSIGN);
 
     LOG$("Entered function");
     
-    if(!node->left)
-        format_error("Assignment requires lvalue", &node->tok);
+    if(!node_left(node))
+        format_error("Assignment requires lvalue", node);
 
-    if(node->left->tok.type != TYPE_ID)
-        format_error("Assignment requires identifier as lvalue", &node->left->tok);
+    if(node_type(node_left(node)) != TYPE_ID)
+        format_error("Assignment requires identifier as lvalue", node_left(node));
 
     bool is_const = false;
-    if(node->left->left)
+    if(node_left(node_left(node)))
     {
-        if(node->left->left->tok.type != TYPE_KEYWORD || node->left->left->tok.val.key != TOK_CONST)
-            format_error("Variable has wrong left descendant ('const' expected)", &node->left->left->tok);
+        if(node_type(node_left(node_left(node))) != TYPE_KEYWORD || node_key(node_left(node_left(node))) != TOK_CONST)
+            format_error("Variable has wrong left descendant ('const' expected)", node_left(node_left(node)));
 
         is_const = true;          
     }
@@ -501,12 +1019,13 @@ static generator_err assignment(Node* node)
     Local_var var = {};
     bool      is_global = false;
 
-    if(symtable_find(SYMTABLE, node->left->tok.val.name, &sym, &sym_index) == 0 && sym.type == SYMBOL_TYPE_VARIABLE)
+    if(symtable_find(ctx->symtable, node_name(ctx->tree, node_left(node)), &sym, &sym_index) == 0 &&
+       sym.type == SYMBOL_TYPE_VARIABLE)
     {
         LOG$("Global variable found");
         is_global = true;
     }
-    else if(localtable_find(LOCALTABLE, node->left->tok.val.name, &var) == 0)
+    else if(localtable_find(ctx->localtable, node_name(ctx->tree, node_left(node)), &var) == 0)
     {
         LOG$("Local variable found");
         is_global = false;
@@ -516,180 +1035,178 @@ static generator_err assignment(Node* node)
         LOG$("Declaring new local variable");
 
         if(is_global && sym.type == SYMBOL_TYPE_FUNCTION)
-            semantic_error("Cannot declare variable with function name", &node->left->tok);
+            semantic_error("Cannot declare variable with function name", node_left(node));
         
         int32_t shift = 0;
-        if(node->left->right)
+        if(node_right(node_left(node)))
         {
-            if(node->left->right->tok.type != TYPE_NUMBER)
-                semantic_error("Size of variable is not compile-time evaluatable", &node->left->tok);
+            if(node_type(node_right(node_left(node))) != TYPE_NUMBER)
+                semantic_error("Size of variable is not compile-time evaluatable", node_left(node));
 
-            shift = (int32_t) node->left->right->tok.val.num;
+            shift = (int32_t) node_num(ctx->tree, node_right(node_left(node)));
         }
 
         if(shift < 0)
-            semantic_error("Size of variable is negative", &node->left->tok);
+            semantic_error("Size of variable is negative", node_left(node));
 
-        var = {.id = node->left->tok.val.name,
+        var = {.id = node_name(ctx->tree, node_left(node)),
                .size = (size_t) shift + 1,
                .is_const = is_const
               };
-    
-        encode(&TEXT->buffer, {SUB, RSP, IMM32((int32_t) var.size * 8)});
-        localtable_allocate(LOCALTABLE, &var);
 
-        PASS$(!expression(TEXT, node->right), return GENERATOR_PASS_ERROR; );
-        encode(&TEXT->buffer, {POP, MEM(0x0, {}, RBP, var.offset + shift * 8), {}});
+        local_register(ctx, &var);
+        localtable_allocate(ctx->localtable, &var);
+
+        Operand value = {};
+        PASS$(!expression(ctx, ctx->ir, node_right(node), &value), return GENERATOR_PASS_ERROR; );
+
+        if(var.is_register)
+            ir_emit(ctx->ir, {MOV, REG(var.reg), value});
+        else
+            ir_emit(ctx->ir, {MOV, MEM(0x0, {}, RBP, var.offset + shift * 8), value});
+
+        scratch_release(ctx, value);
 
         return GENERATOR_NOERR;
     }
 
     if(is_const)
-        semantic_error("'const' specifier in assignment to declared variable", &node->left->tok);
+        semantic_error("'const' specifier in assignment to declared variable", node_left(node));
 
     if((is_global && sym.var.is_const) || (!is_global && var.is_const))
-        semantic_error("Assignment to 'const' variable", &node->left->tok);
+        semantic_error("Assignment to 'const' variable", node_left(node));
 
-    PASS$(!expression(TEXT, node->right), return GENERATOR_PASS_ERROR; );
+    Operand value = {};
+    PASS$(!expression(ctx, ctx->ir, node_right(node), &value), return GENERATOR_PASS_ERROR; );
 
-    Operand index_reg = {};
-    uint8_t scale     = 0;
-
-    if(node->left->right)
+    Location loc = {};
+    if(leaf_location(ctx, node_left(node), &loc))
     {
-        PASS$(!expression(TEXT, node->left->right), return GENERATOR_PASS_ERROR; );
-        encode(&TEXT->buffer, {POP, RCX, {}});
+        emit_loc(ctx->ir, {MOV, loc.op, value}, &loc);
+        scratch_release(ctx, value);
 
-        index_reg = RCX;
-        scale     = 8;
+        return GENERATOR_NOERR;
     }
 
+    Operand index = {};
+    PASS$(!expression(ctx, ctx->ir, node_right(node_left(node)), &index), return GENERATOR_PASS_ERROR; );
+
     if(is_global)
     {
-        encode(&TEXT->buffer, {LEA, RAX, MEM(0, {}, {}, 0x0)});
-
-        Reloc reloc = {.dst_section_descriptor = TEXT->descriptor,
-                       .dst_offset = TEXT->buffer.pos - sizeof(int32_t),
-                       .dst_init_val = - (int32_t) sizeof(int32_t),
-                       .src_nametable_index = sym_index,
-                      };
-        
-        relocations_insert(RELOCATIONS, reloc);
+        loc = {.op = MEM(0, {}, {}, 0x0), .is_reloc = true, .sym_index = sym_index};
+        emit_loc(ctx->ir, {LEA, RAX, loc.op}, &loc);
 
-        encode(&TEXT->buffer, {POP, MEM(scale, index_reg, RAX, 0), {}});
+        ir_emit(ctx->ir, {MOV, MEM(8, index, RAX, 0), value});
     }
     else
     {
-        encode(&TEXT->buffer, {POP, MEM(scale, index_reg, RBP, var.offset), {}}); 
+        ir_emit(ctx->ir, {MOV, MEM(8, index, RBP, var.offset), value}); 
     }
 
+    scratch_release(ctx, index);
+    scratch_release(ctx, value);
+
     return GENERATOR_NOERR;
 }
 
-static generator_err statement(Node* node)
+static generator_err statement(Generator_context* ctx, Node* node)
 {
     assert(node);
 
-    if(node->tok.type != TYPE_AUX || node->tok.val.aux != TOK_STATEMENT)
-        format_error("'statement' expected", &node->tok);
+    if(node_type(node) != TYPE_AUX || node_aux(node) != TOK_STATEMENT)
+        format_error("'statement' expected", node);
 
-    if(node->left)
-        PASS$(!statement(node->left), return GENERATOR_PASS_ERROR; );
+    if(node_left(node))
+        PASS$(!statement(ctx, node_left(node)), return GENERATOR_PASS_ERROR; );
 
-    if(node->right->tok.type == TYPE_KEYWORD)
+    if(node_type(node_right(node)) == TYPE_KEYWORD)
     {
-        if(node->right->tok.val.key == TOK_IF)
+        if(node_key(node_right(node)) == TOK_IF)
         {
-            PASS$(!conditional(node->right), return GENERATOR_PASS_ERROR; );
+            PASS$(!conditional(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
             return GENERATOR_NOERR;
         }
-        else if(node->right->tok.val.key == TOK_WHILE)
+        else if(node_key(node_right(node)) == TOK_WHILE)
         {
-            PASS$(!cycle(node->right), return GENERATOR_PASS_ERROR; );
+            PASS$(!cycle(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
             return GENERATOR_NOERR;
         }
-        else if(node->right->tok.val.key == TOK_RETURN)
+        else if(node_key(node_right(node)) == TOK_RETURN)
         {
-            PASS$(!terminational(node->right), return GENERATOR_PASS_ERROR; );
+            PASS$(!terminational(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
             return GENERATOR_NOERR;
         }
     }
 
-    if(node->right->tok.type == TYPE_OP && node->right->tok.val.op == TOK_ASSIGN)
+    if(node_type(node_right(node)) == TYPE_OP && node_op(node_right(node)) == TOK_ASSIGN)
     {
-        PASS$(!assignment(node->right), return GENERATOR_PASS_ERROR; );
+        PASS$(!assignment(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
         return GENERATOR_NOERR;
     }
 
-    // plain expression, remove result from stack
-    PASS$(!expression(TEXT, node->right), return GENERATOR_PASS_ERROR; );
-    encode(&TEXT->buffer, {POP, RAX, {}});
+    // plain expression, result is dropped
+    Operand value = {};
+    PASS$(!expression(ctx, ctx->ir, node_right(node), &value), return GENERATOR_PASS_ERROR; );
+    scratch_release(ctx, value);
 
     return GENERATOR_NOERR;
 }
 
-static generator_err parameter(Node* node, size_t n_params)
+static generator_err parameter(Generator_context* ctx, Node* node, size_t n_params)
 {
     assert(node);
     
-    if(node->tok.type != TYPE_AUX || node->tok.val.aux != TOK_PARAMETER)
-        format_error("'parameter' expected", &node->tok);
+    if(node_type(node) != TYPE_AUX || node_aux(node) != TOK_PARAMETER)
+        format_error("'parameter' expected", node);
 
-    if(node->left)
-        PASS$(!parameter(node->left, n_params - 1), return GENERATOR_PASS_ERROR; );
+    if(node_left(node))
+        PASS$(!parameter(ctx, node_left(node), n_params - 1), return GENERATOR_PASS_ERROR; );
     
-    if(node->right->tok.type != TYPE_ID)
-        format_error("Parameter is not id", &node->right->tok);
+    if(node_type(node_right(node)) != TYPE_ID)
+        format_error("Parameter is not id", node_right(node));
 
-    Local_var param = {.id = node->right->tok.val.name};
+    Local_var param = {.id = node_name(ctx->tree, node_right(node))};
 
-    if(node->right->right)
-        format_error("Parameter cannot be array", &node->right->tok);
+    if(node_right(node_right(node)))
+        format_error("Parameter cannot be array", node_right(node));
     
     param.size = 1;
 
-    if(node->right->left)
+    if(node_left(node_right(node)))
     {
-        if(node->right->left->tok.type != TYPE_KEYWORD || node->right->left->tok.val.key != TOK_CONST)
-            format_error("Variable has wrong left descendant ('const' expected)", &node->right->tok);
+        if(node_type(node_left(node_right(node))) != TYPE_KEYWORD ||
+           node_key(node_left(node_right(node))) != TOK_CONST)
+            format_error("Variable has wrong left descendant ('const' expected)", node_right(node));
         
         param.is_const = true;
     }
 
-    if(symtable_find(SYMTABLE, param.id) == 0 || localtable_find(LOCALTABLE, param.id) == 0)
-        semantic_error("Variable redeclaration", &node->right->tok);
+    if(symtable_find(ctx->symtable, param.id) == 0 || localtable_find(ctx->localtable, param.id) == 0)
+        semantic_error("Variable redeclaration", node_right(node));
+
+    local_register(ctx, &param);
 
-    switch(n_params)
+    if(n_params > ARG_REGS_SZ)
     {
-        case 6:
-            encode(&TEXT->buffer, {PUSH, R9, {}});
-            break;
-        case 5:
-            encode(&TEXT->buffer, {PUSH, R8, {}});
-            break;
-        case 4:
-            encode(&TEXT->buffer, {PUSH, RCX, {}});
-            break;
-        case 3:
-            encode(&TEXT->buffer, {PUSH, RDX, {}});
-            break;
-        case 2:
-            encode(&TEXT->buffer, {PUSH, RSI, {}});
-            break;
-        case 1:
-            encode(&TEXT->buffer, {PUSH, RDI, {}});
-            break;
-        default:
-            PASS$(!localtable_set_parameter(LOCALTABLE, &param), return GENERATOR_PASS_ERROR; );
-            return GENERATOR_NOERR;
+        PASS$(!localtable_set_parameter(ctx->localtable, &param), return GENERATOR_PASS_ERROR; );
+
+        if(param.is_register)
+            ir_emit(ctx->ir, {MOV, REG(param.reg), MEM(0, {}, RBP, param.offset)});
+
+        return GENERATOR_NOERR;
     }
 
-    PASS$(!localtable_allocate(LOCALTABLE, &param), return GENERATOR_PASS_ERROR; );
+    if(param.is_register)
+        ir_emit(ctx->ir, {MOV, REG(param.reg), *ARG_REGS[n_params - 1]});
+    else
+        ir_emit(ctx->ir, {PUSH, *ARG_REGS[n_params - 1], {}});
+
+    PASS$(!localtable_allocate(ctx->localtable, &param), return GENERATOR_PASS_ERROR; );
 
     return GENERATOR_NOERR;
 }
 
-static generator_err collect_stdlib_functions(Dependencies* deps)
+static generator_err collect_stdlib_functions(Generator_context* ctx, Dependencies* deps)
 {
     assert(deps);
 
@@ -702,177 +1219,220 @@ static generator_err collect_stdlib_functions(Dependencies* deps)
                       .func = (Function) {.n_args = dep.n_args}
                      };
 
-        ASSERT$(!symtable_insert(SYMTABLE, sym), GENERATOR_PASS_ERROR, return GENERATOR_PASS_ERROR; );
+        ASSERT$(!symtable_insert(ctx->symtable, sym), GENERATOR_PASS_ERROR, return GENERATOR_PASS_ERROR; );
     }
 
     return GENERATOR_NOERR;
 }
 
-static generator_err collect_functions(Node* node)
+static generator_err collect_functions(Generator_context* ctx, Node* node)
 {
     assert(node);
 
-    if(node->left)
-        PASS$(!collect_functions(node->left), return GENERATOR_PASS_ERROR; );
+    if(node_left(node))
+        PASS$(!collect_functions(ctx, node_left(node)), return GENERATOR_PASS_ERROR; );
     
-    if(node->tok.type != TYPE_AUX || node->tok.val.aux != TOK_STATEMENT)
-        format_error("'statement' expected (first line)", &node->tok);
+    if(node_type(node) != TYPE_AUX || node_aux(node) != TOK_STATEMENT)
+        format_error("'statement' expected (first line)", node);
     
-    if(!node->right)
-        format_error("Missing 'statement' body (first line)", &node->tok);
+    if(!node_right(node))
+        format_error("Missing 'statement' body (first line)", node);
 
-    if(node->right->tok.type == TYPE_OP && node->right->tok.val.op == TOK_ASSIGN)
+    if(node_type(node_right(node)) == TYPE_OP && node_op(node_right(node)) == TOK_ASSIGN)
         return GENERATOR_NOERR;
 
-    if(node->right->tok.type != TYPE_AUX || node->right->tok.val.aux != TOK_DEFINE)
-        format_error("'define' expected", &node->right->tok);
+    if(node_type(node_right(node)) != TYPE_AUX || node_aux(node_right(node)) != TOK_DEFINE)
+        format_error("'define' expected", node_right(node));
     
-    if(!node->right->left)
-        format_error("'define' missing 'function'", &node->right->tok);
+    if(!node_left(node_right(node)))
+        format_error("'define' missing 'function'", node_right(node));
 
-    if(node->right->left->tok.type != TYPE_AUX || node->right->left->tok.val.aux != TOK_FUNCTION)
-        format_error("'function' expected", &node->right->left->tok);
+    if(node_type(node_left(node_right(node))) != TYPE_AUX || node_aux(node_left(node_right(node))) != TOK_FUNCTION)
+        format_error("'function' expected", node_left(node_right(node)));
 
     Symbol sym = {.type = SYMBOL_TYPE_FUNCTION};
 
-    Node* ptr = node->right->left->right;
+    Node* ptr = node_right(node_left(node_right(node)));
 
     while(ptr)
     {
-        if(ptr->tok.type != TYPE_AUX || ptr->tok.val.aux != TOK_PARAMETER)
-            format_error("'parameter' expected", &ptr->tok);
+        if(node_type(ptr) != TYPE_AUX || node_aux(ptr) != TOK_PARAMETER)
+            format_error("'parameter' expected", ptr);
         
         sym.func.n_args++;
 
-        ptr = ptr->left;
+        ptr = node_left(ptr);
     }
 
-    ptr = node->right->left->left;
+    ptr = node_left(node_left(node_right(node)));
     if(!ptr)
-        format_error("Function name is missing", &node->right->left->tok);
+        format_error("Function name is missing", node_left(node_right(node)));
 
-    if(ptr->tok.type != TYPE_ID)
-        format_error("Function name is not identifier", &ptr->tok);
+    if(node_type(ptr) != TYPE_ID)
+        format_error("Function name is not identifier", ptr);
     
-    sym.id = ptr->tok.val.name;
+    sym.id = node_name(ctx->tree, ptr);
 
-    if(symtable_find(SYMTABLE, sym.id) == 0)
-        semantic_error("Function redefinition", &ptr->tok);
+    if(symtable_find(ctx->symtable, sym.id) == 0)
+        semantic_error("Function redefinition", ptr);
 
-    PASS$(!symtable_insert(SYMTABLE, sym), return GENERATOR_PASS_ERROR; );
+    PASS$(!symtable_insert(ctx->symtable, sym), return GENERATOR_PASS_ERROR; );
         
     return GENERATOR_NOERR;
 }
 
-static generator_err generate_funtions(Node* node)
+static generator_err generate_funtions(Generator_context* ctx, Node* node)
 {
     assert(node);
 
-    if(node->left)
-        PASS$(!generate_funtions(node->left), return GENERATOR_PASS_ERROR; );
+    if(node_left(node))
+        PASS$(!generate_funtions(ctx, node_left(node)), return GENERATOR_PASS_ERROR; );
     
-    if(node->right->tok.type != TYPE_AUX || node->right->tok.val.aux != TOK_DEFINE)
+    if(node_type(node_right(node)) != TYPE_AUX || node_aux(node_right(node)) != TOK_DEFINE)
         return GENERATOR_NOERR;
     
-    localtable_clean(LOCALTABLE);
+    localtable_clean(ctx->localtable);
+    ir_clean(ctx->ir);
+    ctx->scratch_used = 0;
+    ctx->stack_depth  = 0;
 
-    char* func_name = node->right->left->left->tok.val.name;
+    char* func_name = node_name(ctx->tree, node_left(node_left(node_right(node))));
 
     Symbol   sym = {};
     uint64_t sym_index = {};
-    assert(!symtable_find(SYMTABLE, func_name, &sym, &sym_index));
+    assert(!symtable_find(ctx->symtable, func_name, &sym, &sym_index));
+
+    Symbol* ptr = &ctx->symtable->buffer[sym_index];
 
-    Symbol* ptr = &SYMTABLE->buffer[sym_index];
-    ptr->offset             = TEXT->buffer.pos;
-    ptr->section_descriptor = TEXT->descriptor;
+    PASS$(!regalloc_function(ctx->regalloc, ctx->symtable, ctx->tree, node_right(node), CALLEE_SAVED_SZ,
+                             &ctx->callee_used),
+          return GENERATOR_PASS_ERROR; );
 
-    encode(&TEXT->buffer, {PUSH, RBP, {}});
-    encode(&TEXT->buffer, {MOV, RBP, RSP});
+    ir_emit(ctx->ir, {PUSH, RBP, {}});
+    ir_emit(ctx->ir, {MOV, RBP, RSP});
+
+    for(int iter = 0; iter < CALLEE_SAVED_SZ; iter++)
+    {
+        if(!(ctx->callee_used & (1u << iter)))
+            continue;
+
+        ir_emit(ctx->ir, {PUSH, *CALLEE_SAVED[iter], {}});
+        ctx->callee_slots[iter] = localtable_reserve(ctx->localtable, 1);
+    }
 
     size_t n_param = sym.func.n_args;
-    Node* param = node->right->left->right;
+    Node* param = node_right(node_left(node_right(node)));
     if(param)
-        PASS$(!parameter(param, n_param), return GENERATOR_PASS_ERROR; );
+        PASS$(!parameter(ctx, param, n_param), return GENERATOR_PASS_ERROR; );
+
+    // Frame of locals is allocated once, its size is known after body is generated
+    size_t  frame_instr = ctx->ir->buffer_sz;
+    int32_t pushed      = -ctx->localtable->offset_top;
+    ir_emit(ctx->ir, {SUB, RSP, IMM32(0)});
 
-    Node* stmnt = node->right->right;
+    Node* stmnt = node_right(node_right(node));
     if(stmnt)
-        PASS$(!statement(stmnt), return GENERATOR_PASS_ERROR; );
+        PASS$(!statement(ctx, stmnt), return GENERATOR_PASS_ERROR; );
 
-    ptr->s_size = TEXT->buffer.pos - ptr->offset;
+    int32_t frame_sz = (-ctx->localtable->offset_top + 15) / 16 * 16 - pushed;
+    if(frame_sz)
+        ctx->ir->buffer[frame_instr].instr.op2 = IMM32(frame_sz);
+    else
+        ctx->ir->buffer[frame_instr].type = IR_NOP;
+
+    if(node_type(node_right(stmnt)) != TYPE_KEYWORD || node_key(node_right(stmnt)) != TOK_RETURN)
+        semantic_error("Missing terminational", node_left(node_left(node_right(node))));
+
+    ptr->offset             = ctx->text->buffer.pos;
+    ptr->section_descriptor = ctx->text->descriptor;
+
+    if(ctx->peephole)
+        PASS$(!peephole(ctx->ir, ctx->peephole), return GENERATOR_PASS_ERROR; );
+
+    Encode_stats enc_stats = {};
+    encode_stats(&enc_stats);
+
+    int lower_err = ir_lower(ctx->ir, ctx->text, ctx->relocations);
+    encode_stats(nullptr);
 
-    if(stmnt->right->tok.type != TYPE_KEYWORD || stmnt->right->tok.val.key != TOK_RETURN)
-        semantic_error("Missing terminational", &node->right->left->left->tok);
+    PASS$(!lower_err, return GENERATOR_PASS_ERROR; );
 
-    MSG$("Function `%s` local variables:", node->right->left->left->tok.val.name);
-    localtable_dump(LOCALTABLE);
+    ptr->s_size = ctx->text->buffer.pos - ptr->offset;
+
+    MSG$("Function `%s` code size: %lu bytes, %zu saved by short fields (disp8: %zu, imm8: %zu, rel8: %zu)",
+         node_name(ctx->tree, node_left(node_left(node_right(node)))), ptr->s_size,
+         enc_stats.saved, enc_stats.disp8, enc_stats.imm8, enc_stats.rel8);
+
+    MSG$("Function `%s` local variables:", node_name(ctx->tree, node_left(node_left(node_right(node)))));
+    localtable_dump(ctx->localtable);
 
     return GENERATOR_NOERR;
 }
 
-static generator_err declare_global(Node* node)
+static generator_err declare_global(Generator_context* ctx, Node* node)
 {
-    if(!node->left)
-        format_error("Assignment requires lvalue", &node->tok);
+    if(!node_left(node))
+        format_error("Assignment requires lvalue", node);
 
-    if(node->left->tok.type != TYPE_ID)
-        format_error("Assignment requires identifier as lvalue", &node->left->tok);
+    if(node_type(node_left(node)) != TYPE_ID)
+        format_error("Assignment requires identifier as lvalue", node_left(node));
 
-    // PASS$(!expression(INIT, node->right), return GENERATOR_PASS_ERROR; );
+    // PASS$(!expression(ctx, INIT, node_right(node)), return GENERATOR_PASS_ERROR; );
 
-    if(!node->right)
-        semantic_error("Global variable is not initialized", &node->left->  tok);
+    if(!node_right(node))
+        semantic_error("Global variable is not initialized", node_left(node));
 
-    if(node->right->tok.type != TYPE_NUMBER)
-        semantic_error("Global variable is not compile-time evaluatable", &node->left->tok);
+    if(node_type(node_right(node)) != TYPE_NUMBER)
+        semantic_error("Global variable is not compile-time evaluatable", node_left(node));
 
-    uint64_t value = (uint64_t) node->right->tok.val.num;
+    uint64_t value = (uint64_t) (int64_t) node_num(ctx->tree, node_right(node));
 
     bool is_const = false;
-    if(node->left->left)
+    if(node_left(node_left(node)))
     {
-        if(node->left->left->tok.type != TYPE_KEYWORD || node->left->left->tok.val.key != TOK_CONST)
-            format_error("Variable has wrong left descendant ('const' expected)", &node->left->left->tok);
+        if(node_type(node_left(node_left(node))) != TYPE_KEYWORD || node_key(node_left(node_left(node))) != TOK_CONST)
+            format_error("Variable has wrong left descendant ('const' expected)", node_left(node_left(node)));
 
         is_const = true;          
     }
 
     Symbol sym = {};
 
-    if(symtable_find(SYMTABLE, node->left->tok.val.name, &sym) == 0)
+    if(symtable_find(ctx->symtable, node_name(ctx->tree, node_left(node)), &sym) == 0)
     {
         if(sym.type == SYMBOL_TYPE_FUNCTION)
-            semantic_error("Cannot declare variable with function name", &node->left->tok);
+            semantic_error("Cannot declare variable with function name", node_left(node));
         else
-            semantic_error("Global variable redeclaration", &node->left->tok);
+            semantic_error("Global variable redeclaration", node_left(node));
     }
 
     uint64_t shift = 0;
-    if(node->left->right)
+    if(node_right(node_left(node)))
     {
-        if(node->left->right->tok.type != TYPE_NUMBER)
-            semantic_error("Size of variable is not compile-time evaluatable", &node->left->tok);
+        if(node_type(node_right(node_left(node))) != TYPE_NUMBER)
+            semantic_error("Size of variable is not compile-time evaluatable", node_left(node));
 
-        if(node->left->right->tok.val.num < 0)
-            semantic_error("Size of variable is negative", &node->left->tok);
+        if(node_num(ctx->tree, node_right(node_left(node))) < 0)
+            semantic_error("Size of variable is negative", node_left(node));
 
-        shift = (uint64_t) node->left->right->tok.val.num;
+        shift = (uint64_t) node_num(ctx->tree, node_right(node_left(node)));
     }
 
     sym = {.type               = SYMBOL_TYPE_VARIABLE,
-           .id                 = node->left->tok.val.name,
-           .offset             = DATA->buffer.pos,
-           .section_descriptor = DATA->descriptor,
+           .id                 = node_name(ctx->tree, node_left(node)),
+           .offset             = ctx->data->buffer.pos,
+           .section_descriptor = ctx->data->descriptor,
            .var  = (Variable) {.is_const = is_const, .size = shift + 1}
           };
     
     uint64_t sym_index = 0;
-    symtable_insert(SYMTABLE, sym, &sym_index);
+    symtable_insert(ctx->symtable, sym, &sym_index);
 
     for(size_t iter = 0; iter < shift; iter++)
     {
-        buffer_append_u64(&DATA->buffer, 0x0);
+        buffer_append_u64(&ctx->data->buffer, 0x0);
     }
-    buffer_append_u64(&DATA->buffer, value);
+    buffer_append_u64(&ctx->data->buffer, value);
 
     // encode(&INIT->buffer, {POP, MEM(0x0, {}, {}, 0x0), {}});
     
@@ -882,36 +1442,36 @@ static generator_err declare_global(Node* node)
     //                .src_nametable_index = sym_index,
     //               };
         
-    // relocations_insert(RELOCATIONS, reloc);
+    // relocations_insert(ctx->relocations, reloc);
 
     return GENERATOR_NOERR;
 }
 
-static generator_err generate_globals(Node* node)
+static generator_err generate_globals(Generator_context* ctx, Node* node)
 {
     assert(node);
 
-    if(node->left)
-        PASS$(!generate_globals(node->left), return GENERATOR_PASS_ERROR; );
+    if(node_left(node))
+        PASS$(!generate_globals(ctx, node_left(node)), return GENERATOR_PASS_ERROR; );
     
-    if(node->tok.type != TYPE_AUX || node->tok.val.aux != TOK_STATEMENT)
-        format_error("'statement' expected (first line)", &node->tok);
+    if(node_type(node) != TYPE_AUX || node_aux(node) != TOK_STATEMENT)
+        format_error("'statement' expected (first line)", node);
 
-    if(!node->right)
-        format_error("Missing 'statement' body (first line)", &node->tok);
+    if(!node_right(node))
+        format_error("Missing 'statement' body (first line)", node);
 
-    if(node->right->tok.type == TYPE_AUX && node->right->tok.val.aux == TOK_DEFINE)
+    if(node_type(node_right(node)) == TYPE_AUX && node_aux(node_right(node)) == TOK_DEFINE)
         return GENERATOR_NOERR;
 
-    if(node->right->tok.type != TYPE_OP || node->right->tok.val.op != TOK_ASSIGN)
-        format_error("'=' expected", &node->right->tok);
+    if(node_type(node_right(node)) != TYPE_OP || node_op(node_right(node)) != TOK_ASSIGN)
+        format_error("'=' expected", node_right(node));
 
-    PASS$(!declare_global(node->right), return GENERATOR_PASS_ERROR; );
+    PASS$(!declare_global(ctx, node_right(node)), return GENERATOR_PASS_ERROR; );
 
     return GENERATOR_NOERR;
 }
 
-generator_err generator(Tree* tree, Dependencies* deps, Binary* bin)
+generator_err generator(Tree* tree, Dependencies* deps, Binary* bin, bool is_peephole)
 {
     assert(bin && tree);
 
@@ -997,31 +1557,46 @@ generator_err generator(Tree* tree, Dependencies* deps, Binary* bin)
     Symtable    symbols = {};
     Localtable  locals  = {};
     Relocations relocs  = {};
+    Regalloc    regs    = {};
+    Ir          instrs  = {};
+    Peephole_stats stats = {};
     symtable_ctor   (&symbols);
     localtable_ctor (&locals);
     relocations_ctor(&relocs);
+    regalloc_ctor   (&regs);
+    ir_ctor         (&instrs);
 
     Symbol null_sym = {.id = ""};
     symtable_insert(&symbols, null_sym);
 
-    RELOCATIONS = &relocs;
-    SYMTABLE    = &symbols;
-    LOCALTABLE  = &locals;
+    Generator_context  context = {};
+    Generator_context* ctx     = &context;
+
+    ctx->tree        = tree;
+    ctx->relocations = &relocs;
+    ctx->regalloc    = &regs;
+    ctx->ir          = &instrs;
+    ctx->peephole    = is_peephole ? &stats : nullptr;
+    ctx->symtable    = &symbols;
+    ctx->localtable  = &locals;
 
-    TEXT = &text;
-    DATA = &data;
-    // INIT = &init;
+    ctx->text = &text;
+    ctx->data = &data;
+    // ctx->init = &init;
 
-    PASS$(!collect_stdlib_functions(deps), return GENERATOR_PASS_ERROR; );
+    PASS$(!collect_stdlib_functions(ctx, deps), return GENERATOR_PASS_ERROR; );
 
-    collect_functions(tree->root);
+    collect_functions(ctx, tree_root(tree));
 
-    generate_globals(tree->root);
+    generate_globals(ctx, tree_root(tree));
 
-    generate_funtions(tree->root);
+    generate_funtions(ctx, tree_root(tree));
 
     symtable_dump(&symbols);
 
+    if(ctx->peephole)
+        peephole_dump(ctx->peephole);
+
     binary_store_section(bin, text);
     // binary_store_section(bin, init);
     binary_store_section(bin, data);
@@ -1046,12 +1621,11 @@ generator_err generator(Tree* tree, Dependencies* deps, Binary* bin)
     binary_generate_shdrs(bin);
     binary_generate_ehdr(bin);
 
-    SYMTABLE   = nullptr;
-    LOCALTABLE = nullptr;
-
     symtable_dtor   (&symbols);
     localtable_dtor (&locals);
     relocations_dtor(&relocs);
+    regalloc_dtor   (&regs);
+    ir_dtor         (&instrs);
 
-    return IS_ERROR;
+    return ctx->is_error;
 }
@@ -14,6 +14,6 @@ enum generator_err
     GENERATOR_BAD_ALLOC = 4,
 };
 
-generator_err generator(Tree* tree, Dependencies* deps, Binary* bin);
+generator_err generator(Tree* tree, Dependencies* deps, Binary* bin, bool is_peephole = true);
 
 #endif // ELF_GENERATOR_H
@@ -21,6 +21,22 @@ Operand IMM32(int32_t val)
     return op;
 }
 
+Operand IMM8(int8_t val)
+{
+    Operand op = {};
+    op.type = OP_IMM8;
+    op.imm8 = val;
+    return op;
+}
+
+Operand REG(uint8_t id)
+{
+    Operand op = {};
+    op.type = OP_REGISTER;
+    op.reg.id = id;
+    return op;
+}
+
 Operand MEM(uint8_t scale, Operand index, Operand base, int32_t disp)
 {
     Operand op = {.type = OP_MEMORY};
@@ -61,8 +77,8 @@ Operand MEM(uint8_t scale, Operand index, Operand base, int32_t disp)
         op.mem.is_base = true;
     }
 
-    // RBP addressing needs displacement field
-    if(disp || EQUAL(base, RBP) || EQUAL(index, RBP) || (!op.mem.is_index && !op.mem.is_base))
+    // RBP and R13 addressing needs displacement field
+    if(disp || EQUAL(base, RBP) || EQUAL(base, R13) || EQUAL(index, RBP) || (!op.mem.is_index && !op.mem.is_base))
     {
         op.mem.disp    = disp;
         op.mem.is_disp = true;
@@ -189,7 +205,7 @@ static void rex_prefix(Buffer* buffer, Instruction instr, uint8_t rex)
                         rex |= REX_B;
                     break;
                 }                
-                default:
+                case OP_IMM8: default:
                 {
                     assert(0 && "Invalid operand combination");
                 }
@@ -214,7 +230,7 @@ static void rex_prefix(Buffer* buffer, Instruction instr, uint8_t rex)
                 {
                     break;
                 }
-                default: case OP_MEMORY:
+                default: case OP_MEMORY: case OP_IMM8:
                 {
                     assert(0 && "Invalid operand combination");
                 }
@@ -226,7 +242,7 @@ static void rex_prefix(Buffer* buffer, Instruction instr, uint8_t rex)
             assert(instr.op2.type == OP_NOTYPE);
             break;
         }
-        default: case OP_NOTYPE:
+        default: case OP_IMM8: case OP_NOTYPE:
         {
             assert(0 && "Operand missing or is no type");
         }
@@ -236,9 +252,89 @@ static void rex_prefix(Buffer* buffer, Instruction instr, uint8_t rex)
         buffer_append_u8(buffer, rex); 
 }
 
+// Statistics of encoder are collected per thread, so that objects can be encoded concurrently
+static thread_local Encode_stats* STATS = nullptr;
+
+void encode_stats(Encode_stats* stats)
+{
+    STATS = stats;
+}
+
+static bool is_imm8(int32_t val)
+{
+    return val >= INT8_MIN && val <= INT8_MAX;
+}
+
+// Mod field for base-relative addressing: disp8 (0b01) or disp32 (0b10)
+static uint8_t disp_mod(int32_t disp)
+{
+    return is_imm8(disp) ? 0b01 : 0b10;
+}
+
+static void disp_field(Buffer* buffer, int32_t disp)
+{
+    if(!is_imm8(disp))
+    {
+        buffer_append_i32(buffer, disp);
+        return;
+    }
+
+    buffer_append_i8(buffer, (int8_t) disp);
+
+    if(STATS)
+    {
+        STATS->disp8++;
+        STATS->saved += sizeof(int32_t) - sizeof(int8_t);
+    }
+}
+
+// Sign-extended imm8 forms exist for ALU group (0x83), imul (0x6B) and push (0x6A)
+static bool is_short_imm(Instruction instr)
+{
+    switch(instr.mnemonic)
+    {
+        case ADD: case SUB: case CMP: case AND: case XOR: case OR: case IMUL:
+            return instr.op2.type == OP_IMM32 && is_imm8(instr.op2.imm32);
+        case PUSH:
+            return instr.op1.type == OP_IMM32 && is_imm8(instr.op1.imm32);
+        case MOV:  case LEA:  case TEST: case CQO:  case IDIV: case POP:  case CALL: case RET:
+        case SETE: case SETNE: case SETGE: case SETLE: case SETG: case SETL:
+        case JMP:  case JE:   case JNE:  case JL:   case JG:   case JLE:  case JGE:
+        case INVALID_INSTR:
+        default:
+            return false;
+    }
+}
+
+static void imm_field(Buffer* buffer, int32_t imm, bool is_short)
+{
+    if(!is_short)
+    {
+        buffer_append_i32(buffer, imm);
+        return;
+    }
+
+    buffer_append_i8(buffer, (int8_t) imm);
+
+    if(STATS)
+    {
+        STATS->imm8++;
+        STATS->saved += sizeof(int32_t) - sizeof(int8_t);
+    }
+}
+
+size_t encode_imm_size(Instruction instr)
+{
+    if(instr.op2.type != OP_IMM32)
+        return 0;
+
+    return is_short_imm(instr) ? sizeof(int8_t) : sizeof(int32_t);
+}
+
 static void memory_operand(Buffer* buffer, uint8_t reg_op, Memory op)
 {
-    if(op.is_base && op.base == RSP.reg.id)
+    // R12 as base is encoded like RSP
+    if(op.is_base && (op.base & 0b111) == RSP.reg.id)
     {
         // base only -> index && base
         // [00 011 100] [00 100 100] [---xx---]     add ebx, [rsp]
@@ -246,7 +342,7 @@ static void memory_operand(Buffer* buffer, uint8_t reg_op, Memory op)
         {
             buffer_append_u8(buffer, GEN_MODRM(0b00, reg_op, 0b100));
 
-            buffer_append_u8(buffer, GEN_SIB(op.scale, 0b100, 0b100));
+            buffer_append_u8(buffer, GEN_SIB(op.scale, 0b100, op.base));
 
             // no disp
 
@@ -263,12 +359,11 @@ static void memory_operand(Buffer* buffer, uint8_t reg_op, Memory op)
         // [10 011 100] [00 100 100] [11100000]     add ebx, [rsp + 7]
         if(!op.is_index && op.is_disp)
         {
-            // buffer_append_u8(buffer, GEN_MODRM(0b01, reg_op, 0b100));
-            buffer_append_u8(buffer, GEN_MODRM(0b10, reg_op, 0b100));
+            buffer_append_u8(buffer, GEN_MODRM(disp_mod(op.disp), reg_op, 0b100));
             
-            buffer_append_u8(buffer, GEN_SIB(0b00, 0b100, 0b100));
+            buffer_append_u8(buffer, GEN_SIB(0b00, 0b100, op.base));
             
-            buffer_append_i32(buffer, op.disp);
+            disp_field(buffer, op.disp);
 
             return;
         }
@@ -319,7 +414,7 @@ static void memory_operand(Buffer* buffer, uint8_t reg_op, Memory op)
         return;
     }
 
-    // index && base && disp
+    // index && base && disp (mod = 01 if disp fits disp8)
     // [10 reg 100] [sc idx bas] [displace]
     // [10 011 100] [01 010 000] [11100000]     add ebx, [2*rdx + rax + 7]
     // [10 011 100] [00 100 100] [11100000]     add ebx, [rsp + 7]
@@ -327,27 +422,26 @@ static void memory_operand(Buffer* buffer, uint8_t reg_op, Memory op)
     // <not valid>                              add ebx, [rbx + 2*rsp + 7]
     if(op.is_index && op.is_base && op.is_disp)
     {
-        // buffer_append_u8(buffer, GEN_MODRM(0b01, reg_op, 0b100));
-        buffer_append_u8(buffer, GEN_MODRM(0b10, reg_op, 0b100));
+        buffer_append_u8(buffer, GEN_MODRM(disp_mod(op.disp), reg_op, 0b100));
         
         buffer_append_u8(buffer, GEN_SIB(op.scale, op.index, op.base));
         
-        buffer_append_i32(buffer, op.disp);
+        disp_field(buffer, op.disp);
 
         return;
     }
 
-    // base && disp
+    // base && disp (mod = 01 if disp fits disp8)
     // [10 reg bas] [---xx---] [displace]
     // [10 011 010] [---xx---] [11100000]       add ebx, [rdx + 7]
     // <see index && base && disp>              add ebx, [rsp + 7]
     if(!op.is_index && op.is_base && op.is_disp)
     {
-        buffer_append_u8(buffer, GEN_MODRM(0b10, reg_op, op.base));
+        buffer_append_u8(buffer, GEN_MODRM(disp_mod(op.disp), reg_op, op.base));
 
         // no SIB
 
-        buffer_append_i32(buffer, op.disp);
+        disp_field(buffer, op.disp);
 
         return;
     }
@@ -427,12 +521,14 @@ static void instr_ariphmetic(Buffer* buffer, Instruction instr, uint8_t regmem_o
                 }
                 case OP_IMM32:
                 {
-                    buffer_append_u8(buffer, GEN_OPCODE(immediate_op, 0b0, 0b1));
+                    bool is_short = is_short_imm(instr);
+
+                    buffer_append_u8(buffer, GEN_OPCODE(immediate_op, is_short, 0b1)); // dir = 1: sign-extended imm8
                     buffer_append_u8(buffer, GEN_MODRM(0b11, immediate_reg_op, instr.op1.reg.id));
-                    buffer_append_i32(buffer, instr.op2.imm32);
+                    imm_field(buffer, instr.op2.imm32, is_short);
                     break;
                 }
-                case OP_NOTYPE: default:
+                case OP_IMM8: case OP_NOTYPE: default:
                 {
                     assert(0);
                 }
@@ -451,19 +547,21 @@ static void instr_ariphmetic(Buffer* buffer, Instruction instr, uint8_t regmem_o
                 }
                 case OP_IMM32:
                 {
-                    buffer_append_u8(buffer, GEN_OPCODE(immediate_op, 0b0, 0b1));
+                    bool is_short = is_short_imm(instr);
+
+                    buffer_append_u8(buffer, GEN_OPCODE(immediate_op, is_short, 0b1)); // dir = 1: sign-extended imm8
                     memory_operand(buffer, immediate_reg_op, instr.op1.mem);
-                    buffer_append_i32(buffer, instr.op2.imm32);
+                    imm_field(buffer, instr.op2.imm32, is_short);
                     break;
                 }
-                case OP_MEMORY: case OP_NOTYPE: default:
+                case OP_MEMORY: case OP_IMM8: case OP_NOTYPE: default:
                 {
                     assert(0);
                 }
             }
             break;
         }
-        case OP_IMM32: case OP_NOTYPE: default:
+        case OP_IMM32: case OP_IMM8: case OP_NOTYPE: default:
         {
             assert(0);
         }
@@ -503,10 +601,41 @@ static void instr_imul(Buffer* buffer, Instruction instr)
     assert(buffer);
     assert(instr.op1.type == OP_REGISTER);
 
-    rex_prefix(buffer, instr, REX_W);
+    // Dst operand is always in REG field, so register-register form
+    // cannot use rex_prefix() (it expects R/M <- reg)
+    if(instr.op2.type == OP_REGISTER)
+    {
+        uint8_t rex = REX_W;
+        if(instr.op1.reg.id & 0b1000)
+            rex |= REX_R;
+        if(instr.op2.reg.id & 0b1000)
+            rex |= REX_B;
+
+        buffer_append_u8(buffer, rex);
+    }
+    else if(instr.op2.type == OP_IMM32)
+    {
+        // imul reg, reg, imm32: dst is both in REG and R/M fields
+        uint8_t rex = REX_W;
+        if(instr.op1.reg.id & 0b1000)
+            rex |= REX_R | REX_B;
+
+        bool is_short = is_short_imm(instr);
+
+        buffer_append_u8(buffer, rex);
+        buffer_append_u8(buffer, GEN_OPCODE(0x69, is_short, 0b1)); // 0x6B: sign-extended imm8
+        buffer_append_u8(buffer, GEN_MODRM(0b11, instr.op1.reg.id, instr.op1.reg.id));
+        imm_field(buffer, instr.op2.imm32, is_short);
+
+        return;
+    }
+    else
+    {
+        rex_prefix(buffer, instr, REX_W);
+    }
+
     buffer_append_u8(buffer, GEN_PREFIX(0x0F));
 
-    // Dst operand is always in REG field
     buffer_append_u8(buffer, GEN_OPCODE(0xAF, 0b1, 0b1)); // dir = 1: REG <- R/M; sz = 1: 32 bits (64 because of prefix)
 
     switch(instr.op2.type)
@@ -521,7 +650,7 @@ static void instr_imul(Buffer* buffer, Instruction instr)
             memory_operand(buffer, instr.op1.reg.id, instr.op2.mem);
             break;
         }
-        default: case OP_IMM32: case OP_NOTYPE:
+        default: case OP_IMM32: case OP_IMM8: case OP_NOTYPE:
         {
             assert(0);
         }
@@ -558,7 +687,7 @@ static void instr_idiv(Buffer* buffer, Instruction instr)
             memory_operand(buffer, 0b111, instr.op1.mem);
             break;
         }
-        default: case OP_IMM32: case OP_NOTYPE:
+        default: case OP_IMM32: case OP_IMM8: case OP_NOTYPE:
         {
             assert(0);
         }
@@ -599,11 +728,13 @@ static void instr_push(Buffer* buffer, Instruction instr)
         }
         case OP_IMM32:
         {
-            buffer_append_u8(buffer, GEN_OPCODE(0x68, 0b0, 0b0));
-            buffer_append_i32(buffer, instr.op1.imm32);
+            bool is_short = is_short_imm(instr);
+
+            buffer_append_u8(buffer, GEN_OPCODE(0x68, is_short, 0b0)); // 0x6A: sign-extended imm8
+            imm_field(buffer, instr.op1.imm32, is_short);
             break;
         }
-        case OP_NOTYPE: default:
+        case OP_IMM8: case OP_NOTYPE: default:
         {
             assert(0);
         }
@@ -630,7 +761,7 @@ static void instr_pop(Buffer* buffer, Instruction instr)
             memory_operand(buffer, 0b000, instr.op1.mem);
             break;
         }
-        case OP_NOTYPE: case OP_IMM32: default:
+        case OP_NOTYPE: case OP_IMM32: case OP_IMM8: default:
         {
             assert(0);
         }
@@ -640,9 +771,22 @@ static void instr_pop(Buffer* buffer, Instruction instr)
 static void instr_jmp(Buffer* buffer, Instruction instr)
 {
     assert(buffer);
-    assert(instr.op1.type == OP_IMM32);
+    assert(instr.op1.type == OP_IMM32 || instr.op1.type == OP_IMM8);
     assert(instr.op2.type == OP_NOTYPE);
 
+    if(instr.op1.type == OP_IMM8)
+    {
+        buffer_append_u8(buffer, GEN_OPCODE(0xEB, 0b0, 0b0));
+        buffer_append_i8(buffer, instr.op1.imm8);
+
+        if(STATS)
+        {
+            STATS->rel8++;
+            STATS->saved += sizeof(int32_t) - sizeof(int8_t);
+        }
+        return;
+    }
+
     buffer_append_u8(buffer, GEN_OPCODE(0xE9, 0b0, 0b0));
     buffer_append_i32(buffer, instr.op1.imm32);
 }
@@ -653,12 +797,39 @@ static void instr_jmp(Buffer* buffer, Instruction instr)
 #define instr_jne(BUFFER, INSTR)             \
     instr_cond_jumps(BUFFER, INSTR, 0x85)    \
 
+#define instr_jl(BUFFER, INSTR)              \
+    instr_cond_jumps(BUFFER, INSTR, 0x8C)    \
+
+#define instr_jg(BUFFER, INSTR)              \
+    instr_cond_jumps(BUFFER, INSTR, 0x8F)    \
+
+#define instr_jle(BUFFER, INSTR)             \
+    instr_cond_jumps(BUFFER, INSTR, 0x8E)    \
+
+#define instr_jge(BUFFER, INSTR)             \
+    instr_cond_jumps(BUFFER, INSTR, 0x8D)    \
+
 static void instr_cond_jumps(Buffer* buffer, Instruction instr, uint8_t immediate_op)
 {
     assert(buffer);
-    assert(instr.op1.type == OP_IMM32);
+    assert(instr.op1.type == OP_IMM32 || instr.op1.type == OP_IMM8);
     assert(instr.op2.type == OP_NOTYPE);
 
+    // Short form opcode is 0x7_ for 0x0F 0x8_ of near form
+    if(instr.op1.type == OP_IMM8)
+    {
+        buffer_append_u8(buffer, GEN_OPCODE(immediate_op - 0x10, 0b0, 0b0));
+        buffer_append_i8(buffer, instr.op1.imm8);
+
+        // 0x0F prefix is dropped too
+        if(STATS)
+        {
+            STATS->rel8++;
+            STATS->saved += sizeof(int32_t) - sizeof(int8_t) + 1;
+        }
+        return;
+    }
+
     buffer_append_u8(buffer, 0x0F);
     buffer_append_u8(buffer, GEN_OPCODE(immediate_op, 0b0, 0b0));
     buffer_append_i32(buffer, instr.op1.imm32);
@@ -691,7 +862,7 @@ static void instr_call(Buffer* buffer, Instruction instr)
             buffer_append_i32(buffer, instr.op1.imm32);
             break;
         }
-        case OP_NOTYPE: default:
+        case OP_IMM8: case OP_NOTYPE: default:
         {
             assert(0);
         }
@@ -824,6 +995,8 @@ int main()
     encode(&buffer, {JMP, IMM32(0x12345678)});
     encode(&buffer, {JE,  IMM32(0x12345678)});
     encode(&buffer, {JNE, IMM32(0x12345678)});
+    encode(&buffer, {JMP, IMM8(0x12)});
+    encode(&buffer, {JE,  IMM8(0x12)});
 
     printf("POP\n");
 
@@ -843,7 +1016,7 @@ int main()
     encode(&buffer, {IMUL, RBX, MEM(0, {}, {}, 0x30)});
     encode(&buffer, {IMUL, RDX, MEM(2, RDI, RAX, -6)});
     // encode(&buffer, {IMUL, MEM(2, RDI, RAX, 6), RCX});
-    // encode(&buffer, {IMUL, RAX, IMM32(0x12345678)});
+    encode(&buffer, {IMUL, RAX, IMM32(0x12345678)});
 
     encode(&buffer, {IDIV, RAX, {}});
     encode(&buffer, {IDIV, MEM(0, {}, {}, 0x30), {}});
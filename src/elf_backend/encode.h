@@ -12,6 +12,7 @@ typedef enum
     OP_REGISTER  = 1,
     OP_MEMORY    = 2,
     OP_IMM32     = 3,
+    OP_IMM8      = 4,   // only rel8 of short jumps
 } Operand_type;
 
 struct Register
@@ -41,6 +42,7 @@ struct Operand
         Memory   mem;
         Register reg;
         int32_t  imm32;
+        int8_t   imm8;
     };
 };
 
@@ -64,11 +66,28 @@ struct Instruction
 };
 
 Operand IMM8(int8_t val);
+Operand REG(uint8_t id);
 Operand IMM32(int32_t val);
 Operand MEM(uint8_t scale, Operand index, Operand base, int32_t disp);
 
+// Number of short (8-bit) fields chosen by encoder and bytes saved against 32-bit ones
+struct Encode_stats
+{
+    size_t disp8;
+    size_t imm8;
+    size_t rel8;
+
+    size_t saved;
+};
+
 void encode(Buffer* buffer, Instruction instr);
 
+// Encoder adds to 'stats' until it is reset with nullptr
+void encode_stats(Encode_stats* stats);
+
+// Size of immediate operand 'op2' in encoding of 'instr'
+size_t encode_imm_size(Instruction instr);
+
 extern const Operand RAX;
 extern const Operand RCX;
 extern const Operand RDX;
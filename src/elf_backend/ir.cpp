@@ -0,0 +1,264 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+
+#include "ir.h"
+#include "../../include/logs/logs.h"
+
+enum ir_err
+{
+    IR_NOERR     = 0,
+    IR_BAD_ALLOC = 1,
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+static int ir_resize(Ir* ir, size_t new_cap)
+{
+    assert(ir);
+
+    assert(new_cap > ir->buffer_cap);
+
+    Ir_instr* ptr = (Ir_instr*) realloc(ir->buffer, new_cap * sizeof(Ir_instr));
+    ASSERT_RET$(ptr, IR_BAD_ALLOC);
+
+    ir->buffer     = ptr;
+    ir->buffer_cap = new_cap;
+
+    return 0;
+}
+
+static int ir_insert(Ir* ir, Ir_instr instr)
+{
+    assert(ir);
+
+    if(ir->buffer_cap <= ir->buffer_sz)
+        PASS$(!ir_resize(ir, ir->buffer_cap * 2), return IR_BAD_ALLOC; );
+
+    ir->buffer[ir->buffer_sz] = instr;
+    ir->buffer_sz++;
+
+    return 0;
+}
+
+int ir_ctor(Ir* ir)
+{
+    assert(ir);
+    *ir = {};
+
+    PASS$(!ir_resize(ir, 256), return IR_BAD_ALLOC; );
+
+    return 0;
+}
+
+void ir_dtor(Ir* ir)
+{
+    assert(ir);
+
+    free(ir->buffer);
+
+    *ir = {};
+}
+
+void ir_clean(Ir* ir)
+{
+    assert(ir);
+
+    ir->buffer_sz = 0;
+    ir->labels_sz = 0;
+}
+
+void ir_compact(Ir* ir)
+{
+    assert(ir);
+
+    size_t new_sz = 0;
+    for(size_t iter = 0; iter < ir->buffer_sz; iter++)
+    {
+        if(ir->buffer[iter].type == IR_NOP)
+            continue;
+
+        ir->buffer[new_sz] = ir->buffer[iter];
+        new_sz++;
+    }
+
+    ir->buffer_sz = new_sz;
+}
+
+size_t ir_label(Ir* ir)
+{
+    assert(ir);
+
+    return ir->labels_sz++;
+}
+
+int ir_bind(Ir* ir, size_t label)
+{
+    assert(ir);
+    assert(label < ir->labels_sz);
+
+    return ir_insert(ir, {.type = IR_LABEL, .instr = {}, .is_jump = false, .label = label});
+}
+
+int ir_emit(Ir* ir, Instruction instr)
+{
+    assert(ir);
+
+    return ir_insert(ir, {.type = IR_INSTR, .instr = instr});
+}
+
+int ir_emit_jump(Ir* ir, Mnemonic mnemonic, size_t label)
+{
+    assert(ir);
+    assert(label < ir->labels_sz);
+
+    return ir_insert(ir, {.type = IR_INSTR, .instr = {mnemonic, IMM32(0x0), {}}, .is_jump = true, .label = label});
+}
+
+int ir_emit_reloc(Ir* ir, Instruction instr, uint64_t sym_index, int32_t addend)
+{
+    assert(ir);
+
+    return ir_insert(ir, {.type = IR_INSTR, .instr = instr, .is_jump = false, .label = 0,
+                          .is_reloc = true, .sym_index = sym_index, .addend = addend});
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Jump encodings: short form is opcode + rel8, near form is (0x0F) opcode + rel32
+static const uint64_t SHORT_JUMP_SZ = 2;
+static const uint64_t NEAR_JMP_SZ   = 5;
+static const uint64_t NEAR_JCC_SZ   = 6;
+
+static uint64_t jump_size(const Ir_instr* instr, bool is_near)
+{
+    if(!is_near)
+        return SHORT_JUMP_SZ;
+
+    return (instr->instr.mnemonic == JMP) ? NEAR_JMP_SZ : NEAR_JCC_SZ;
+}
+
+int ir_lower(Ir* ir, Section* sect, Relocations* relocs)
+{
+    assert(ir && sect && relocs);
+
+    uint64_t* labels  = (uint64_t*) calloc(ir->labels_sz + 1, sizeof(uint64_t));
+    uint64_t* offsets = (uint64_t*) calloc(ir->buffer_sz + 1, sizeof(uint64_t));
+    uint64_t* sizes   = (uint64_t*) calloc(ir->buffer_sz + 1, sizeof(uint64_t));
+    bool*     is_near = (bool*)     calloc(ir->buffer_sz + 1, sizeof(bool));
+    Buffer    code    = {};
+
+    if(!labels || !offsets || !sizes || !is_near)
+    {
+        free(labels);
+        free(offsets);
+        free(sizes);
+        free(is_near);
+
+        ASSERT_RET$(0, IR_BAD_ALLOC);
+    }
+
+    // Instructions except jumps are encoded once, their size doesn't depend on position
+    for(size_t iter = 0; iter < ir->buffer_sz; iter++)
+    {
+        Ir_instr* cur = &ir->buffer[iter];
+
+        if(cur->type != IR_INSTR || cur->is_jump)
+            continue;
+
+        offsets[iter] = code.pos;
+        encode(&code, cur->instr);
+        sizes[iter] = code.pos - offsets[iter];
+    }
+
+    // All jumps start short and are made near until every displacement fits rel8.
+    // Jumps only grow, so iteration stops after at most one pass per jump.
+    bool is_changed = true;
+    while(is_changed)
+    {
+        is_changed = false;
+
+        uint64_t pos = 0;
+        for(size_t iter = 0; iter < ir->buffer_sz; iter++)
+        {
+            Ir_instr* cur = &ir->buffer[iter];
+
+            if(cur->type == IR_LABEL)
+                labels[cur->label] = pos;
+            else if(cur->type == IR_INSTR)
+                pos += cur->is_jump ? jump_size(cur, is_near[iter]) : sizes[iter];
+        }
+
+        pos = 0;
+        for(size_t iter = 0; iter < ir->buffer_sz; iter++)
+        {
+            Ir_instr* cur = &ir->buffer[iter];
+
+            if(cur->type != IR_INSTR)
+                continue;
+
+            if(!cur->is_jump)
+            {
+                pos += sizes[iter];
+                continue;
+            }
+
+            pos += jump_size(cur, is_near[iter]);
+
+            int64_t disp = (int64_t) labels[cur->label] - (int64_t) pos;
+            if(!is_near[iter] && (disp < INT8_MIN || disp > INT8_MAX))
+            {
+                is_near[iter] = true;
+                is_changed    = true;
+            }
+        }
+    }
+
+    uint64_t start = sect->buffer.pos;
+    for(size_t iter = 0; iter < ir->buffer_sz; iter++)
+    {
+        Ir_instr* cur = &ir->buffer[iter];
+
+        if(cur->type != IR_INSTR)
+            continue;
+
+        if(cur->is_jump)
+        {
+            uint64_t rip  = sect->buffer.pos - start + jump_size(cur, is_near[iter]);
+            int64_t  disp = (int64_t) labels[cur->label] - (int64_t) rip;
+
+            cur->instr.op1 = is_near[iter] ? IMM32((int32_t) disp) : IMM8((int8_t) disp);
+            encode(&sect->buffer, cur->instr);
+
+            continue;
+        }
+
+        buffer_append_arr(&sect->buffer, code.buf + offsets[iter], sizes[iter]);
+
+        if(!cur->is_reloc)
+            continue;
+
+        // RIP-relative field is the last one, except for immediate
+        int32_t imm_sz = (int32_t) encode_imm_size(cur->instr);
+
+        Reloc reloc = {.dst_section_descriptor = sect->descriptor,
+                       .dst_offset = sect->buffer.pos - sizeof(int32_t) - (uint64_t) imm_sz,
+                       .dst_init_val = cur->addend - (int32_t) sizeof(int32_t) - imm_sz,
+                       .src_nametable_index = cur->sym_index,
+                      };
+
+        relocations_insert(relocs, reloc);
+    }
+
+    buffer_dtor(&code);
+
+    free(labels);
+    free(offsets);
+    free(sizes);
+    free(is_near);
+
+    return 0;
+}
@@ -0,0 +1,59 @@
+#ifndef IR_H
+#define IR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "encode.h"
+#include "elf_wrap.h"
+#include "relocation.h"
+
+enum Ir_type
+{
+    IR_INSTR = 0,
+    IR_LABEL = 1,
+    IR_NOP   = 2,   // removed instruction, skipped by lowering
+};
+
+// Machine instruction or position in instruction stream
+struct Ir_instr
+{
+    Ir_type     type;
+    Instruction instr;
+
+    bool        is_jump;    // rel operand of 'instr' is replaced by offset of 'label', rel8 if it fits
+    size_t      label;      // label id for IR_LABEL, jump target otherwise
+
+    bool        is_reloc;   // RIP-relative field (call target or disp32) refers to symbol 'sym_index'
+    uint64_t    sym_index;
+    int32_t     addend;
+};
+
+// Instructions of one function, lowered to bytes by ir_lower()
+struct Ir
+{
+    Ir_instr* buffer;
+    size_t    buffer_sz;
+    size_t    buffer_cap;
+
+    size_t    labels_sz;
+};
+
+int  ir_ctor (Ir* ir);
+void ir_dtor (Ir* ir);
+void ir_clean(Ir* ir);
+
+// Drops IR_NOP entries
+void ir_compact(Ir* ir);
+
+size_t ir_label(Ir* ir);
+int    ir_bind (Ir* ir, size_t label);
+
+int  ir_emit      (Ir* ir, Instruction instr);
+int  ir_emit_jump (Ir* ir, Mnemonic mnemonic, size_t label);
+int  ir_emit_reloc(Ir* ir, Instruction instr, uint64_t sym_index, int32_t addend);
+
+// Appends encoded instructions to 'sect', relaxes jumps to short form and inserts relocations
+int  ir_lower(Ir* ir, Section* sect, Relocations* relocs);
+
+#endif // IR_H
@@ -0,0 +1,730 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+
+#include "peephole.h"
+#include "../../include/logs/logs.h"
+
+enum peephole_err
+{
+    PEEPHOLE_NOERR     = 0,
+    PEEPHOLE_BAD_ALLOC = 1,
+};
+
+// Registers are bits 0-15 by id, flags register is bit 16
+static const uint32_t FLAGS = 1u << 16;
+
+// RSP and RBP, instructions writing them are never removed
+static const uint32_t FRAME_REGS   = 0x0030;
+// RAX RCX RDX RSI RDI R8-R11
+static const uint32_t CALLER_SAVED = 0x0FC7;
+// Arguments RDI RSI RDX RCX R8 R9, number of vector arguments in RAX, RSP
+static const uint32_t CALL_USES    = 0x03D7;
+// Return value RAX, RSP, RBP and callee-saved RBX R12-R15
+static const uint32_t RET_USES     = 0xF039;
+
+///////////////////////////////////////////////////////////////////////////////
+
+static uint32_t reg_bit(Operand op)
+{
+    return (op.type == OP_REGISTER) ? 1u << op.reg.id : 0;
+}
+
+static uint32_t addr_bits(Operand op)
+{
+    if(op.type != OP_MEMORY)
+        return 0;
+
+    return (op.mem.is_base  ? 1u << op.mem.base  : 0) |
+           (op.mem.is_index ? 1u << op.mem.index : 0);
+}
+
+static uint32_t read_bits(Operand op)
+{
+    return reg_bit(op) | addr_bits(op);
+}
+
+static bool is_equal(Operand lhs, Operand rhs)
+{
+    if(lhs.type != rhs.type)
+        return false;
+
+    switch(lhs.type)
+    {
+        case OP_REGISTER:
+            return lhs.reg.id == rhs.reg.id;
+        case OP_IMM32:
+            return lhs.imm32 == rhs.imm32;
+        case OP_IMM8:
+            return lhs.imm8 == rhs.imm8;
+        case OP_MEMORY:
+            return lhs.mem.is_base  == rhs.mem.is_base  && (!lhs.mem.is_base  || lhs.mem.base  == rhs.mem.base)  &&
+                   lhs.mem.is_index == rhs.mem.is_index && (!lhs.mem.is_index || (lhs.mem.index == rhs.mem.index &&
+                                                                                  lhs.mem.scale == rhs.mem.scale)) &&
+                   lhs.mem.is_disp  == rhs.mem.is_disp  && lhs.mem.disp == rhs.mem.disp;
+        case OP_NOTYPE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool is_setcc(Mnemonic mnemonic)
+{
+    return mnemonic == SETE || mnemonic == SETNE || mnemonic == SETGE ||
+           mnemonic == SETLE || mnemonic == SETG || mnemonic == SETL;
+}
+
+static bool is_ariphmetic(Mnemonic mnemonic)
+{
+    return mnemonic == ADD || mnemonic == SUB || mnemonic == AND ||
+           mnemonic == OR  || mnemonic == XOR || mnemonic == IMUL;
+}
+
+// First operand is destination, its register is not read
+static bool is_op1_written(Mnemonic mnemonic)
+{
+    return mnemonic == MOV || mnemonic == LEA || mnemonic == POP || is_setcc(mnemonic) || is_ariphmetic(mnemonic);
+}
+
+struct Effect
+{
+    uint32_t use;
+    uint32_t def;
+    bool     is_fixed;  // has effect besides registers: memory, stack, control flow
+};
+
+static Effect effect(Instruction instr)
+{
+    Operand op1 = instr.op1;
+    Operand op2 = instr.op2;
+
+    Effect eff = {};
+
+    switch(instr.mnemonic)
+    {
+        case MOV:
+            eff = {read_bits(op2) | addr_bits(op1), reg_bit(op1), op1.type == OP_MEMORY};
+            break;
+        case LEA:
+            eff = {addr_bits(op2), reg_bit(op1), false};
+            break;
+        case ADD: case SUB: case AND: case OR: case XOR: case IMUL:
+            eff = {read_bits(op1) | read_bits(op2), reg_bit(op1) | FLAGS, op1.type == OP_MEMORY};
+
+            // xor r, r doesn't depend on r
+            if(instr.mnemonic == XOR && op1.type == OP_REGISTER && is_equal(op1, op2))
+                eff.use = 0;
+            break;
+        case CMP: case TEST:
+            eff = {read_bits(op1) | read_bits(op2), FLAGS, false};
+            break;
+        case SETE: case SETNE: case SETGE: case SETLE: case SETG: case SETL:
+            // Only lowest byte is written
+            eff = {FLAGS | reg_bit(op1), reg_bit(op1), false};
+            break;
+        case CQO:
+            eff = {reg_bit(RAX), reg_bit(RDX), false};
+            break;
+        case IDIV:
+            eff = {reg_bit(RAX) | reg_bit(RDX) | read_bits(op1), reg_bit(RAX) | reg_bit(RDX) | FLAGS, true};
+            break;
+        case PUSH:
+            eff = {read_bits(op1) | reg_bit(RSP), reg_bit(RSP), true};
+            break;
+        case POP:
+            eff = {addr_bits(op1) | reg_bit(RSP), reg_bit(op1) | reg_bit(RSP), true};
+            break;
+        case JMP:
+            eff = {0, 0, true};
+            break;
+        case JE: case JNE: case JL: case JG: case JLE: case JGE:
+            eff = {FLAGS, 0, true};
+            break;
+        case CALL:
+            eff = {CALL_USES | read_bits(op1), CALLER_SAVED | FLAGS, true};
+            break;
+        case RET:
+            eff = {RET_USES, 0, true};
+            break;
+        case INVALID_INSTR: default:
+            eff = {~0u, ~0u, true};
+            break;
+    }
+
+    if(eff.def & FRAME_REGS)
+        eff.is_fixed = true;
+
+    return eff;
+}
+
+// Operand combination which encode() supports
+static bool is_legal(Instruction instr)
+{
+    Operand_type op1 = instr.op1.type;
+    Operand_type op2 = instr.op2.type;
+
+    if(op1 == OP_MEMORY && op2 == OP_MEMORY)
+        return false;
+
+    switch(instr.mnemonic)
+    {
+        case MOV: case ADD: case SUB: case AND: case OR: case XOR: case CMP:
+            return op1 == OP_REGISTER || op1 == OP_MEMORY;
+        case TEST:
+            return (op1 == OP_REGISTER || op1 == OP_MEMORY) && op2 != OP_MEMORY;
+        case IMUL:
+            return op1 == OP_REGISTER;
+        case LEA:
+            return op1 == OP_REGISTER && op2 == OP_MEMORY;
+        case IDIV: case POP:
+            return op1 == OP_REGISTER || op1 == OP_MEMORY;
+        case PUSH:
+            return true;
+        case CQO:  case SETE: case SETNE: case SETGE: case SETLE: case SETG: case SETL:
+        case JMP:  case JE:   case JNE:   case JL:    case JG:    case JLE:  case JGE:
+        case CALL: case RET:  case INVALID_INSTR:
+        default:
+            return false;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct Context
+{
+    Ir*       ir;
+
+    uint32_t* live_in;
+    uint32_t* live_out;
+    size_t*   labels;       // index of label in instruction list
+
+    size_t*   jumps;        // jumps to label L are jumps[jumps_begin[L]] ... jumps[jumps_begin[L + 1] - 1]
+    size_t*   jumps_begin;
+
+    size_t*   queue;        // instructions whose liveness is to be recomputed
+    size_t    queue_sz;
+    bool*     is_queued;
+};
+
+static Ir_instr* instr_at(Context* ctx, size_t iter)
+{
+    if(iter >= ctx->ir->buffer_sz || ctx->ir->buffer[iter].type != IR_INSTR)
+        return nullptr;
+
+    return &ctx->ir->buffer[iter];
+}
+
+static size_t next(Context* ctx, size_t iter)
+{
+    iter++;
+    while(iter < ctx->ir->buffer_sz && ctx->ir->buffer[iter].type == IR_NOP)
+        iter++;
+
+    return iter;
+}
+
+// Recomputes liveness of instruction from its successors, returns true if it has changed
+static bool live_update(Context* ctx, size_t iter)
+{
+    Ir*       ir  = ctx->ir;
+    Ir_instr* cur = &ir->buffer[iter];
+
+    uint32_t out     = 0;
+    bool     is_next = true;
+
+    if(cur->type == IR_INSTR)
+    {
+        if(cur->is_jump)
+            out |= ctx->live_in[ctx->labels[cur->label]];
+
+        if(cur->instr.mnemonic == JMP || cur->instr.mnemonic == RET)
+            is_next = false;
+    }
+
+    if(is_next && iter + 1 < ir->buffer_sz)
+        out |= ctx->live_in[iter + 1];
+
+    uint32_t in = out;
+    if(cur->type == IR_INSTR)
+    {
+        Effect eff = effect(cur->instr);
+        in = eff.use | (out & ~eff.def);
+    }
+
+    if(in == ctx->live_in[iter] && out == ctx->live_out[iter])
+        return false;
+
+    ctx->live_in[iter]  = in;
+    ctx->live_out[iter] = out;
+
+    return true;
+}
+
+static void liveness(Context* ctx)
+{
+    Ir* ir = ctx->ir;
+
+    for(size_t iter = 0; iter < ir->buffer_sz; iter++)
+    {
+        if(ir->buffer[iter].type == IR_LABEL)
+            ctx->labels[ir->buffer[iter].label] = iter;
+
+        ctx->live_in[iter]  = 0;
+        ctx->live_out[iter] = 0;
+    }
+
+    bool is_changed = true;
+    while(is_changed)
+    {
+        is_changed = false;
+
+        for(size_t iter = ir->buffer_sz; iter-- > 0; )
+            is_changed |= live_update(ctx, iter);
+    }
+}
+
+// Instruction is rewritten, its liveness and liveness of its predecessors are to be recomputed
+static void touch(Context* ctx, size_t iter)
+{
+    if(ctx->is_queued[iter])
+        return;
+
+    ctx->is_queued[iter] = true;
+    ctx->queue[ctx->queue_sz++] = iter;
+}
+
+// Spreads changes from touched instructions backwards until liveness stops changing. Result is
+// correct, but registers which were live only around a loop may stay live until next liveness()
+static void live_patch(Context* ctx)
+{
+    Ir* ir = ctx->ir;
+
+    while(ctx->queue_sz)
+    {
+        size_t iter = ctx->queue[--ctx->queue_sz];
+        ctx->is_queued[iter] = false;
+
+        if(!live_update(ctx, iter))
+            continue;
+
+        if(iter > 0)
+            touch(ctx, iter - 1);
+
+        if(ir->buffer[iter].type == IR_LABEL)
+        {
+            size_t label = ir->buffer[iter].label;
+            for(size_t jump = ctx->jumps_begin[label]; jump < ctx->jumps_begin[label + 1]; jump++)
+                touch(ctx, ctx->jumps[jump]);
+        }
+    }
+}
+
+// Jumps are never added, so predecessors of labels are collected once
+static void collect_jumps(Context* ctx)
+{
+    Ir* ir = ctx->ir;
+
+    for(size_t iter = 0; iter < ir->buffer_sz; iter++)
+    {
+        if(ir->buffer[iter].type == IR_INSTR && ir->buffer[iter].is_jump)
+            ctx->jumps_begin[ir->buffer[iter].label + 1]++;
+    }
+
+    for(size_t label = 0; label < ir->labels_sz; label++)
+        ctx->jumps_begin[label + 1] += ctx->jumps_begin[label];
+
+    for(size_t iter = 0; iter < ir->buffer_sz; iter++)
+    {
+        if(ir->buffer[iter].type == IR_INSTR && ir->buffer[iter].is_jump)
+            ctx->jumps[ctx->jumps_begin[ir->buffer[iter].label]++] = iter;
+    }
+
+    // Each begin has moved to the end of its range, which is the next begin
+    for(size_t label = ir->labels_sz; label > 0; label--)
+        ctx->jumps_begin[label] = ctx->jumps_begin[label - 1];
+
+    ctx->jumps_begin[0] = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+// push a; pop b -> mov b, a
+static bool rule_push_pop(Context* ctx, size_t iter)
+{
+    Ir_instr* push = instr_at(ctx, iter);
+    if(!push || push->instr.mnemonic != PUSH || push->instr.op1.type != OP_REGISTER)
+        return false;
+
+    Ir_instr* pop = instr_at(ctx, next(ctx, iter));
+    if(!pop || pop->instr.mnemonic != POP || pop->instr.op1.type != OP_REGISTER)
+        return false;
+
+    if(is_equal(push->instr.op1, pop->instr.op1))
+        push->type  = IR_NOP;
+    else
+        push->instr = {MOV, pop->instr.op1, push->instr.op1};
+
+    pop->type = IR_NOP;
+
+    touch(ctx, iter);
+    touch(ctx, next(ctx, iter));
+
+    return true;
+}
+
+// Instruction whose results are never read
+static bool rule_dead_code(Context* ctx, size_t iter)
+{
+    Ir_instr* cur = instr_at(ctx, iter);
+    if(!cur)
+        return false;
+
+    if(cur->instr.mnemonic == MOV && cur->instr.op1.type == OP_REGISTER && is_equal(cur->instr.op1, cur->instr.op2))
+    {
+        cur->type = IR_NOP;
+        touch(ctx, iter);
+        return true;
+    }
+
+    Effect eff = effect(cur->instr);
+    if(eff.is_fixed || !eff.def || (eff.def & ctx->live_out[iter]))
+        return false;
+
+    cur->type = IR_NOP;
+    touch(ctx, iter);
+
+    return true;
+}
+
+static bool substitute_index(Operand* op, Operand tmp, Operand src)
+{
+    if(op->type != OP_MEMORY)
+        return true;
+
+    if(op->mem.is_base && op->mem.base == tmp.reg.id)
+        return false;
+
+    if(!op->mem.is_index || op->mem.index != tmp.reg.id)
+        return true;
+
+    if(src.type != OP_REGISTER || is_equal(src, RSP))
+        return false;
+
+    op->mem.index = src.reg.id;
+
+    return true;
+}
+
+// Replaces reads of register 'tmp' with 'src'
+static bool substitute(Instruction* instr, Operand tmp, Operand src)
+{
+    if(!is_op1_written(instr->mnemonic) && is_equal(instr->op1, tmp))
+        instr->op1 = src;
+
+    if(is_equal(instr->op2, tmp))
+        instr->op2 = src;
+
+    return substitute_index(&instr->op1, tmp, src) && substitute_index(&instr->op2, tmp, src);
+}
+
+// mov t, x; ...; op (t) -> ...; op (x), if t is not used anymore
+static bool rule_forward(Context* ctx, size_t iter)
+{
+    Ir_instr* mov = instr_at(ctx, iter);
+    if(!mov || mov->instr.mnemonic != MOV || mov->instr.op1.type != OP_REGISTER)
+        return false;
+
+    Operand  tmp      = mov->instr.op1;
+    Operand  src      = mov->instr.op2;
+    uint32_t tmp_bit  = reg_bit(tmp);
+    uint32_t src_bits = read_bits(src);
+
+    if(((tmp_bit | src_bits) & FRAME_REGS) || (src_bits & tmp_bit))
+        return false;
+
+    size_t user = next(ctx, iter);
+    for( ; user < ctx->ir->buffer_sz; user = next(ctx, user))
+    {
+        Ir_instr* ptr = instr_at(ctx, user);
+        if(!ptr)
+            return false;
+
+        Effect eff = effect(ptr->instr);
+        if((eff.use | eff.def) & tmp_bit)
+            break;
+
+        if((eff.def & src_bits) || eff.is_fixed)
+            return false;
+    }
+
+    Ir_instr* ptr = instr_at(ctx, user);
+    if(!ptr || !(effect(ptr->instr).use & tmp_bit))
+        return false;
+
+    if(mov->is_reloc && ptr->is_reloc)
+        return false;
+
+    Instruction res = ptr->instr;
+    if(!substitute(&res, tmp, src) || !is_legal(res))
+        return false;
+
+    Effect eff = effect(res);
+    if((eff.use & tmp_bit) || (!(eff.def & tmp_bit) && (ctx->live_out[user] & tmp_bit)))
+        return false;
+
+    ptr->instr = res;
+    if(mov->is_reloc)
+    {
+        ptr->is_reloc  = true;
+        ptr->sym_index = mov->sym_index;
+        ptr->addend    = mov->addend;
+    }
+
+    mov->type = IR_NOP;
+
+    touch(ctx, iter);
+    touch(ctx, user);
+
+    return true;
+}
+
+// mov t, x; op t, y; mov x, t -> op x, y
+static bool rule_fold_op(Context* ctx, size_t iter)
+{
+    Ir_instr* load = instr_at(ctx, iter);
+    if(!load || load->instr.mnemonic != MOV || load->instr.op1.type != OP_REGISTER ||
+       load->instr.op2.type == OP_IMM32)
+        return false;
+
+    Operand  tmp     = load->instr.op1;
+    Operand  dst     = load->instr.op2;
+    uint32_t tmp_bit = reg_bit(tmp);
+
+    if(read_bits(dst) & tmp_bit)
+        return false;
+
+    size_t    op_iter = next(ctx, iter);
+    Ir_instr* op      = instr_at(ctx, op_iter);
+    if(!op || !is_ariphmetic(op->instr.mnemonic) || !is_equal(op->instr.op1, tmp) ||
+       (read_bits(op->instr.op2) & tmp_bit))
+        return false;
+
+    size_t    store_iter = next(ctx, op_iter);
+    Ir_instr* store      = instr_at(ctx, store_iter);
+    if(!store || store->instr.mnemonic != MOV || !is_equal(store->instr.op1, dst) || !is_equal(store->instr.op2, tmp))
+        return false;
+
+    if(ctx->live_out[store_iter] & tmp_bit)
+        return false;
+
+    if(load->is_reloc != store->is_reloc ||
+       (load->is_reloc && (load->sym_index != store->sym_index || load->addend != store->addend)))
+        return false;
+
+    Instruction res = {op->instr.mnemonic, dst, op->instr.op2};
+    if(!is_legal(res) || (load->is_reloc && op->is_reloc))
+        return false;
+
+    op->instr = res;
+    if(load->is_reloc)
+    {
+        op->is_reloc  = true;
+        op->sym_index = load->sym_index;
+        op->addend    = load->addend;
+    }
+
+    load->type  = IR_NOP;
+    store->type = IR_NOP;
+
+    touch(ctx, iter);
+    touch(ctx, op_iter);
+    touch(ctx, store_iter);
+
+    return true;
+}
+
+static Mnemonic branch(Mnemonic setcc, bool is_inverted)
+{
+    switch(setcc)
+    {
+        case SETE:  return is_inverted ? JNE : JE;
+        case SETNE: return is_inverted ? JE  : JNE;
+        case SETGE: return is_inverted ? JL  : JGE;
+        case SETLE: return is_inverted ? JG  : JLE;
+        case SETG:  return is_inverted ? JLE : JG;
+        case SETL:  return is_inverted ? JGE : JL;
+        case ADD:  case SUB:  case IMUL: case CQO:  case IDIV: case AND:  case TEST: case XOR:
+        case OR:   case MOV:  case LEA:  case CMP:  case PUSH: case POP:  case CALL: case RET:
+        case JMP:  case JE:   case JNE:  case JL:   case JG:   case JLE:  case JGE:
+        case INVALID_INSTR:
+        default:
+            assert(0 && "Not a setcc instruction");
+            return INVALID_INSTR;
+    }
+}
+
+// xor r, r; cmp a, b; setcc r; test r, r; je/jne L -> cmp a, b; jcc L
+static bool rule_setcc_branch(Context* ctx, size_t iter)
+{
+    Ir_instr* zero = instr_at(ctx, iter);
+    if(!zero || zero->instr.mnemonic != XOR || zero->instr.op1.type != OP_REGISTER ||
+       !is_equal(zero->instr.op1, zero->instr.op2))
+        return false;
+
+    Operand  reg     = zero->instr.op1;
+    uint32_t reg_msk = reg_bit(reg);
+
+    size_t    cmp_iter = next(ctx, iter);
+    Ir_instr* cmp      = instr_at(ctx, cmp_iter);
+    if(!cmp || (cmp->instr.mnemonic != CMP && cmp->instr.mnemonic != TEST) ||
+       ((read_bits(cmp->instr.op1) | read_bits(cmp->instr.op2)) & reg_msk))
+        return false;
+
+    size_t    set_iter = next(ctx, cmp_iter);
+    Ir_instr* set      = instr_at(ctx, set_iter);
+    if(!set || !is_setcc(set->instr.mnemonic) || !is_equal(set->instr.op1, reg))
+        return false;
+
+    size_t    test_iter = next(ctx, set_iter);
+    Ir_instr* test      = instr_at(ctx, test_iter);
+    if(!test || test->instr.mnemonic != TEST || !is_equal(test->instr.op1, reg) || !is_equal(test->instr.op2, reg))
+        return false;
+
+    size_t    jump_iter = next(ctx, test_iter);
+    Ir_instr* jump      = instr_at(ctx, jump_iter);
+    if(!jump || !jump->is_jump || (jump->instr.mnemonic != JE && jump->instr.mnemonic != JNE))
+        return false;
+
+    if(ctx->live_out[jump_iter] & reg_msk)
+        return false;
+
+    jump->instr.mnemonic = branch(set->instr.mnemonic, jump->instr.mnemonic == JE);
+
+    zero->type = IR_NOP;
+    set->type  = IR_NOP;
+    test->type = IR_NOP;
+
+    touch(ctx, iter);
+    touch(ctx, set_iter);
+    touch(ctx, test_iter);
+    touch(ctx, jump_iter);
+
+    return true;
+}
+
+// jmp L; L: -> L:
+static bool rule_jump_next(Context* ctx, size_t iter)
+{
+    Ir_instr* jump = instr_at(ctx, iter);
+    if(!jump || !jump->is_jump || jump->instr.mnemonic != JMP)
+        return false;
+
+    for(size_t label = next(ctx, iter); label < ctx->ir->buffer_sz; label = next(ctx, label))
+    {
+        if(ctx->ir->buffer[label].type != IR_LABEL)
+            return false;
+
+        if(ctx->ir->buffer[label].label == jump->label)
+        {
+            jump->type = IR_NOP;
+            touch(ctx, iter);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void context_dstr(Context* ctx)
+{
+    free(ctx->live_in);
+    free(ctx->live_out);
+    free(ctx->labels);
+    free(ctx->jumps);
+    free(ctx->jumps_begin);
+    free(ctx->queue);
+    free(ctx->is_queued);
+}
+
+int peephole(Ir* ir, Peephole_stats* stats)
+{
+    assert(ir && stats);
+
+    Context ctx = {.ir = ir};
+
+    ctx.live_in     = (uint32_t*) calloc(ir->buffer_sz + 1, sizeof(uint32_t));
+    ctx.live_out    = (uint32_t*) calloc(ir->buffer_sz + 1, sizeof(uint32_t));
+    ctx.labels      = (size_t*)   calloc(ir->labels_sz + 1, sizeof(size_t));
+    ctx.jumps       = (size_t*)   calloc(ir->buffer_sz + 1, sizeof(size_t));
+    ctx.jumps_begin = (size_t*)   calloc(ir->labels_sz + 2, sizeof(size_t));
+    ctx.queue       = (size_t*)   calloc(ir->buffer_sz + 1, sizeof(size_t));
+    ctx.is_queued   = (bool*)     calloc(ir->buffer_sz + 1, sizeof(bool));
+
+    if(!ctx.live_in || !ctx.live_out || !ctx.labels || !ctx.jumps || !ctx.jumps_begin || !ctx.queue || !ctx.is_queued)
+    {
+        context_dstr(&ctx);
+        ASSERT_RET$(0, PEEPHOLE_BAD_ALLOC);
+    }
+
+    collect_jumps(&ctx);
+    liveness(&ctx);
+
+    // Rules are applied until none of them matches. After each rewrite liveness is patched locally,
+    // after each sweep with rewrites it is recomputed to drop what patching has kept
+    bool is_rewritten = true;
+    while(is_rewritten)
+    {
+        is_rewritten = false;
+
+        for(size_t iter = 0; iter < ir->buffer_sz; iter++)
+        {
+            bool is_matched = false;
+
+            #define DEF_RULE(ENUM, FUNC, DESCR)                         \
+                if(!is_matched && rule_##FUNC(&ctx, iter))              \
+                {                                                       \
+                    stats->rewrites[PEEPHOLE_##ENUM]++;                 \
+                    is_matched = true;                                  \
+                }                                                       \
+
+            #include "peephole.inc"
+
+            #undef DEF_RULE
+
+            if(!is_matched)
+                continue;
+
+            live_patch(&ctx);
+            is_rewritten = true;
+        }
+
+        if(is_rewritten)
+            liveness(&ctx);
+    }
+
+    ir_compact(ir);
+
+    context_dstr(&ctx);
+
+    return 0;
+}
+
+void peephole_dump(const Peephole_stats* stats)
+{
+    assert(stats);
+
+    MSG$("Peephole rewrites:");
+
+    #define DEF_RULE(ENUM, FUNC, DESCR)                                     \
+        MSG$("    %-28s %zu", DESCR, stats->rewrites[PEEPHOLE_##ENUM]);     \
+
+    #include "peephole.inc"
+
+    #undef DEF_RULE
+}
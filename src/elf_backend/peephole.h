@@ -0,0 +1,31 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ir.h"
+
+#define DEF_RULE(ENUM, FUNC, DESCR) \
+    PEEPHOLE_##ENUM,                \
+
+enum Peephole_rule
+{
+    #include "peephole.inc"
+
+    PEEPHOLE_RULES_SZ,
+};
+
+#undef DEF_RULE
+
+// Number of rewrites made by each rule
+struct Peephole_stats
+{
+    size_t rewrites[PEEPHOLE_RULES_SZ];
+};
+
+// Rewrites instructions of one function using register liveness
+int  peephole     (Ir* ir, Peephole_stats* stats);
+void peephole_dump(const Peephole_stats* stats);
+
+#endif // PEEPHOLE_H
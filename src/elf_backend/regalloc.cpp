@@ -0,0 +1,294 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+
+#include "regalloc.h"
+#include "../../include/logs/logs.h"
+
+enum regalloc_err
+{
+    REGALLOC_NOERR     = 0,
+    REGALLOC_BAD_ALLOC = 1,
+};
+
+// Occurrence weight grows by 8 per nesting level, deeper loops are not distinguished
+static const int MAX_WEIGHT_DEPTH = 6;
+
+///////////////////////////////////////////////////////////////////////////////
+
+static int intervals_resize(Regalloc* ra, size_t new_cap)
+{
+    assert(ra);
+
+    assert(new_cap > ra->buffer_cap);
+
+    Interval* ptr = (Interval*) realloc(ra->buffer, new_cap * sizeof(Interval));
+    ASSERT_RET$(ptr, REGALLOC_BAD_ALLOC);
+
+    ra->buffer     = ptr;
+    ra->buffer_cap = new_cap;
+
+    return 0;
+}
+
+static int loops_resize(Regalloc* ra, size_t new_cap)
+{
+    assert(ra);
+
+    assert(new_cap > ra->loops_cap);
+
+    Loop* ptr = (Loop*) realloc(ra->loops, new_cap * sizeof(Loop));
+    ASSERT_RET$(ptr, REGALLOC_BAD_ALLOC);
+
+    ra->loops     = ptr;
+    ra->loops_cap = new_cap;
+
+    return 0;
+}
+
+int regalloc_ctor(Regalloc* ra)
+{
+    assert(ra);
+    *ra = {};
+
+    PASS$(!intervals_resize(ra, 32), return REGALLOC_BAD_ALLOC; );
+    PASS$(!loops_resize(ra, 8), return REGALLOC_BAD_ALLOC; );
+
+    return 0;
+}
+
+void regalloc_dtor(Regalloc* ra)
+{
+    assert(ra);
+
+    free(ra->buffer);
+    free(ra->loops);
+    id_index_dtor(&ra->index);
+
+    *ra = {};
+}
+
+int regalloc_find(Regalloc* ra, const char* id, int* reg)
+{
+    assert(ra && id);
+
+    size_t pos = 0;
+    if(id_index_find(&ra->index, id, &pos) != 0)
+        return 1;
+
+    if(reg)
+        *reg = ra->buffer[pos].reg;
+
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct Walker
+{
+    Regalloc*   ra;
+    Symtable*   globals;
+    const Tree* tree;
+
+    size_t      pos;
+    int         depth;
+};
+
+static int occurrence(Walker* walker, const char* id, bool is_indexed)
+{
+    Regalloc* ra = walker->ra;
+
+    if(symtable_find(walker->globals, id) == 0)
+        return 0;
+
+    size_t pos = 0;
+    if(id_index_find(&ra->index, id, &pos) != 0)
+    {
+        if(ra->buffer_sz == ra->buffer_cap)
+            PASS$(!intervals_resize(ra, ra->buffer_cap * 2), return REGALLOC_BAD_ALLOC; );
+
+        pos = ra->buffer_sz;
+        ra->buffer[pos] = {.id = id, .begin = walker->pos, .end = walker->pos, .weight = 0, .is_array = false, .reg = -1};
+        id_index_insert(&ra->index, id, pos, ra->buffer_sz);
+        ra->buffer_sz++;
+    }
+
+    Interval* ptr = &ra->buffer[pos];
+
+    int depth = (walker->depth < MAX_WEIGHT_DEPTH) ? walker->depth : MAX_WEIGHT_DEPTH;
+
+    ptr->end       = walker->pos;
+    ptr->weight   += 1ull << (3 * depth);
+    ptr->is_array |= is_indexed;
+
+    walker->pos++;
+
+    return 0;
+}
+
+// Visits variables in order of evaluation
+static int walk(Walker* walker, Node* node)
+{
+    if(!node)
+        return 0;
+
+    // Function name is not a variable
+    if(node_type(node) == TYPE_AUX && node_aux(node) == TOK_CALL)
+        return walk(walker, node_right(node));
+
+    if(node_type(node) == TYPE_OP && node_op(node) == TOK_ASSIGN)
+    {
+        PASS$(!walk(walker, node_right(node)), return REGALLOC_BAD_ALLOC; );
+        PASS$(!walk(walker, node_left(node)),  return REGALLOC_BAD_ALLOC; );
+
+        return 0;
+    }
+
+    if(node_type(node) == TYPE_ID)
+    {
+        PASS$(!walk(walker, node_right(node)), return REGALLOC_BAD_ALLOC; );
+        bool is_indexed = node_right(node) != nullptr;
+        PASS$(!occurrence(walker, node_name(walker->tree, node), is_indexed), return REGALLOC_BAD_ALLOC; );
+
+        return 0;
+    }
+
+    if(node_type(node) == TYPE_KEYWORD && node_key(node) == TOK_WHILE)
+    {
+        Regalloc* ra   = walker->ra;
+        Loop      loop = {.begin = walker->pos};
+
+        walker->depth++;
+        PASS$(!walk(walker, node_left(node)),  return REGALLOC_BAD_ALLOC; );
+        PASS$(!walk(walker, node_right(node)), return REGALLOC_BAD_ALLOC; );
+        walker->depth--;
+
+        loop.end = walker->pos;
+
+        // Inner loops are recorded before outer ones
+        if(ra->loops_sz == ra->loops_cap)
+            PASS$(!loops_resize(ra, ra->loops_cap * 2), return REGALLOC_BAD_ALLOC; );
+
+        ra->loops[ra->loops_sz] = loop;
+        ra->loops_sz++;
+
+        return 0;
+    }
+
+    PASS$(!walk(walker, node_left(node)),  return REGALLOC_BAD_ALLOC; );
+    PASS$(!walk(walker, node_right(node)), return REGALLOC_BAD_ALLOC; );
+
+    return 0;
+}
+
+// Variable used in loop may be live across its back edge, so it is live during the whole loop
+static void extend_intervals(Regalloc* ra)
+{
+    for(size_t loop = 0; loop < ra->loops_sz; loop++)
+    {
+        Loop cur = ra->loops[loop];
+
+        if(cur.begin == cur.end)
+            continue;
+
+        for(size_t iter = 0; iter < ra->buffer_sz; iter++)
+        {
+            Interval* ptr = &ra->buffer[iter];
+
+            if(ptr->begin >= cur.end || ptr->end < cur.begin)
+                continue;
+
+            if(ptr->begin > cur.begin)
+                ptr->begin = cur.begin;
+            if(ptr->end < cur.end - 1)
+                ptr->end = cur.end - 1;
+        }
+    }
+}
+
+static int interval_cmp(const void* lhs, const void* rhs)
+{
+    size_t lhs_begin = ((const Interval*) lhs)->begin;
+    size_t rhs_begin = ((const Interval*) rhs)->begin;
+
+    return (lhs_begin > rhs_begin) - (lhs_begin < rhs_begin);
+}
+
+static void linear_scan(Regalloc* ra, int n_regs, uint32_t* used_mask)
+{
+    assert(n_regs <= 32);
+
+    qsort(ra->buffer, ra->buffer_sz, sizeof(Interval), interval_cmp);
+
+    // Sorting moves intervals, so index is built anew
+    id_index_clear(&ra->index);
+    for(size_t iter = 0; iter < ra->buffer_sz; iter++)
+        id_index_insert(&ra->index, ra->buffer[iter].id, iter, iter);
+
+    // Active[reg] is interval occupying register or nullptr
+    Interval* active[32] = {};
+
+    for(size_t iter = 0; iter < ra->buffer_sz; iter++)
+    {
+        Interval* cur = &ra->buffer[iter];
+
+        if(cur->is_array)
+            continue;
+
+        int free_reg = -1;
+        int cheapest = -1;
+
+        for(int reg = n_regs - 1; reg >= 0; reg--)
+        {
+            if(active[reg] && active[reg]->end < cur->begin)
+                active[reg] = nullptr;
+
+            if(!active[reg])
+                free_reg = reg;
+            else if(cheapest < 0 || active[reg]->weight < active[cheapest]->weight)
+                cheapest = reg;
+        }
+
+        if(free_reg < 0 && cheapest >= 0 && active[cheapest]->weight < cur->weight)
+        {
+            // Spilled variable stays in frame for its whole interval
+            active[cheapest]->reg = -1;
+            free_reg = cheapest;
+        }
+
+        if(free_reg < 0)
+            continue;
+
+        cur->reg         = free_reg;
+        active[free_reg] = cur;
+        *used_mask      |= 1u << free_reg;
+    }
+}
+
+int regalloc_function(Regalloc* ra, Symtable* globals, const Tree* tree, Node* define, int n_regs,
+                      uint32_t* used_mask)
+{
+    assert(ra && globals && tree && define && used_mask);
+    assert(node_type(define) == TYPE_AUX && node_aux(define) == TOK_DEFINE);
+
+    ra->buffer_sz = 0;
+    ra->loops_sz  = 0;
+    id_index_clear(&ra->index);
+    *used_mask    = 0;
+
+    Walker walker = {.ra = ra, .globals = globals, .tree = tree, .pos = 0, .depth = 0};
+
+    // Parameters are defined at function entry
+    if(node_left(define))
+        PASS$(!walk(&walker, node_right(node_left(define))), return REGALLOC_BAD_ALLOC; );
+
+    PASS$(!walk(&walker, node_right(define)), return REGALLOC_BAD_ALLOC; );
+
+    extend_intervals(ra);
+    linear_scan(ra, n_regs, used_mask);
+
+    return 0;
+}
@@ -0,0 +1,50 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../tree/Tree.h"
+#include "symtable.h"
+
+// Live interval of local variable, positions are numbers of variable occurrences in function body
+struct Interval
+{
+    const char* id;
+
+    size_t   begin;
+    size_t   end;
+    uint64_t weight;    // occurrences weighted by loop nesting
+
+    bool     is_array;  // declared with size or used with index, never in register
+    int      reg;       // index of allocated register, -1 if variable stays in frame
+};
+
+struct Loop
+{
+    size_t begin;
+    size_t end;
+};
+
+struct Regalloc
+{
+    Interval* buffer;
+    size_t    buffer_sz;
+    size_t    buffer_cap;
+
+    Loop*     loops;
+    size_t    loops_sz;
+    size_t    loops_cap;
+
+    Id_index  index;    // position of interval in buffer by id
+};
+
+int  regalloc_ctor(Regalloc* ra);
+void regalloc_dtor(Regalloc* ra);
+
+// Linear scan over scalar locals of function 'define', sets bits of used registers in 'used_mask'
+int  regalloc_function(Regalloc* ra, Symtable* globals, const Tree* tree, Node* define, int n_regs,
+                      uint32_t* used_mask);
+int  regalloc_find    (Regalloc* ra, const char* id, int* reg);
+
+#endif // REGALLOC_H
@@ -10,6 +10,119 @@
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// FNV-1a, ids come from several nametables, so they are hashed by content
+static uint64_t id_hash(const char* id)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for(const unsigned char* ptr = (const unsigned char*) id; *ptr; ptr++)
+    {
+        hash ^= *ptr;
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+static bool id_slot_is_used(const Id_index* idx, size_t pos)
+{
+    return idx->slots[pos].generation == idx->generation;
+}
+
+int id_index_find(const Id_index* idx, const char* key, size_t* entry)
+{
+    assert(idx && key);
+
+    if(!idx->slots_cap)
+        return 1;
+
+    uint64_t hash = id_hash(key);
+    size_t   mask = idx->slots_cap - 1;
+
+    for(size_t pos = hash & mask; id_slot_is_used(idx, pos); pos = (pos + 1) & mask)
+    {
+        const Id_slot* slot = &idx->slots[pos];
+
+        if(slot->hash == hash && strcmp(slot->id, key) == 0)
+        {
+            if(entry)
+                *entry = slot->entry;
+
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static void id_index_place(Id_index* idx, Id_slot slot)
+{
+    size_t mask = idx->slots_cap - 1;
+    size_t pos  = slot.hash & mask;
+
+    while(id_slot_is_used(idx, pos))
+        pos = (pos + 1) & mask;
+
+    slot.generation = idx->generation;
+    idx->slots[pos] = slot;
+}
+
+static int id_index_resize(Id_index* idx, size_t new_cap)
+{
+    assert(idx);
+
+    Id_slot* old_slots = idx->slots;
+    size_t   old_cap   = idx->slots_cap;
+    uint64_t old_gen   = idx->generation;
+
+    idx->slots = (Id_slot*) calloc(new_cap, sizeof(Id_slot));
+    assert(idx->slots);
+
+    idx->slots_cap  = new_cap;
+    idx->generation = 1;
+
+    for(size_t iter = 0; iter < old_cap; iter++)
+    {
+        if(old_slots[iter].generation == old_gen)
+            id_index_place(idx, old_slots[iter]);
+    }
+
+    free(old_slots);
+
+    return 0;
+}
+
+// Load factor is kept under 1/2
+int id_index_insert(Id_index* idx, const char* key, size_t entry, size_t n_entries)
+{
+    assert(idx && key);
+
+    if((n_entries + 1) * 2 > idx->slots_cap)
+        id_index_resize(idx, idx->slots_cap ? idx->slots_cap * 2 : 64);
+
+    id_index_place(idx, {.id = key, .hash = id_hash(key), .entry = entry, .generation = 0});
+
+    return 0;
+}
+
+void id_index_clear(Id_index* idx)
+{
+    assert(idx);
+
+    idx->generation++;
+}
+
+void id_index_dtor(Id_index* idx)
+{
+    assert(idx);
+
+    free(idx->slots);
+
+    *idx = {};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 static int symtable_resize(Symtable* tbl, size_t new_cap)
 {
     assert(tbl);
@@ -40,6 +153,7 @@ void symtable_dtor(Symtable* tbl)
     assert(tbl);
 
     free(tbl->buffer);
+    id_index_dtor(&tbl->index);
 
     *tbl = {};
 }
@@ -48,20 +162,16 @@ int symtable_find(Symtable* tbl, const char* key, Symbol* ret, uint64_t* retinde
 {
     assert(tbl && key);
 
-    for(size_t iter = 0; iter < tbl->buffer_sz; iter++)
-    {
-        if(strcmp(key, tbl->buffer[iter].id) == 0) // all id's are in nametable, ptr equality => id's equality
-        {
-            if(ret)
-                *ret = tbl->buffer[iter];
-            if(retindex)
-                *retindex = iter;
-            
-            return 0;
-        }
-    }
+    size_t iter = 0;
+    if(id_index_find(&tbl->index, key, &iter) != 0)
+        return 1;
 
-    return 1;
+    if(ret)
+        *ret = tbl->buffer[iter];
+    if(retindex)
+        *retindex = iter;
+
+    return 0;
 }
 
 int symtable_insert(Symtable* tbl, Symbol sym, uint64_t* retindex)
@@ -76,6 +186,8 @@ int symtable_insert(Symtable* tbl, Symbol sym, uint64_t* retindex)
     if(retindex)
         *retindex = tbl->buffer_sz;
 
+    id_index_insert(&tbl->index, sym.id, tbl->buffer_sz, tbl->buffer_sz);
+
     tbl->buffer[tbl->buffer_sz] = sym;
     tbl->buffer_sz++;
 
@@ -115,6 +227,7 @@ void localtable_dtor(Localtable* tbl)
     assert(tbl);
 
     free(tbl->buffer);
+    id_index_dtor(&tbl->index);
 
     *tbl = {};
 }
@@ -123,18 +236,14 @@ int localtable_find(Localtable* tbl, const char* key, Local_var* ret)
 {
     assert(tbl && key);
     
-    for(size_t iter = 0; iter < tbl->buffer_sz; iter++)
-    {
-        if(strcmp(key, tbl->buffer[iter].id) == 0)
-        {
-            if(ret)
-                *ret = tbl->buffer[iter];
+    size_t iter = 0;
+    if(id_index_find(&tbl->index, key, &iter) != 0)
+        return 1;
 
-            return 0;
-        }
-    }
+    if(ret)
+        *ret = tbl->buffer[iter];
 
-    return 1;
+    return 0;
 }
 
 int localtable_allocate(Localtable* tbl, Local_var* var)
@@ -148,6 +257,18 @@ int localtable_allocate(Localtable* tbl, Local_var* var)
 
     if(tbl->buffer_cap == tbl->buffer_sz)
         localtable_resize(tbl, tbl->buffer_cap * 2);
+
+    id_index_insert(&tbl->index, var->id, tbl->buffer_sz, tbl->buffer_sz);
+
+    // Register variable doesn't occupy frame
+    if(var->is_register)
+    {
+        var->offset = 0;
+        tbl->buffer[tbl->buffer_sz] = *var;
+        tbl->buffer_sz++;
+
+        return 0;
+    }
     
     assert(var->size < INT32_MAX);
     var->offset = tbl->offset_top - (int32_t) var->size * 8;
@@ -172,6 +293,8 @@ int localtable_set_parameter(Localtable* tbl, Local_var* var)
 
     assert(tbl->offset_bottom >= 16 && "Smashing saved rbp or return address");
 
+    id_index_insert(&tbl->index, var->id, tbl->buffer_sz, tbl->buffer_sz);
+
     var->offset = tbl->offset_bottom;
     tbl->buffer[tbl->buffer_sz] = *var;
     tbl->buffer_sz++;
@@ -181,6 +304,17 @@ int localtable_set_parameter(Localtable* tbl, Local_var* var)
     return 0;
 }
 
+// Reserves frame slot which is not bound to variable
+int32_t localtable_reserve(Localtable* tbl, size_t size)
+{
+    assert(tbl);
+
+    assert(size < INT32_MAX);
+    tbl->offset_top -= (int32_t) size * 8;
+
+    return tbl->offset_top;
+}
+
 void localtable_clean(Localtable* tbl)
 {
     assert(tbl);
@@ -188,4 +322,6 @@ void localtable_clean(Localtable* tbl)
     tbl->buffer_sz     =  0;
     tbl->offset_top    =  0;
     tbl->offset_bottom = 16;
+
+    id_index_clear(&tbl->index);
 }
@@ -6,6 +6,30 @@
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Slot of open-addressing index, empty unless its generation is current
+struct Id_slot
+{
+    const char* id;
+    uint64_t    hash;
+    size_t      entry;
+    uint64_t    generation;
+};
+
+// Index of table entries by id, cleared in O(1) by advancing generation
+struct Id_index
+{
+    Id_slot*  slots      = nullptr;
+    size_t    slots_cap  = 0; // power of 2
+    uint64_t  generation = 1;
+};
+
+int  id_index_find  (const Id_index* idx, const char* key, size_t* entry = nullptr);
+int  id_index_insert(Id_index* idx, const char* key, size_t entry, size_t n_entries);
+void id_index_clear (Id_index* idx);
+void id_index_dtor  (Id_index* idx);
+
+///////////////////////////////////////////////////////////////////////////////
+
 enum Symbol_type
 {
     SYMBOL_TYPE_NOTYPE   = 0x0,
@@ -46,6 +70,8 @@ struct Symtable
     Symbol*   buffer     = nullptr;
     size_t    buffer_sz  = 0;
     size_t    buffer_cap = 0;
+
+    Id_index  index      = {};
 };
 
 int  symtable_ctor(Symtable* tbl);
@@ -62,6 +88,9 @@ struct Local_var
     int32_t     offset;
     size_t      size;
     bool        is_const;
+
+    bool        is_register; // kept in register 'reg' instead of frame slot
+    uint8_t     reg;
 };
 
 struct Localtable
@@ -72,6 +101,8 @@ struct Localtable
 
     int32_t    offset_top    = 0; // right after variable with highest address
     int32_t    offset_bottom = 0; // offset of variable with lowest address
+
+    Id_index   index         = {};
 };
 
 int  localtable_ctor (Localtable* tbl);
@@ -83,6 +114,8 @@ int  localtable_find(Localtable* tbl, const char* key, Local_var* ret = nullptr)
 int  localtable_allocate     (Localtable* tbl, Local_var* var);
 int  localtable_set_parameter(Localtable* tbl, Local_var* var);
 
+int32_t localtable_reserve(Localtable* tbl, size_t size);
+
 ///////////////////////////////////////////////////////////////////////////////
 
 void symtable_dump_init(FILE* dump_stream);
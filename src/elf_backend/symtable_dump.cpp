@@ -104,17 +104,17 @@ void localtable_dump(Localtable* tbl)
         return;
 
     PRINT("\n\n<table class = \"log\" border=\"1\" style=\"border-collapse:collapse; border-color:E59E1F; border-width: 1px; width: 800px;\"><tbody>\n"
-          "<tr><th colspan=\"3\" class = \"title\">Local table</th></tr>\n");
+          "<tr><th colspan=\"4\" class = \"title\">Local table</th></tr>\n");
         
-    PRINT("<tr><td colspan=\"3\">\n\tsize: %lu\n</td></tr>\n"
-          "<tr><td colspan=\"3\">\n\tcapacity: %lu\n</td></tr>\n",
+    PRINT("<tr><td colspan=\"4\">\n\tsize: %lu\n</td></tr>\n"
+          "<tr><td colspan=\"4\">\n\tcapacity: %lu\n</td></tr>\n",
           tbl->buffer_sz, tbl->buffer_cap);
     
-    PRINT("<tr><th>id</th><th>offset</th><th>size</th></tr>\n");
+    PRINT("<tr><th>id</th><th>offset</th><th>size</th><th>register</th></tr>\n");
     
     if(!tbl->buffer)
     {
-        PRINT("<tr><th colspan=\"3\" class = \"error\">\n\tDATA IS NULL\n</th></tr>\n"
+        PRINT("<tr><th colspan=\"4\" class = \"error\">\n\tDATA IS NULL\n</th></tr>\n"
               "</tbody></table>\n");
         return;
     }
@@ -133,6 +133,11 @@ void localtable_dump(Localtable* tbl)
               "<td>  %lu  </td>\n",
               ptr->id, ptr->offset, ptr->size);
 
+        if(ptr->is_register)
+            PRINT("<td>  %u  </td>\n", ptr->reg);
+        else
+            PRINT("<td>  -  </td>\n");
+
         PRINT("</tr>\n");
     }
 
@@ -1,6 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/stat.h>
+#include <string.h>
 #include <assert.h>
 
 #include "parser.h"
@@ -9,16 +9,17 @@
 #include "../common/dumpsystem.h"
 #include "../common/jumps.h"
 #include "../common/args.h"
+#include "../common/input.h"
 
-static int get_file_sz_(const char filename[], size_t* sz)
+static const char BINARY_SUFFIX_[] = ".treeb";
+
+// Tree is written in binary format if name of output file ends with BINARY_SUFFIX_
+static bool is_binary_name_(const char filename[])
 {
-    struct stat buff = {};
-    if(stat(filename, &buff) == -1)
-        return -1;
-    
-    *sz = (size_t) buff.st_size;
-    
-    return 0;
+    size_t len        = strlen(filename);
+    size_t suffix_len = sizeof(BINARY_SUFFIX_) - 1;
+
+    return len >= suffix_len && strcmp(filename + len - suffix_len, BINARY_SUFFIX_) == 0;
 }
 
 int main(int argc, char* argv[])
@@ -30,18 +31,15 @@ int main(int argc, char* argv[])
     char  outfile_name[FILENAME_MAX] = "";
     char* depfile_name = nullptr;
 
-    char* data = nullptr;
-
-    FILE* istream = nullptr;
     FILE* ostream = nullptr;
 
+    Input input = {};
     Tree tree = {};
     Dependencies deps = {};
-    Token_array tok_arr = {};
+    Token_stream tok_stream = {};
     Token_nametable tok_table = {};
 
-    size_t file_sz = 0;
-    lexer_err lexer_error = LEXER_NOERR;
+    parser_err parser_error = PARSER_NOERR;
 
     args_msg msg = process_args(argc, argv, infile_name, outfile_name);
     if(msg)
@@ -51,44 +49,40 @@ int main(int argc, char* argv[])
     }
 
 TRY__
-    ASSERT$(get_file_sz_(infile_name, &file_sz) != -1,
-                                                FRONTEND_INFILE_FAIL,  FAIL__);
-
     ASSERT$(!dep_get_filename(&depfile_name, outfile_name),
                                                 FRONTEND_OUTFILE_FAIL, FAIL__);
                                                 
-    data = (char*) calloc(file_sz + 1, sizeof(char));
-    ASSERT$(data,                               FRONTEND_BAD_ALLOC,    FAIL__);
-
-    istream = fopen(infile_name, "r");
-    ASSERT$(istream,                            FRONTEND_INFILE_FAIL,  FAIL__);
-
-    file_sz = fread(data, sizeof(char), file_sz, istream);
-    ASSERT$(!ferror(istream),                   FRONTEND_READ_FAIL,    FAIL__);
+    ASSERT$(!input_open(&input, infile_name),   FRONTEND_INFILE_FAIL,  FAIL__);
 
-    fclose(istream);
-    istream = nullptr;
+    ASSERT$(!token_stream_ctor(&tok_stream, &tok_table, input.data, input.size),
+                                                FRONTEND_LEXER_FAIL,   FAIL__);
+    ASSERT$(!token_stream_prelex(&tok_stream),  FRONTEND_LEXER_FAIL,   FAIL__);
 
-    data = (char*) realloc(data, (file_sz + 1) * sizeof(char));
-    ASSERT$(data,                               FRONTEND_BAD_ALLOC,    FAIL__);
-    data[file_sz] = 0; // null-termination of buffer
+    // Tokens are lexed while parsing, lexer error cuts token stream and is reported first
+    parser_error = parse(&tree, &deps, &tok_stream);
 
-    lexer_error = lexer(&tok_arr, &tok_table, data, (ptrdiff_t) file_sz);
-    
-    free(data);
-    data = nullptr;
+    input_close(&input);
 
     token_nametable_dump(&tok_table);
-    token_array_dump(&tok_arr);
 
-    ASSERT$(!lexer_error,                       FRONTEND_LEXER_FAIL,   FAIL__);
+    ASSERT$(!tok_stream.err,                    FRONTEND_LEXER_FAIL,   FAIL__);
+    ASSERT$(!parser_error,                      FRONTEND_PARSER_FAIL,  FAIL__);
 
-    ASSERT$(!parse(&tree, &deps, &tok_arr),     FRONTEND_PARSER_FAIL,  FAIL__);
+    if(is_binary_name_(outfile_name))
+    {
+        ostream = fopen(outfile_name, "wb");
+        ASSERT$(ostream,                        FRONTEND_OUTFILE_FAIL, FAIL__);
 
-    ostream = fopen(outfile_name, "w");
-    ASSERT$(ostream,                            FRONTEND_OUTFILE_FAIL, FAIL__);
+        ASSERT$(!tree_write_binary(&tree, ostream),
+                                                FRONTEND_WRITE_FAIL,   FAIL__);
+    }
+    else
+    {
+        ostream = fopen(outfile_name, "w");
+        ASSERT$(ostream,                        FRONTEND_OUTFILE_FAIL, FAIL__);
 
-    tree_write(&tree, ostream);
+        tree_write(&tree, ostream);
+    }
     ASSERT$(!ferror(ostream),                   FRONTEND_WRITE_FAIL,   FAIL__);
 
     fclose(ostream);
@@ -106,18 +100,14 @@ TRY__
 CATCH__
     ERROR__ = 1;
 
-    if(istream)
-        fclose(istream);
-
     if(ostream)
         fclose(ostream);
-    
-    free(data);
 
 FINALLY__
+    input_close(&input);
     dep_dtor(&deps);
+    token_stream_dtor(&tok_stream);
     tree_dstr(&tree);
-    token_array_dstr(&tok_arr);
     token_nametable_dstr(&tok_table);
 
     free(depfile_name);
@@ -1,45 +1,200 @@
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
-#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif // __AVX2__
 
 #include "lexer.h"
 #include "../common/dumpsystem.h"
 #include "../reserved_names.h"
 
-static void clean_whitespaces_(const char data[], ptrdiff_t* pos)
+enum byte_class_
+{
+    BYTE_OTHER = 0,     // control bytes and bytes never valid in UTF-8
+    BYTE_SPACE = 1,
+    BYTE_PUNCT = 2,
+    BYTE_WORD  = 3,     // ASCII letters, digits and '_'
+    BYTE_CONT  = 4,     // UTF-8 continuation byte
+    BYTE_LEAD2 = 5,     // UTF-8 leading byte of 2-byte sequence
+    BYTE_LEAD3 = 6,
+    BYTE_LEAD4 = 7,
+};
+
+struct Byte_table_
+{
+    unsigned char cls[256];
+};
+
+// Same classes as "C" locale ctype gives to ASCII, without dependency on current locale
+static constexpr Byte_table_ byte_table_build_()
+{
+    Byte_table_ table = {};
+
+    for(int byte = 0; byte < 256; byte++)
+    {
+        unsigned char cls = BYTE_OTHER;
+
+        if(byte == ' ' || (byte >= '\t' && byte <= '\r'))
+            cls = BYTE_SPACE;
+        else if((byte >= '0' && byte <= '9') || (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z') || byte == '_')
+            cls = BYTE_WORD;
+        else if(byte > ' ' && byte < 0x7F)
+            cls = BYTE_PUNCT;
+        else if(byte >= 0x80 && byte <= 0xBF)
+            cls = BYTE_CONT;
+        else if(byte >= 0xC2 && byte <= 0xDF)
+            cls = BYTE_LEAD2;
+        else if(byte >= 0xE0 && byte <= 0xEF)
+            cls = BYTE_LEAD3;
+        else if(byte >= 0xF0 && byte <= 0xF4)
+            cls = BYTE_LEAD4;
+
+        table.cls[byte] = cls;
+    }
+
+    return table;
+}
+
+static constexpr Byte_table_ BYTE_TABLE_ = byte_table_build_();
+
+static inline unsigned char byte_class_(char byte)
+{
+    return BYTE_TABLE_.cls[(unsigned char) byte];
+}
+
+#ifdef __AVX2__
+
+// Mask of bytes of 32-byte block which are ASCII whitespaces
+static inline uint32_t space_mask_(const char data[])
+{
+    __m256i block = _mm256_loadu_si256((const __m256i*) data);
+
+    __m256i space = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' '));
+    __m256i ctrl  = _mm256_and_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8('\t' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), block));
+
+    return (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(space, ctrl));
+}
+
+// Mask of bytes of 32-byte block which are ASCII letters, digits or '_'
+static inline uint32_t word_mask_(const char data[])
+{
+    __m256i block = _mm256_loadu_si256((const __m256i*) data);
+    __m256i lower = _mm256_or_si256(block, _mm256_set1_epi8(0x20));
+
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8('0' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), block));
+    __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+    __m256i under = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('_'));
+
+    return (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(digit, alpha), under));
+}
+
+#endif // __AVX2__
+
+static void clean_whitespaces_(const char data[], ptrdiff_t data_sz, ptrdiff_t* pos)
 {
     assert(data && pos);
 
-    while(isspace(data[*pos]))
+#ifdef __AVX2__
+    while(*pos + 32 <= data_sz)
+    {
+        uint32_t mask = space_mask_(data + *pos);
+        if(mask != UINT32_MAX)
+        {
+            *pos += __builtin_ctz(~mask);
+            return;
+        }
+
+        *pos += 32;
+    }
+#endif // __AVX2__
+
+    while(*pos < data_sz && byte_class_(data[*pos]) == BYTE_SPACE)
         (*pos)++;
 }
 
-static bool get_number(const char data[], double* num, int* n_read)
+// Length of valid UTF-8 sequence of letter at the beginning of data, 0 if sequence is malformed
+static int utf8_seqlen_(const char data[], ptrdiff_t data_sz)
 {
-    if(isdigit(*data))
+    assert(data);
+
+    int len = 0;
+    switch(byte_class_(*data))
+    {
+        case BYTE_LEAD2: len = 2; break;
+        case BYTE_LEAD3: len = 3; break;
+        case BYTE_LEAD4: len = 4; break;
+        default:
+            return 0;
+    }
+
+    if(len > data_sz)
+        return 0;
+
+    for(int iter = 1; iter < len; iter++)
     {
-        sscanf(data, "%lg%n", num, n_read);
-        return true;
+        if(byte_class_(data[iter]) != BYTE_CONT)
+            return 0;
     }
 
-    return false;
+    return len;
 }
 
-static void wordlen_(const char data[], int* n_read)
+// Word consists of ASCII letters, digits, '_' and non-ASCII UTF-8 letters. Malformed UTF-8 ends the word
+static void wordlen_(const char data[], ptrdiff_t data_sz, int* n_read)
 {
     assert(data && n_read);
 
-    while((!ispunct(data[*n_read]) || data[*n_read] == '_') && !isspace(data[*n_read]))
-        (*n_read)++;
+    while(*n_read < data_sz)
+    {
+#ifdef __AVX2__
+        if(*n_read + 32 <= data_sz)
+        {
+            uint32_t mask = word_mask_(data + *n_read);
+            if(mask == UINT32_MAX)
+            {
+                *n_read += 32;
+                continue;
+            }
+
+            *n_read += __builtin_ctz(~mask);
+        }
+#endif // __AVX2__
+
+        unsigned char cls = byte_class_(data[*n_read]);
+
+        if(cls == BYTE_WORD)
+        {
+            (*n_read)++;
+            continue;
+        }
+
+        int seqlen = utf8_seqlen_(data + *n_read, data_sz - *n_read);
+        if(!seqlen)
+            break;
+
+        *n_read += seqlen;
+    }
 }
 
 #define lexer_err(MSG_, PTR_)                                                           \
 do                                                                                      \
 {                                                                                       \
+    if(stream->is_quiet)                                                                \
+        return LEXER_LEXICAL_ERROR;                                                     \
+                                                                                        \
     char tmp_buffer_[128] = "";                                                         \
-    strncpy(tmp_buffer_, (PTR_), 126);                                                  \
-    tmp_buffer_[127] = '\0';                                                            \
+    ptrdiff_t tmp_len_ = data + data_sz - (PTR_);                                       \
+    if(tmp_len_ > 126)                                                                  \
+        tmp_len_ = 126;                                                                 \
+    memcpy(tmp_buffer_, (PTR_), (size_t) tmp_len_);                                     \
                                                                                         \
     fprintf(stderr, "\x1b[31mLexer error:\x1b[0m %s : %s\n", (MSG_), tmp_buffer_);      \
     FILE* stream_ = dumpsystem_get_opened_stream();                                     \
@@ -55,81 +210,169 @@ do
     }                                                                                   \
 } while(0)                                                                              \
 
-#define DEF_KEY(NAME, STD_NAME, MANGLE)                         \
-    if(n_read == 0 || n_read == sizeof(NAME) - 1)               \
-    {                                                           \
-        if(strncmp(data + pos, (NAME), sizeof(NAME) - 1) == 0)  \
-        {                                                       \
-            tmp.type = TYPE_KEYWORD;                            \
-            tmp.val.key = TOK_##MANGLE;                         \
-            pos += (ptrdiff_t) sizeof(NAME) - 1;                            \
-            PASS$(!token_array_add(tok_arr, &tmp), return LEXER_BAD_ALLOC; ); \
-            continue;                                           \
-        }                                                       \
-    }                                                           \
-
-#define DEF_OP(NAME, STD_NAME, MANGLE)                          \
-    if(n_read == 0 || n_read == sizeof(NAME) - 1)               \
-    {                                                           \
-        if(strncmp(data + pos, (NAME), sizeof(NAME) - 1) == 0)  \
-        {                                                       \
-            tmp.type = TYPE_OP;                                 \
-            tmp.val.op = TOK_##MANGLE;                          \
-            pos += (ptrdiff_t) sizeof(NAME) - 1;                            \
-            PASS$(!token_array_add(tok_arr, &tmp), return LEXER_BAD_ALLOC; ); \
-            continue;                                           \
-        }                                                       \
-    }                                                           \
-
-#define DEF_EMB(NAME, STD_NAME, MANGLE)                         \
-    if(n_read == 0 || n_read == sizeof(NAME) - 1)               \
-    {                                                           \
-        if(strncmp(data + pos, (NAME), sizeof(NAME) - 1) == 0)  \
-        {                                                       \
-            tmp.type = TYPE_EMBED;                              \
-            tmp.val.emb = TOK_##MANGLE;                         \
-            pos += (ptrdiff_t) sizeof(NAME) - 1;                            \
-            PASS$(!token_array_add(tok_arr, &tmp), return LEXER_BAD_ALLOC; ); \
-            continue;                                           \
-        }                                                       \
-    }                                                           \
-
-lexer_err lexer(Token_array* tok_arr, Token_nametable* tok_table, const char data[], ptrdiff_t data_sz)
-{
-    assert(tok_arr && tok_table && data);
-    ASSERT_RET$(data_sz > 0, LEXER_EMPTY_DATA);
-    
-    ptrdiff_t pos = 0;
-    bool is_in_directive = false;
-    Token tmp = {};
+// Reserved names in order of definition, the first one wins if names repeat
+struct Reserved_
+{
+    const char* name;
+    ptrdiff_t   len;
+    Token       tok;
+};
+
+#define DEF_OP(NAME, STD_NAME, MANGLE)  {(NAME), sizeof(NAME) - 1, {TYPE_OP,      {.op  = TOK_##MANGLE}}},
+#define DEF_KEY(NAME, STD_NAME, MANGLE) {(NAME), sizeof(NAME) - 1, {TYPE_KEYWORD, {.key = TOK_##MANGLE}}},
+#define DEF_EMB(NAME, STD_NAME, MANGLE) {(NAME), sizeof(NAME) - 1, {TYPE_EMBED,   {.emb = TOK_##MANGLE}}},
+
+static constexpr Reserved_ RESERVED_[] =
+{
+    #include "../reserved_operators.inc"
+    #include "../reserved_keywords.inc"
+    #include "../reserved_embedded.inc"
+};
+
+#undef DEF_OP
+#undef DEF_KEY
+#undef DEF_EMB
+
+static constexpr ptrdiff_t RESERVED_SZ_ = sizeof(RESERVED_) / sizeof(RESERVED_[0]);
+
+static constexpr ptrdiff_t reserved_bytes_()
+{
+    ptrdiff_t bytes = 0;
+    for(ptrdiff_t iter = 0; iter < RESERVED_SZ_; iter++)
+        bytes += RESERVED_[iter].len;
+
+    return bytes;
+}
+
+// Byte trie of reserved names, node 0 is root. Children of node are linked through 'sibling',
+// 'entry' is index of name in RESERVED_ plus one (0 if no name ends at node)
+struct Trie_node_
+{
+    unsigned char byte;
+    int16_t       child;
+    int16_t       sibling;
+    int16_t       entry;
+};
+
+struct Trie_
+{
+    Trie_node_ nodes[reserved_bytes_() + 1];
+    int16_t    size;
+};
+
+static_assert(reserved_bytes_() < INT16_MAX, "Too many reserved names for trie");
+
+static constexpr Trie_ trie_build_()
+{
+    Trie_ trie = {};
+    trie.size  = 1;
+
+    for(ptrdiff_t iter = 0; iter < RESERVED_SZ_; iter++)
+    {
+        int16_t node = 0;
+
+        for(ptrdiff_t pos = 0; pos < RESERVED_[iter].len; pos++)
+        {
+            unsigned char byte = (unsigned char) RESERVED_[iter].name[pos];
+
+            int16_t next = trie.nodes[node].child;
+            while(next && trie.nodes[next].byte != byte)
+                next = trie.nodes[next].sibling;
+
+            if(!next)
+            {
+                next = trie.size;
+                trie.size++;
+
+                trie.nodes[next] = {byte, 0, trie.nodes[node].child, 0};
+                trie.nodes[node].child = next;
+            }
+
+            node = next;
+        }
+
+        if(!trie.nodes[node].entry)
+            trie.nodes[node].entry = (int16_t) (iter + 1);
+    }
+
+    return trie;
+}
+
+static constexpr Trie_ TRIE_ = trie_build_();
+
+// Word of 'n_read' bytes must match the whole name. Punctuation has n_read == 0,
+// then the longest name that data starts with is taken.
+static const Reserved_* reserved_find_(const char data[], ptrdiff_t data_sz, int n_read)
+{
+    assert(data);
+
+    const Reserved_* found = nullptr;
+    int16_t node = 0;
+
+    for(ptrdiff_t pos = 0; pos < data_sz && (n_read == 0 || pos < n_read); pos++)
+    {
+        node = TRIE_.nodes[node].child;
+        while(node && TRIE_.nodes[node].byte != (unsigned char) data[pos])
+            node = TRIE_.nodes[node].sibling;
+
+        if(!node)
+            break;
+
+        if(TRIE_.nodes[node].entry && (n_read == 0 || pos + 1 == n_read))
+            found = &RESERVED_[TRIE_.nodes[node].entry - 1];
+    }
+
+    return found;
+}
+
+#define EMIT_(TOK_)                                         \
+do                                                          \
+{                                                           \
+    *tok = (TOK_);                                          \
+    *offset = tok_start;                                    \
+    stream->data_pos = pos;                                 \
+    return LEXER_NOERR;                                     \
+} while(0)                                                  \
+
+// Lexes one token, comments are skipped. 'offset' gets position of token in data
+static lexer_err lexer_next_(Token_stream* stream, Token* tok, ptrdiff_t* offset)
+{
+    assert(stream && tok && offset);
+
+    const char* data    = stream->data;
+    ptrdiff_t   data_sz = stream->data_sz;
+    ptrdiff_t   pos     = stream->data_pos;
+    ptrdiff_t   tok_start = 0;
+    Token       tmp     = {};
 
     while(true)
     {
-        clean_whitespaces_(data, &pos);   
-        if(pos == data_sz)
+        clean_whitespaces_(data, data_sz, &pos);   
+        if(pos >= data_sz)
             break;
         
+        tok_start = pos;
         int n_read = 0;
         tmp = {};
 
-        if(get_number(data + pos, &tmp.val.num, &n_read))
+        ptrdiff_t num_len = token_number(data + pos, data_sz - pos, &tmp.val.num);
+        if(num_len)
         {
             tmp.type = TYPE_NUMBER;
-            pos += n_read;
-            PASS$(!token_array_add(tok_arr, &tmp), return LEXER_BAD_ALLOC; );
+            pos += num_len;
 
-            continue;
+            EMIT_(tmp);
         }
-        wordlen_(data + pos, &n_read);
+        wordlen_(data + pos, data_sz - pos, &n_read);
 
         if(data[pos] == COMMENT_BEGIN)
         {
             ptrdiff_t comment_start = pos;
 
-            while(data[pos] != COMMENT_END && data[pos] != '\0')
+            while(pos < data_sz && data[pos] != COMMENT_END)
                 pos++;
             
-            if(data[pos] == '\0')
+            if(pos == data_sz)
                 lexer_err("Unterminated comment", data + comment_start);
             
             pos++;
@@ -139,74 +382,387 @@ lexer_err lexer(Token_array* tok_arr, Token_nametable* tok_table, const char dat
         if(data[pos] == COMMENT_END)
             lexer_err("Comment termination without comment start", data + pos);
 
-        if(data[pos] == DIRECTIVE_BEGIN && !is_in_directive)
+        if(data[pos] == DIRECTIVE_BEGIN && !stream->is_in_directive)
         {
-            is_in_directive = true;
+            stream->is_in_directive = true;
             tmp.type = TYPE_DIRECTIVE_BEGIN;
             pos++;
-            PASS$(!token_array_add(tok_arr, &tmp), return LEXER_BAD_ALLOC; );
 
-            continue;
+            EMIT_(tmp);
         }
 
-        if(data[pos] == DIRECTIVE_END && is_in_directive)
+        if(data[pos] == DIRECTIVE_END && stream->is_in_directive)
         {
-            is_in_directive = false;
+            stream->is_in_directive = false;
             tmp.type = TYPE_DIRECTIVE_END;
             pos++;
-            PASS$(!token_array_add(tok_arr, &tmp), return LEXER_BAD_ALLOC; );
 
-            continue;
+            EMIT_(tmp);
         }
 
-        #include "../reserved_operators.inc"
-        #include "../reserved_keywords.inc"
-        #include "../reserved_embedded.inc"
+        const Reserved_* reserved = reserved_find_(data + pos, data_sz - pos, n_read);
+        if(reserved)
+        {
+            pos += reserved->len;
+
+            EMIT_(reserved->tok);
+        }
 
         if(!n_read)
             lexer_err("Unknown symbol", data + pos);
 
         if(strncmp(MAIN_NAME, data + pos, (size_t) n_read) == 0)
-            PASS$(!token_nametable_add(tok_table, &tmp.val.name, MAIN_STD_NAME, sizeof(MAIN_STD_NAME) - 1), return LEXER_BAD_ALLOC; );
+            PASS$(!token_nametable_add(stream->tok_table, &tmp.val.name, MAIN_STD_NAME, sizeof(MAIN_STD_NAME) - 1), return LEXER_BAD_ALLOC; );
         else
-            PASS$(!token_nametable_add(tok_table, &tmp.val.name, data + pos, n_read), return LEXER_BAD_ALLOC; );
+            PASS$(!token_nametable_add(stream->tok_table, &tmp.val.name, data + pos, n_read), return LEXER_BAD_ALLOC; );
 
         tmp.type = TYPE_ID;
-
-        PASS$(!token_array_add(tok_arr, &tmp), return LEXER_BAD_ALLOC; );
         pos += n_read;
+
+        EMIT_(tmp);
+    }
+
+    tmp.type  = TYPE_EOF;
+    tok_start = data_sz;
+
+    EMIT_(tmp);
+}
+
+#undef EMIT_
+
+lexer_err token_stream_ctor(Token_stream* stream, Token_nametable* tok_table, const char data[], ptrdiff_t data_sz)
+{
+    assert(stream && tok_table && data);
+
+    *stream = {};
+    ASSERT_RET$(data_sz > 0, LEXER_EMPTY_DATA);
+
+    stream->tok_table = tok_table;
+    stream->data      = data;
+    stream->data_sz   = data_sz;
+
+    return LEXER_NOERR;
+}
+
+// Lexes tokens until token 'index' is in window. After EOF or error stream yields EOF only
+static void stream_fill_(Token_stream* stream, ptrdiff_t index)
+{
+    assert(stream);
+
+    while(stream->lexed <= index)
+    {
+        Token*     slot   = &stream->window [stream->lexed % TOKEN_WINDOW_SZ];
+        ptrdiff_t* offset = &stream->offsets[stream->lexed % TOKEN_WINDOW_SZ];
+        *slot = {};
+        slot->type = TYPE_EOF;
+        *offset = stream->data_sz;
+
+        if(stream->is_prelexed)
+        {
+            ptrdiff_t eof = stream->tokens.eof;
+            ptrdiff_t cur = (stream->lexed < eof) ? stream->lexed : eof;
+
+            if(cur < eof)
+                *slot = token_array_get(&stream->tokens, cur);
+
+            *offset = stream->tokens.offsets[cur];
+        }
+        else if(!stream->is_eof)
+        {
+            lexer_err err = lexer_next_(stream, slot, offset);
+            if(err)
+            {
+                stream->err = err;
+                *slot = {};
+                slot->type = TYPE_EOF;
+            }
+
+            stream->is_eof = slot->type == TYPE_EOF;
+        }
+
+        stream->lexed++;
+    }
+}
+
+void token_stream_dtor(Token_stream* stream)
+{
+    assert(stream);
+
+    if(!stream->is_slice)
+        token_array_dstr(&stream->tokens);
+
+    *stream = {};
+}
+
+void token_stream_slice(Token_stream* slice, const Token_stream* stream, ptrdiff_t begin, ptrdiff_t end)
+{
+    assert(slice && stream);
+    assert(stream->is_prelexed && begin >= 0 && begin <= end && end <= stream->tokens.eof);
+
+    *slice = {};
+
+    slice->data        = stream->data;
+    slice->data_sz     = stream->data_sz;
+    slice->tok_table   = stream->tok_table;
+    slice->is_eof      = true;
+    slice->is_prelexed = true;
+    slice->is_slice    = true;
+
+    // Token after slice is kept, so EOF of slice has its offset
+    slice->tokens.kinds   = stream->tokens.kinds   + begin;
+    slice->tokens.vals    = stream->tokens.vals    + begin;
+    slice->tokens.offsets = stream->tokens.offsets + begin;
+    slice->tokens.size    = end - begin + 1;
+    slice->tokens.cap     = slice->tokens.size;
+    slice->tokens.eof     = end - begin;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static const ptrdiff_t LEXER_PARALLEL_MIN_SZ = 1 << 20;    // smaller sources are lexed on demand
+static const ptrdiff_t LEXER_CHUNK_MIN_SZ    = 1 << 18;
+static const ptrdiff_t LEXER_MAX_THREADS     = 16;
+
+struct Lexer_chunk_
+{
+    ptrdiff_t       base;       // offset of chunk in source
+    const char*     data;
+    ptrdiff_t       data_sz;
+
+    Token_nametable tok_table;
+    Token_array     tokens;
+    lexer_err       err;
+};
+
+// Positions after '////' which closes top-level definition, outside of comments and directives.
+// Lexer state is the same there as at the beginning of source, so chunks are lexed independently.
+// Returns number of chunks, 'bounds' gets n_chunks + 1 positions.
+static ptrdiff_t split_source_(const char data[], ptrdiff_t data_sz, ptrdiff_t n_chunks, ptrdiff_t bounds[])
+{
+    assert(data && bounds);
+
+    const char LFPAR[] = R"(\\\\)";
+    const char RFPAR[] = R"(////)";
+    const ptrdiff_t PAR_SZ = sizeof(LFPAR) - 1;
+
+    ptrdiff_t n_found  = 1;
+    ptrdiff_t depth    = 0;
+    bool is_comment    = false;
+    bool is_directive  = false;
+
+    bounds[0] = 0;
+
+    for(ptrdiff_t pos = 0; pos < data_sz && n_found < n_chunks; pos++)
+    {
+        char sym = data[pos];
+
+        if(is_comment)
+        {
+            is_comment = sym != COMMENT_END;
+            continue;
+        }
+
+        if(sym == COMMENT_BEGIN)
+        {
+            is_comment = true;
+            continue;
+        }
+
+        if(sym == DIRECTIVE_BEGIN || sym == DIRECTIVE_END)
+        {
+            is_directive = !is_directive;
+            continue;
+        }
+
+        if(is_directive || data_sz - pos < PAR_SZ)
+            continue;
+
+        if(memcmp(data + pos, LFPAR, PAR_SZ) == 0)
+        {
+            depth++;
+            pos += PAR_SZ - 1;
+        }
+        else if(memcmp(data + pos, RFPAR, PAR_SZ) == 0)
+        {
+            depth--;
+            pos += PAR_SZ - 1;
+
+            if(depth == 0 && pos + 1 >= data_sz * n_found / n_chunks)
+            {
+                bounds[n_found] = pos + 1;
+                n_found++;
+            }
+        }
     }
 
-    tok_arr->eof = tok_arr->size;
-    tmp.type = TYPE_EOF;
-    PASS$(!token_array_add(tok_arr, &tmp), return LEXER_BAD_ALLOC; );
+    bounds[n_found] = data_sz;
+
+    return n_found;
+}
+
+static void* lex_chunk_(void* arg)
+{
+    Lexer_chunk_* chunk = (Lexer_chunk_*) arg;
+    assert(chunk);
+
+    // Chunk is lexed on several threads, its error is reported by sequential lexing
+    Token_stream stream = {};
+    stream.data      = chunk->data;
+    stream.data_sz   = chunk->data_sz;
+    stream.tok_table = &chunk->tok_table;
+    stream.is_quiet  = true;
+
+    Token     tok    = {};
+    ptrdiff_t offset = 0;
+    do
+    {
+        chunk->err = lexer_next_(&stream, &tok, &offset);
+        if(chunk->err)
+            break;
+
+        if(token_array_add(&chunk->tokens, &tok, chunk->base + offset))
+        {
+            chunk->err = LEXER_BAD_ALLOC;
+            break;
+        }
+    } while(tok.type != TYPE_EOF);
+
+    return nullptr;
+}
+
+// Names of chunk are interned in stream table in order of tokens, so table is the same as after sequential lexing
+static lexer_err merge_chunk_(Token_stream* stream, Lexer_chunk_* chunk)
+{
+    assert(stream && chunk);
+
+    // EOF of chunk is dropped
+    for(ptrdiff_t iter = 0; iter < chunk->tokens.size - 1; iter++)
+    {
+        Token tok = token_array_get(&chunk->tokens, iter);
+
+        if(tok.type == TYPE_ID)
+            PASS$(!token_nametable_add(stream->tok_table, &tok.val.name, tok.val.name, (ptrdiff_t) strlen(tok.val.name)),
+                  return LEXER_BAD_ALLOC; );
+
+        PASS$(!token_array_add(&stream->tokens, &tok, chunk->tokens.offsets[iter]), return LEXER_BAD_ALLOC; );
+    }
 
     return LEXER_NOERR;
 }
 
-#undef DEF_OP
-#undef DEF_KEY
-#undef DEF_EMB
+lexer_err token_stream_prelex(Token_stream* stream)
+{
+    assert(stream);
+    assert(stream->lexed == 0);
+
+    ptrdiff_t n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if(n_threads > LEXER_MAX_THREADS)
+        n_threads = LEXER_MAX_THREADS;
+
+    if(stream->data_sz / LEXER_CHUNK_MIN_SZ < n_threads)
+        n_threads = stream->data_sz / LEXER_CHUNK_MIN_SZ;
+
+    if(stream->data_sz < LEXER_PARALLEL_MIN_SZ || n_threads < 2)
+        return LEXER_NOERR;
+
+    ptrdiff_t bounds[LEXER_MAX_THREADS + 1] = {};
+    ptrdiff_t n_chunks = split_source_(stream->data, stream->data_sz, n_threads, bounds);
+    if(n_chunks < 2)
+        return LEXER_NOERR;
+
+    Lexer_chunk_ chunks[LEXER_MAX_THREADS] = {};
+    pthread_t    threads[LEXER_MAX_THREADS] = {};
+    bool         is_started[LEXER_MAX_THREADS] = {};
+
+    for(ptrdiff_t iter = 0; iter < n_chunks; iter++)
+    {
+        chunks[iter].base    = bounds[iter];
+        chunks[iter].data    = stream->data + bounds[iter];
+        chunks[iter].data_sz = bounds[iter + 1] - bounds[iter];
+
+        is_started[iter] = pthread_create(&threads[iter], nullptr, lex_chunk_, &chunks[iter]) == 0;
+        if(!is_started[iter])
+            lex_chunk_(&chunks[iter]);
+    }
+
+    lexer_err err = LEXER_NOERR;
+
+    for(ptrdiff_t iter = 0; iter < n_chunks; iter++)
+    {
+        if(is_started[iter])
+            pthread_join(threads[iter], nullptr);
+
+        if(!err)
+            err = chunks[iter].err;
+
+        if(!err)
+            err = merge_chunk_(stream, &chunks[iter]);
+    }
+
+    for(ptrdiff_t iter = 0; iter < n_chunks; iter++)
+    {
+        token_array_dstr(&chunks[iter].tokens);
+        token_nametable_dstr(&chunks[iter].tok_table);
+    }
+
+    // Erroneous source is lexed on demand again, so error is reported at the same token as sequentially
+    if(err)
+    {
+        token_array_dstr(&stream->tokens);
+        stream->tokens = {};
+
+        return (err == LEXER_BAD_ALLOC) ? err : LEXER_NOERR;
+    }
+
+    Token eof = {};
+    eof.type  = TYPE_EOF;
+    PASS$(!token_array_add(&stream->tokens, &eof, stream->data_sz), return LEXER_BAD_ALLOC; );
 
-void consume(Token* tok, Token_array* tok_arr)
+    stream->tokens.eof = stream->tokens.size - 1;
+    stream->is_prelexed = true;
+
+    return LEXER_NOERR;
+}
+
+void consume(Token* tok, Token_stream* stream)
 {
-    assert(tok && tok_arr);
-    assert(tok_arr->pos <= tok_arr->eof);
+    assert(tok && stream);
 
-    *tok = tok_arr->data[tok_arr->pos];
-    tok_arr->pos++;
+    stream_fill_(stream, stream->pos);
+
+    *tok = stream->window[stream->pos % TOKEN_WINDOW_SZ];
+    stream->last = stream->pos;
+    stream->pos++;
 }
 
-void peek(Token* tok, ptrdiff_t offset, Token_array* tok_arr)
+void peek(Token* tok, ptrdiff_t offset, Token_stream* stream)
 {
-    assert(tok && tok_arr);
+    assert(tok && stream);
+    assert(offset > -TOKEN_WINDOW_SZ / 2 && offset < TOKEN_WINDOW_SZ / 2);
+
+    ptrdiff_t index = stream->pos + offset;
 
-    if(tok_arr->pos + offset < 0 || tok_arr->pos + offset > tok_arr->eof)
+    if(index < 0)
     {
-        *tok = tok_arr->data[tok_arr->eof];
-        
+        *tok = {};
+        tok->type = TYPE_EOF;
+
         return;
     }
 
-    *tok = tok_arr->data[tok_arr->pos + offset];
+    stream_fill_(stream, index);
+
+    *tok = stream->window[index % TOKEN_WINDOW_SZ];
+    stream->last = index;
+}
+
+void token_stream_location(const Token_stream* stream, ptrdiff_t* line, ptrdiff_t* column)
+{
+    assert(stream && line && column);
+
+    ptrdiff_t offset = stream->offsets[stream->last % TOKEN_WINDOW_SZ];
+    if(offset > stream->data_sz)
+        offset = stream->data_sz;
+
+    token_location(stream->data, offset, line, column);
 }
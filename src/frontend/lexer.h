@@ -14,9 +14,48 @@ enum lexer_err
     LEXER_BAD_ALLOC      = 3,
 };
 
-lexer_err lexer(Token_array* tok_arr, Token_nametable* tok_table, const char data[], ptrdiff_t data_sz);
+// Window holds tokens around position for peek(-2..+2), power of 2
+static const ptrdiff_t TOKEN_WINDOW_SZ = 8;
 
-void consume(Token* tok, Token_array* tok_arr);
-void peek(Token* tok, ptrdiff_t offset, Token_array* tok_arr);
+// Tokens are lexed on demand from 'data', which must live while stream is used
+struct Token_stream
+{
+    Token     window [TOKEN_WINDOW_SZ];
+    ptrdiff_t offsets[TOKEN_WINDOW_SZ];        // positions of window tokens in data
+
+    ptrdiff_t pos   = 0;    // index of next token to consume
+    ptrdiff_t lexed = 0;    // number of tokens lexed
+    ptrdiff_t last  = 0;    // index of token returned last by consume() or peek()
+
+    const char*      data      = nullptr;
+    ptrdiff_t        data_sz   = 0;
+    ptrdiff_t        data_pos  = 0;
+    Token_nametable* tok_table = nullptr;
+
+    bool      is_in_directive = false;
+    bool      is_eof          = false;
+    bool      is_quiet        = false;         // errors aren't printed, as source is lexed once more on demand
+    lexer_err err             = LEXER_NOERR;   // first lexer error, stream yields EOF after it
+
+    bool        is_prelexed = false;            // tokens are taken from 'tokens' instead of lexing
+    bool        is_slice    = false;            // 'tokens' are borrowed from other stream
+    Token_array tokens      = {};
+};
+
+lexer_err token_stream_ctor(Token_stream* stream, Token_nametable* tok_table, const char data[], ptrdiff_t data_sz);
+
+void      token_stream_dtor(Token_stream* stream);
+
+// Lexes large source on several threads in advance, small sources stay lexed on demand
+lexer_err token_stream_prelex(Token_stream* stream);
+
+// Stream of prelexed tokens [begin, end) of 'stream' followed by EOF, 'stream' must outlive it
+void      token_stream_slice(Token_stream* slice, const Token_stream* stream, ptrdiff_t begin, ptrdiff_t end);
+
+void consume(Token* tok, Token_stream* stream);
+void peek(Token* tok, ptrdiff_t offset, Token_stream* stream);
+
+// Location of token returned last, for diagnostics
+void token_stream_location(const Token_stream* stream, ptrdiff_t* line, ptrdiff_t* column);
 
 #endif // LEXER_H
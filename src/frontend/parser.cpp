@@ -1,20 +1,29 @@
 #include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include "parser.h"
 #include "lexer.h"
 #include "../common/dumpsystem.h"
 
-static Tree*         TREE_         = nullptr;
-static Token_array*  TOKEN_ARRAY_  = nullptr;
-static Dependencies* DEPENDENCIES_ = nullptr;
+// State of single parse, passed through descent so that sources can be parsed concurrently
+struct Parser_context
+{
+    Tree*         tree   = nullptr;
+    Token_stream* stream = nullptr;
+    Dependencies* deps   = nullptr;
+
+    bool is_quiet = false;  // errors aren't printed, as source is parsed once more sequentially
+    int  depth    = 0;      // nesting of primary expressions
+};
 
-static void syntax_error_tokens()
+static void syntax_error_tokens(Token_stream* stream)
 {
         Token error_token = {};
 
         for(int iter = -2; iter < 3; iter++)
         {
-            peek(&error_token, iter, TOKEN_ARRAY_); 
+            peek(&error_token, iter, stream); 
             fprintf(stderr, "%s ", demangle(&error_token));
         }
 
@@ -24,17 +33,26 @@ static void syntax_error_tokens()
 #define syntax_error(MSG_, TOK_)                                                        \
 do                                                                                      \
 {                                                                                       \
-    fprintf(stderr, "\x1b[31mSyntax error:\x1b[0m %s : %s\n", (MSG_), demangle(TOK_));  \
+    /* Lexer error is reported by lexer, tokens after it are made-up EOF */            \
+    if(ctx->is_quiet || ctx->stream->err)                                               \
+        return PARSER_SYNTAX_ERR;                                                       \
+                                                                                        \
+    ptrdiff_t line_   = 0;                                                              \
+    ptrdiff_t column_ = 0;                                                              \
+    token_stream_location(ctx->stream, &line_, &column_);                               \
+                                                                                        \
+    fprintf(stderr, "\x1b[31mSyntax error:\x1b[0m %ld:%ld: %s : %s\n",                   \
+                    line_, column_, (MSG_), demangle(TOK_));                            \
     FILE* stream_ = dumpsystem_get_opened_stream();                                     \
                                                                                         \
     if(stream_)                                                                         \
     {                                                                                   \
-        fprintf(stream_, "<span class = \"error\">Syntax error: %s : %s\n</span>"       \
+        fprintf(stream_, "<span class = \"error\">Syntax error: %ld:%ld: %s : %s\n</span>" \
                          "\t\t\t\tat %s:%d:%s\n",                                       \
-                         (MSG_), demangle(TOK_),                                        \
+                         line_, column_, (MSG_), demangle(TOK_),                        \
                          __FILE__, __LINE__, __PRETTY_FUNCTION__);                      \
                                                                                         \
-        syntax_error_tokens();                                                          \
+        syntax_error_tokens(ctx->stream);                                               \
         return PARSER_SYNTAX_ERR;                                                       \
     }                                                                                   \
 } while(0)                                                                              \
@@ -111,62 +129,96 @@ do
         General    ::= {Define | Assign | Directive}+
 */
  
-static parser_err primary(Node** base);
-static parser_err term(Node** base);
-static parser_err expression(Node** base);
-static parser_err conditional(Node** base);
-static parser_err cycle(Node** base);
-static parser_err terminational(Node** base);
-static parser_err assign(Node** base);
-static parser_err statement(Node** base);
-static parser_err general(Node** base);
-
-#define CONSUME(TOK)      consume((TOK), TOKEN_ARRAY_)
-#define PEEK(TOK, OFFSET) peek((TOK), (OFFSET), TOKEN_ARRAY_)
-
-#define MK_NODE(BASE, TOK) ASSERT_RET$(!tree_add(TREE_, (BASE), (TOK)), PARSER_TREE_FAIL)
-
-#define MK_AUX(BASE, AUX) ASSERT_RET$(!tree_add_wrap((BASE), TYPE_AUX,     (AUX)), PARSER_TREE_FAIL)
-#define MK_KEY(BASE, KEY) ASSERT_RET$(!tree_add_wrap((BASE), TYPE_KEYWORD, (KEY)), PARSER_TREE_FAIL)
-static inline tree_err tree_add_wrap(Node** base, token_type type, int val)
+// Descent functions write index of parsed subtree to 'base'. It never points into pool of nodes,
+// as pool may move while nodes are added, so descendants are linked after they are parsed
+static parser_err primary(Parser_context* ctx, ptrdiff_t* base);
+static parser_err power(Parser_context* ctx, ptrdiff_t* base);
+static parser_err expression(Parser_context* ctx, ptrdiff_t* base);
+static parser_err conditional(Parser_context* ctx, ptrdiff_t* base);
+static parser_err cycle(Parser_context* ctx, ptrdiff_t* base);
+static parser_err terminational(Parser_context* ctx, ptrdiff_t* base);
+static parser_err assign(Parser_context* ctx, ptrdiff_t* base);
+static parser_err statement(Parser_context* ctx, ptrdiff_t* base);
+static parser_err general(Parser_context* ctx, ptrdiff_t* base);
+
+#define CONSUME(TOK)      consume((TOK), ctx->stream)
+#define PEEK(TOK, OFFSET) peek((TOK), (OFFSET), ctx->stream)
+
+#define MK_NODE(BASE, TOK) ASSERT_RET$(!tree_add(ctx->tree, (BASE), (TOK)), PARSER_TREE_FAIL)
+
+#define MK_AUX(BASE, AUX) ASSERT_RET$(!tree_add_wrap(ctx->tree, (BASE), TYPE_AUX,     (AUX)), PARSER_TREE_FAIL)
+#define MK_KEY(BASE, KEY) ASSERT_RET$(!tree_add_wrap(ctx->tree, (BASE), TYPE_KEYWORD, (KEY)), PARSER_TREE_FAIL)
+
+#define LINK_LEFT(NODE, LEFT)   node_set_left (tree_node(ctx->tree, (NODE)), tree_node(ctx->tree, (LEFT)))
+#define LINK_RIGHT(NODE, RIGHT) node_set_right(tree_node(ctx->tree, (NODE)), tree_node(ctx->tree, (RIGHT)))
+
+static inline tree_err tree_add_wrap(Tree* tree, ptrdiff_t* base, token_type type, int val)
 {
     Token tok    = {};
     tok.type     = type;
     tok.val.aux  = (token_auxiliary) val;
 
-    return tree_add(TREE_, base, &tok);
+    return tree_add(tree, base, &tok);
+}
+
+// Parentheses, unary operators, arguments and indices nest through primary(), each level takes native stack
+static const int MAX_DEPTH_ = 1000;
+
+static parser_err primary_(Parser_context* ctx, ptrdiff_t* base);
+
+static parser_err primary(Parser_context* ctx, ptrdiff_t* base)
+{
+    if(ctx->depth >= MAX_DEPTH_)
+    {
+        Token tok = {};
+        PEEK(&tok, 0);
+
+        syntax_error("Expression is nested too deeply", &tok);
+        return PARSER_SYNTAX_ERR;
+    }
+
+    ctx->depth++;
+    parser_err err = primary_(ctx, base);
+    ctx->depth--;
+
+    return err;
 }
 
-static parser_err primary(Node** base)
+static parser_err primary_(Parser_context* ctx, ptrdiff_t* base)
 {
     LOG$("Entering");
 
     Token tok = {};
+    ptrdiff_t operand = 0;
 
     CONSUME(&tok);
 
     if(tok.type == TYPE_OP && tok.val.op == TOK_NOT)
     {
         MK_NODE(base, &tok);
-        PASS$(!primary(&(*base)->right), return PARSER_PASS_ERR; );
+        PASS$(!primary(ctx, &operand), return PARSER_PASS_ERR; );
+        LINK_RIGHT(*base, operand);
     }
     else if(tok.type == TYPE_OP && tok.val.op == TOK_ADD)
     {
-        PASS$(!primary(base), return PARSER_PASS_ERR; );        
+        PASS$(!primary(ctx, base), return PARSER_PASS_ERR; );        
     }
     else if(tok.type == TYPE_OP && tok.val.op == TOK_SUB)
     {
         MK_NODE(base, &tok);
 
+        ptrdiff_t zero = 0;
         tok.type = TYPE_NUMBER;
         tok.val.num = 0;
-        MK_NODE(&(*base)->left, &tok);
+        MK_NODE(&zero, &tok);
+        LINK_LEFT(*base, zero);
 
-        PASS$(!primary(&(*base)->right), return PARSER_PASS_ERR; );
+        PASS$(!primary(ctx, &operand), return PARSER_PASS_ERR; );
+        LINK_RIGHT(*base, operand);
     }
     else if(tok.type == TYPE_OP && tok.val.op == TOK_LRPAR)
     {
-        PASS$(!expression(base), return PARSER_PASS_ERR; );
+        PASS$(!expression(ctx, base), return PARSER_PASS_ERR; );
 
         CONSUME(&tok);
         if(tok.type != TYPE_OP || tok.val.op != TOK_RRPAR)
@@ -186,27 +238,33 @@ static parser_err primary(Node** base)
         {
             MK_AUX(base, TOK_CALL);
 
-            MK_NODE(&(*base)->left, &tok);
+            ptrdiff_t name = 0;
+            MK_NODE(&name, &tok);
+            LINK_LEFT(*base, name);
             
-            base = &(*base)->right;
+            ptrdiff_t args = 0;
 
             CONSUME(&tok);
 
             PEEK(&tok, 0);
             if(tok.type != TYPE_OP || tok.val.op != TOK_RRPAR)
             {
-                MK_AUX(base, TOK_PARAMETER);
-                PASS$(!expression(&(*base)->right), return PARSER_PASS_ERR; );
+                MK_AUX(&args, TOK_PARAMETER);
+                LINK_RIGHT(*base, args);
+                PASS$(!expression(ctx, &operand), return PARSER_PASS_ERR; );
+                LINK_RIGHT(args, operand);
 
                 PEEK(&tok, 0);
                 while(tok.type == TYPE_OP && tok.val.op == TOK_COMMA)
                 {
                     CONSUME(&tok);
 
-                    Node* tmp = *base;
-                    MK_AUX(base, TOK_PARAMETER);
-                    PASS$(!expression(&(*base)->right), return PARSER_PASS_ERR; );
-                    (*base)->left = tmp;
+                    ptrdiff_t tmp = args;
+                    MK_AUX(&args, TOK_PARAMETER);
+                    LINK_RIGHT(*base, args);
+                    PASS$(!expression(ctx, &operand), return PARSER_PASS_ERR; );
+                    LINK_LEFT(args, tmp);
+                    LINK_RIGHT(args, operand);
 
                     PEEK(&tok, 0);
                 }
@@ -221,7 +279,8 @@ static parser_err primary(Node** base)
             MK_NODE(base, &tok);
 
             CONSUME(&tok);
-            PASS$(!primary(&(*base)->right), return PARSER_PASS_ERR; );
+            PASS$(!primary(ctx, &operand), return PARSER_PASS_ERR; );
+            LINK_RIGHT(*base, operand);
         }
         else
         {
@@ -238,14 +297,20 @@ static parser_err primary(Node** base)
         
         PEEK(&tok, 0);
         if(tok.type != TYPE_OP || tok.val.op != TOK_RRPAR)
-            PASS$(!expression(&(*base)->right), return PARSER_PASS_ERR; );
+        {
+            PASS$(!expression(ctx, &operand), return PARSER_PASS_ERR; );
+            LINK_RIGHT(*base, operand);
+        }
                 
         PEEK(&tok, 0);
         if(tok.type == TYPE_OP && tok.val.op == TOK_COMMA)
         {
             CONSUME(&tok);
-            (*base)->left = (*base)->right;
-            PASS$(!expression(&(*base)->right), return PARSER_PASS_ERR; );
+            LINK_LEFT(*base, operand);
+
+            operand = 0;
+            PASS$(!expression(ctx, &operand), return PARSER_PASS_ERR; );
+            LINK_RIGHT(*base, operand);
         }
 
         CONSUME(&tok);
@@ -260,11 +325,11 @@ static parser_err primary(Node** base)
     return PARSER_NOERR;
 }
 
-static parser_err power(Node** base)
+static parser_err power(Parser_context* ctx, ptrdiff_t* base)
 {
     LOG$("Entering");
 
-    PASS$(!primary(base), return PARSER_PASS_ERR; );
+    PASS$(!primary(ctx, base), return PARSER_PASS_ERR; );
 
     Token tok = {};
     PEEK(&tok, 0);
@@ -273,124 +338,108 @@ static parser_err power(Node** base)
     {
         CONSUME(&tok);
 
-        Node* tmp = *base;
+        ptrdiff_t tmp      = *base;
+        ptrdiff_t exponent = 0;
 
         MK_NODE(base, &tok);
 
-        (*base)->left = tmp;
-        PASS$(!primary(&(*base)->right), return PARSER_PASS_ERR; );
+        LINK_LEFT(*base, tmp);
+        PASS$(!primary(ctx, &exponent), return PARSER_PASS_ERR; );
+        LINK_RIGHT(*base, exponent);
     }
 
     return PARSER_NOERR;
 }
 
-static parser_err term(Node** base)
+// Binding power of binary operators, 0 for others. Power is parsed with operand, as it isn't associative
+static constexpr int binary_precedence_(token_operators op)
 {
-    LOG$("Entering");
-
-    PASS$(!power(base), return PARSER_PASS_ERR; );
-
-    Token tok = {};
-    PEEK(&tok, 0);
-
-    while(tok.type == TYPE_OP && (tok.val.op == TOK_MUL || tok.val.op == TOK_DIV))
-    {
-        CONSUME(&tok);
-
-        Node* tmp = *base;
-
-        MK_NODE(base, &tok);
-        
-        (*base)->left = tmp;
-        PASS$(!power(&(*base)->right), return PARSER_PASS_ERR; );
-        
-        PEEK(&tok, 0);
-    }
-    
-    return PARSER_NOERR;
+    return (op == TOK_AND  || op == TOK_OR)                     ? 1 :
+           (op == TOK_EQ   || op == TOK_NEQ  || op == TOK_LESS ||
+            op == TOK_LEQ  || op == TOK_GREAT || op == TOK_GEQ) ? 2 :
+           (op == TOK_ADD  || op == TOK_SUB)                    ? 3 :
+           (op == TOK_MUL  || op == TOK_DIV)                    ? 4 : 0;
 }
 
-static parser_err ariphmetic(Node** base)
+#define DEF_OP(NAME, STD_NAME, MANGLE) binary_precedence_(TOK_##MANGLE),
+static const int PRECEDENCE_[] =
 {
-    LOG$("Entering");
+    #include "../reserved_operators.inc"
+};
+#undef DEF_OP
 
-    PASS$(!term(base), return PARSER_PASS_ERR; );
+static const int MAX_PRECEDENCE_ = 4;
 
-    Token tok = {};
-    PEEK(&tok, 0);
-
-    while(tok.type == TYPE_OP && (tok.val.op == TOK_ADD || tok.val.op == TOK_SUB))
-    {
-        CONSUME(&tok);
-
-        Node* tmp = *base;
-
-        MK_NODE(base, &tok);
-
-        (*base)->left = tmp;
-        PASS$(!term(&(*base)->right), return PARSER_PASS_ERR; );
-
-        PEEK(&tok, 0);
-    }
+static inline int precedence_(const Token* tok)
+{
+    if(tok->type != TYPE_OP)
+        return 0;
 
-    return PARSER_NOERR;
+    return PRECEDENCE_[tok->val.op];
 }
 
-static parser_err boolean(Node** base)
+// Operator-precedence parsing of binary operators, all of them are left-associative.
+// Pending operators have strictly increasing precedence, so stacks are bounded by number of levels
+static parser_err expression(Parser_context* ctx, ptrdiff_t* base)
 {
     LOG$("Entering");
 
-    PASS$(!ariphmetic(base), return PARSER_PASS_ERR; );
+    ptrdiff_t operands [MAX_PRECEDENCE_ + 1] = {};
+    Token operators[MAX_PRECEDENCE_]     = {};
+    int   n_operands  = 0;
+    int   n_operators = 0;
+
+// Pops two operands and operator, pushes node of operator
+#define REDUCE_()                                                   \
+do                                                                  \
+{                                                                   \
+    n_operators--;                                                  \
+    n_operands--;                                                   \
+                                                                    \
+    ptrdiff_t  lhs_ = operands[n_operands - 1];                     \
+    ptrdiff_t  rhs_ = operands[n_operands];                         \
+    ptrdiff_t* dst_ = &operands[n_operands - 1];                    \
+                                                                    \
+    MK_NODE(dst_, &operators[n_operators]);                         \
+    LINK_LEFT (*dst_, lhs_);                                        \
+    LINK_RIGHT(*dst_, rhs_);                                        \
+} while(0)
+
+    PASS$(!power(ctx, &operands[n_operands]), return PARSER_PASS_ERR; );
+    n_operands++;
 
     Token tok = {};
     PEEK(&tok, 0);
 
-    while(tok.type == TYPE_OP && (tok.val.op == TOK_EQ    || tok.val.op == TOK_NEQ ||
-                                  tok.val.op == TOK_LESS  || tok.val.op == TOK_LEQ ||
-                                  tok.val.op == TOK_GREAT || tok.val.op == TOK_GEQ ))
+    int prec = precedence_(&tok);
+    while(prec)
     {
         CONSUME(&tok);
 
-        Node* tmp = *base;
+        while(n_operators && precedence_(&operators[n_operators - 1]) >= prec)
+            REDUCE_();
 
-        MK_NODE(base, &tok);
+        operators[n_operators] = tok;
+        n_operators++;
 
-        (*base)->left = tmp;
-        PASS$(!ariphmetic(&(*base)->right), return PARSER_PASS_ERR; );
+        PASS$(!power(ctx, &operands[n_operands]), return PARSER_PASS_ERR; );
+        n_operands++;
 
         PEEK(&tok, 0);
+        prec = precedence_(&tok);
     }
 
-    return PARSER_NOERR;
-}
-
-static parser_err expression(Node** base)
-{
-    LOG$("Entering");
+    while(n_operators)
+        REDUCE_();
 
-    PASS$(!boolean(base), return PARSER_PASS_ERR; );
+#undef REDUCE_
 
-    Token tok = {};
-    PEEK(&tok, 0);
-
-    while(tok.type == TYPE_OP && (tok.val.op == TOK_AND || tok.val.op == TOK_OR))
-    {
-        CONSUME(&tok);
-
-        Node* tmp = *base;
-
-        MK_NODE(base, &tok);
-
-        (*base)->left = tmp;
-        PASS$(!boolean(&(*base)->right), return PARSER_PASS_ERR; );
-
-        PEEK(&tok, 0);
-    }
+    *base = operands[0];
 
     return PARSER_NOERR;
 }
 
-static parser_err assign(Node** base)
+static parser_err assign(Parser_context* ctx, ptrdiff_t* base)
 {
     LOG$("Entering");
 
@@ -406,14 +455,17 @@ static parser_err assign(Node** base)
     if(tok.type != TYPE_ID)
         syntax_error("Assignment requires lvalue",&tok);
     
-    Node* tmp = *base;
+    ptrdiff_t tmp = *base;
     MK_NODE(base, &tok);
-    (*base)->left = tmp;
+    LINK_LEFT(*base, tmp);
+
+    ptrdiff_t operand = 0;
 
     CONSUME(&tok);
     if(tok.type == TYPE_OP && tok.val.op == TOK_LQPAR)
     {
-        PASS$(!expression(&(*base)->right), return PARSER_PASS_ERR; );
+        PASS$(!expression(ctx, &operand), return PARSER_PASS_ERR; );
+        LINK_RIGHT(*base, operand);
 
         CONSUME(&tok);
         if(tok.type != TYPE_OP && tok.val.op != TOK_RQPAR)
@@ -427,9 +479,11 @@ static parser_err assign(Node** base)
     
     tmp = *base;
     MK_NODE(base, &tok);
-    (*base)->left = tmp;
+    LINK_LEFT(*base, tmp);
 
-    PASS$(!expression(&(*base)->right), return PARSER_PASS_ERR; );
+    operand = 0;
+    PASS$(!expression(ctx, &operand), return PARSER_PASS_ERR; );
+    LINK_RIGHT(*base, operand);
 
     CONSUME(&tok);
     if(tok.type != TYPE_OP || tok.val.op != TOK_SEMICOLON)
@@ -438,7 +492,7 @@ static parser_err assign(Node** base)
     return PARSER_NOERR;
 }
 
-static parser_err conditional(Node** base)
+static parser_err conditional(Parser_context* ctx, ptrdiff_t* base)
 {
     LOG$("Entering");
 
@@ -454,14 +508,20 @@ static parser_err conditional(Node** base)
     if(tok.type != TYPE_OP || tok.val.op != TOK_LRPAR)
         syntax_error("Opening parenthesis expected (condition)",&tok);
 
-    PASS$(!expression(&(*base)->left), return PARSER_PASS_ERR; );
+    ptrdiff_t condition = 0;
+    PASS$(!expression(ctx, &condition), return PARSER_PASS_ERR; );
+    LINK_LEFT(*base, condition);
 
     CONSUME(&tok);
     if(tok.type != TYPE_OP || tok.val.op != TOK_RRPAR)
         syntax_error("Closing parenthesis expected (condition)",&tok);
     
-    MK_AUX(&(*base)->right, TOK_DECISION);
-    base = &(*base)->right;
+    ptrdiff_t decision = 0;
+    MK_AUX(&decision, TOK_DECISION);
+    LINK_RIGHT(*base, decision);
+
+    ptrdiff_t branch = 0;
+    ptrdiff_t stmnt  = 0;
 
     CONSUME(&tok);
     if(tok.type != TYPE_OP || tok.val.op != TOK_LFPAR)
@@ -470,10 +530,14 @@ static parser_err conditional(Node** base)
     PEEK(&tok, 0);
     while(tok.type != TYPE_OP || tok.val.op != TOK_RFPAR)
     {
-        Node* tmp = (*base)->left;
-        MK_AUX(&(*base)->left, TOK_STATEMENT);
-        PASS$(!statement(&(*base)->left->right), return PARSER_PASS_ERR; );
-        (*base)->left->left = tmp;
+        ptrdiff_t tmp = branch;
+        MK_AUX(&branch, TOK_STATEMENT);
+        LINK_LEFT(decision, branch);
+
+        stmnt = 0;
+        PASS$(!statement(ctx, &stmnt), return PARSER_PASS_ERR; );
+        LINK_LEFT(branch, tmp);
+        LINK_RIGHT(branch, stmnt);
 
         PEEK(&tok, 0);
     }
@@ -492,12 +556,17 @@ static parser_err conditional(Node** base)
         syntax_error("Opening parenthesis expected (body of negative)",&tok);
     
     PEEK(&tok, 0);
+    branch = 0;
     while(tok.type != TYPE_OP || tok.val.op != TOK_RFPAR)
     {
-        Node* tmp = (*base)->right;
-        MK_AUX(&(*base)->right, TOK_STATEMENT);
-        PASS$(!statement(&(*base)->right->right), return PARSER_PASS_ERR; );
-        (*base)->right->left = tmp;
+        ptrdiff_t tmp = branch;
+        MK_AUX(&branch, TOK_STATEMENT);
+        LINK_RIGHT(decision, branch);
+
+        stmnt = 0;
+        PASS$(!statement(ctx, &stmnt), return PARSER_PASS_ERR; );
+        LINK_LEFT(branch, tmp);
+        LINK_RIGHT(branch, stmnt);
 
         PEEK(&tok, 0);
     }
@@ -509,7 +578,7 @@ static parser_err conditional(Node** base)
     return PARSER_NOERR;
 }
 
-static parser_err cycle(Node** base)
+static parser_err cycle(Parser_context* ctx, ptrdiff_t* base)
 {
     LOG$("Entering");
 
@@ -525,7 +594,9 @@ static parser_err cycle(Node** base)
     if(tok.type != TYPE_OP || tok.val.op != TOK_LRPAR)
         syntax_error("Opening parenthesis expected (condition of loop)",&tok);
     
-    PASS$(!expression(&(*base)->left), return PARSER_PASS_ERR; );
+    ptrdiff_t condition = 0;
+    PASS$(!expression(ctx, &condition), return PARSER_PASS_ERR; );
+    LINK_LEFT(*base, condition);
 
     CONSUME(&tok);
     if(tok.type != TYPE_OP || tok.val.op != TOK_RRPAR)
@@ -535,15 +606,20 @@ static parser_err cycle(Node** base)
     if(tok.type != TYPE_OP || tok.val.op != TOK_LFPAR)
         syntax_error("Opening parenthesis expected (body of loop)",&tok);
         
-    base = &(*base)->right;
+    ptrdiff_t body  = 0;
+    ptrdiff_t stmnt = 0;
 
     PEEK(&tok, 0);
     while(tok.type != TYPE_OP || tok.val.op != TOK_RFPAR)
     {
-        Node* tmp = (*base);
-        MK_AUX(base, TOK_STATEMENT);
-        PASS$(!statement(&(*base)->right), return PARSER_PASS_ERR; );
-        (*base)->left = tmp;
+        ptrdiff_t tmp = body;
+        MK_AUX(&body, TOK_STATEMENT);
+        LINK_RIGHT(*base, body);
+
+        stmnt = 0;
+        PASS$(!statement(ctx, &stmnt), return PARSER_PASS_ERR; );
+        LINK_LEFT(body, tmp);
+        LINK_RIGHT(body, stmnt);
 
         PEEK(&tok, 0);
     }
@@ -555,7 +631,7 @@ static parser_err cycle(Node** base)
     return PARSER_NOERR;
 }
 
-static parser_err terminational(Node** base)
+static parser_err terminational(Parser_context* ctx, ptrdiff_t* base)
 {
     LOG$("Entering");
 
@@ -568,7 +644,9 @@ static parser_err terminational(Node** base)
     
     MK_NODE(base, &tok);
 
-    PASS$(!expression(&(*base)->right), return PARSER_PASS_ERR; );
+    ptrdiff_t value = 0;
+    PASS$(!expression(ctx, &value), return PARSER_PASS_ERR; );
+    LINK_RIGHT(*base, value);
 
     CONSUME(&tok);
     if(tok.type != TYPE_OP || tok.val.op != TOK_SEMICOLON)
@@ -577,7 +655,7 @@ static parser_err terminational(Node** base)
     return PARSER_NOERR;
 }
 
-static parser_err statement(Node** base)
+static parser_err statement(Parser_context* ctx, ptrdiff_t* base)
 {
     LOG$("Entering");
 
@@ -590,22 +668,22 @@ static parser_err statement(Node** base)
     {
         if(tok.val.key == TOK_IF)
         {
-            PASS$(!conditional(base), return PARSER_PASS_ERR; );
+            PASS$(!conditional(ctx, base), return PARSER_PASS_ERR; );
             return PARSER_NOERR;
         }
         else if(tok.val.key == TOK_WHILE)
         {
-            PASS$(!cycle(base), return PARSER_PASS_ERR; );
+            PASS$(!cycle(ctx, base), return PARSER_PASS_ERR; );
             return PARSER_NOERR;
         }
         else if(tok.val.key == TOK_RETURN)
         {
-            PASS$(!terminational(base), return PARSER_PASS_ERR; );
+            PASS$(!terminational(ctx, base), return PARSER_PASS_ERR; );
             return PARSER_NOERR;
         }
         else if(tok.val.key == TOK_CONST)
         {
-            PASS$(!assign(base), return PARSER_PASS_ERR; );
+            PASS$(!assign(ctx, base), return PARSER_PASS_ERR; );
             return PARSER_NOERR;
         }
     }
@@ -615,12 +693,12 @@ static parser_err statement(Node** base)
         PEEK(&tok, 1);
         if(tok.type == TYPE_OP && (tok.val.op == TOK_ASSIGN || tok.val.op == TOK_LQPAR))
         {
-            PASS$(!assign(base), return PARSER_PASS_ERR; );
+            PASS$(!assign(ctx, base), return PARSER_PASS_ERR; );
             return PARSER_NOERR;
         }
     }
     
-    PASS$(!expression(base), return PARSER_PASS_ERR; );
+    PASS$(!expression(ctx, base), return PARSER_PASS_ERR; );
     CONSUME(&tok);
     if(tok.type != TYPE_OP || tok.val.op != TOK_SEMICOLON)
         syntax_error("Terminational literal expected",&tok);
@@ -628,46 +706,59 @@ static parser_err statement(Node** base)
     return PARSER_NOERR;
 }
 
-static parser_err define(Node** base)
+static parser_err define(Parser_context* ctx, ptrdiff_t* base)
 {
     LOG$("Entering");
 
     assert(base);
 
+    ptrdiff_t func = 0;
+
     MK_AUX(base, TOK_DEFINE);
-    MK_AUX(&(*base)->left, TOK_FUNCTION);
+    MK_AUX(&func, TOK_FUNCTION);
+    LINK_LEFT(*base, func);
 
     Token tok = {};
     CONSUME(&tok);
     if(tok.type != TYPE_ID)
         syntax_error("Function name expected",&tok);
     
-    MK_NODE(&(*base)->left->left, &tok);
+    ptrdiff_t name = 0;
+    MK_NODE(&name, &tok);
+    LINK_LEFT(func, name);
     
     CONSUME(&tok);
     if(tok.type != TYPE_OP || tok.val.op != TOK_LRPAR)
         syntax_error("Opening parenthesis expected (function parameters)",&tok);
     
+    ptrdiff_t params = 0;
+    ptrdiff_t param  = 0;
+
     PEEK(&tok, 0);
     if(tok.type != TYPE_OP || tok.val.op != TOK_RRPAR)
     {
-        MK_AUX(&(*base)->left->right, TOK_PARAMETER);
+        MK_AUX(&params, TOK_PARAMETER);
+        LINK_RIGHT(func, params);
 
-        PASS$(!expression(&(*base)->left->right->right), return PARSER_PASS_ERR; );
+        PASS$(!expression(ctx, &param), return PARSER_PASS_ERR; );
+        LINK_RIGHT(params, param);
     }
 
     PEEK(&tok, 0);
     while(tok.type != TYPE_OP || tok.val.op != TOK_RRPAR)
     {
-        Node* tmp = (*base)->left->right;
-        MK_AUX(&(*base)->left->right, TOK_PARAMETER);
+        ptrdiff_t tmp = params;
+        MK_AUX(&params, TOK_PARAMETER);
+        LINK_RIGHT(func, params);
 
         CONSUME(&tok);
         if(tok.type != TYPE_OP || tok.val.op != TOK_COMMA)
             syntax_error("Expected comma (function parameters)",&tok);
 
-        PASS$(!expression(&(*base)->left->right->right), return PARSER_PASS_ERR; );
-        (*base)->left->right->left = tmp;
+        param = 0;
+        PASS$(!expression(ctx, &param), return PARSER_PASS_ERR; );
+        LINK_LEFT(params, tmp);
+        LINK_RIGHT(params, param);
 
         PEEK(&tok, 0);
     }
@@ -680,14 +771,20 @@ static parser_err define(Node** base)
     if(tok.type != TYPE_OP || tok.val.op != TOK_LFPAR)
         syntax_error("Opening parenthesis expected (function body)",&tok);
 
+    ptrdiff_t body  = 0;
+    ptrdiff_t stmnt = 0;
+
     PEEK(&tok, 0);
     while(tok.type != TYPE_OP || tok.val.op != TOK_RFPAR)
     {
-        Node* tmp = (*base)->right;
-        MK_AUX(&(*base)->right, TOK_STATEMENT);
+        ptrdiff_t tmp = body;
+        MK_AUX(&body, TOK_STATEMENT);
+        LINK_RIGHT(*base, body);
 
-        PASS$(!statement(&(*base)->right->right), return PARSER_PASS_ERR; );
-        (*base)->right->left = tmp;
+        stmnt = 0;
+        PASS$(!statement(ctx, &stmnt), return PARSER_PASS_ERR; );
+        LINK_LEFT(body, tmp);
+        LINK_RIGHT(body, stmnt);
 
         PEEK(&tok, 0);
     }
@@ -699,11 +796,11 @@ static parser_err define(Node** base)
     return PARSER_NOERR;
 }
 
-static parser_err directive()
+static parser_err directive(Parser_context* ctx)
 {
     LOG$("Entering");
 
-    assert(DEPENDENCIES_);
+    assert(ctx->deps);
     
     Dep dep = {};
     Token tok = {};
@@ -748,7 +845,11 @@ static parser_err directive()
     if(tok.type != TYPE_OP || tok.val.op != TOK_RRPAR)
         syntax_error("Closing parenthesis expected (directive)", &tok);
     
-    int err = dep_add(DEPENDENCIES_, dep);
+    // dep_add() reports redeclaration itself
+    if(ctx->is_quiet && dep_find(ctx->deps, dep.func.val.name))
+        return PARSER_SYNTAX_ERR;
+
+    int err = dep_add(ctx->deps, dep);
     if(err == DEP_ALREADY_INSERTED)
         syntax_error("Redeclaration of function (directive)", &tok);
     
@@ -761,32 +862,36 @@ static parser_err directive()
     return PARSER_NOERR;
 }
 
-static parser_err general(Node** base)
+static parser_err general(Parser_context* ctx, ptrdiff_t* base)
 {
     LOG$("Entering");
 
     assert(base);
 
     Token tok = {};
-    Node* tmp = nullptr;
+    ptrdiff_t tmp  = 0;
+    ptrdiff_t body = 0;
 
     PEEK(&tok, 0);
     while(tok.type != TYPE_EOF)
     {
         if(tok.type == TYPE_DIRECTIVE_BEGIN)
         {
-            PASS$(!directive(), return PARSER_PASS_ERR; );
+            PASS$(!directive(ctx), return PARSER_PASS_ERR; );
             PEEK(&tok, 0);
             continue;
         }
 
         tmp = *base;
         MK_AUX(base, TOK_STATEMENT);
-        (*base)->left = tmp;
+        LINK_LEFT(*base, tmp);
+
+        body = 0;
 
         if(tok.type == TYPE_KEYWORD && tok.val.key == TOK_CONST)
         {
-            PASS$(!assign(&(*base)->right), return PARSER_PASS_ERR; );
+            PASS$(!assign(ctx, &body), return PARSER_PASS_ERR; );
+            LINK_RIGHT(*base, body);
             PEEK(&tok, 0);
             continue;
         }
@@ -794,40 +899,211 @@ static parser_err general(Node** base)
         PEEK(&tok, 1);
         if(tok.type == TYPE_OP && (tok.val.op == TOK_ASSIGN || tok.val.op == TOK_LQPAR))
         {
-            PASS$(!assign(&(*base)->right), return PARSER_PASS_ERR; );
+            PASS$(!assign(ctx, &body), return PARSER_PASS_ERR; );
+            LINK_RIGHT(*base, body);
             PEEK(&tok, 0);
             continue;
         }
 
-        PASS$(!define(&(*base)->right), return PARSER_PASS_ERR; );
+        PASS$(!define(ctx, &body), return PARSER_PASS_ERR; );
+        LINK_RIGHT(*base, body);
         PEEK(&tok, 0);
     }
     
     return PARSER_NOERR;
 }
 
-parser_err parse(Tree* tree, Dependencies* deps, Token_array* tok_arr)
+///////////////////////////////////////////////////////////////////////////////
+
+static const ptrdiff_t PARSER_RANGE_MIN_SZ = 1 << 16;  // tokens, smaller sources are parsed sequentially
+static const ptrdiff_t PARSER_MAX_THREADS  = 16;
+
+// Top-level definitions of range of tokens, parsed by separate thread
+struct Parser_range_
+{
+    Token_stream stream;
+    Tree         tree;
+    Dependencies deps;
+    parser_err   err;
+};
+
+// Splits prelexed tokens into at most 'n_ranges' ranges of similar size, each range consists of
+// whole top-level definitions. Bounds are indices of first tokens, returns number of ranges
+static ptrdiff_t split_tokens_(const Token_array* tokens, ptrdiff_t n_ranges, ptrdiff_t bounds[])
+{
+    assert(tokens && bounds);
+
+    ptrdiff_t n_bounds = 1;
+    ptrdiff_t depth    = 0;
+    bool is_in_directive = false;
+
+    bounds[0] = 0;
+
+    for(ptrdiff_t iter = 0; iter + 1 < tokens->eof && n_bounds < n_ranges; iter++)
+    {
+        Token tok  = token_array_get(tokens, iter);
+        bool is_end = false;
+
+        if(tok.type == TYPE_DIRECTIVE_BEGIN)
+        {
+            is_in_directive = true;
+        }
+        else if(tok.type == TYPE_DIRECTIVE_END)
+        {
+            is_in_directive = false;
+            is_end = depth == 0;
+        }
+        else if(tok.type == TYPE_OP && tok.val.op == TOK_LFPAR)
+        {
+            depth++;
+        }
+        else if(tok.type == TYPE_OP && tok.val.op == TOK_RFPAR)
+        {
+            depth--;
+            is_end = depth == 0;
+        }
+        else if(tok.type == TYPE_OP && tok.val.op == TOK_SEMICOLON)
+        {
+            is_end = depth == 0;
+        }
+
+        if(is_end && !is_in_directive && iter + 1 >= tokens->eof * n_bounds / n_ranges)
+        {
+            bounds[n_bounds] = iter + 1;
+            n_bounds++;
+        }
+    }
+
+    bounds[n_bounds] = tokens->eof;
+
+    return n_bounds;
+}
+
+static void* parse_range_(void* arg)
+{
+    Parser_range_* range = (Parser_range_*) arg;
+
+    Parser_context ctx = {&range->tree, &range->stream, &range->deps, true};
+    range->err = general(&ctx, &range->tree.root);
+
+    return nullptr;
+}
+
+// Statement chain of range is put above chain of previous ranges, so that tree is the same as after
+// sequential parsing. Error means that sequential parsing has to report it (redeclaration in directives)
+static parser_err merge_range_(Tree* tree, Dependencies* deps, Parser_range_* range)
+{
+    assert(tree && range);
+
+    for(size_t iter = 0; iter < range->deps.buffer_sz; iter++)
+    {
+        if(!deps || dep_find(deps, range->deps.buffer[iter].func.val.name))
+            return PARSER_PASS_ERR;
+
+        PASS$(!dep_add(deps, range->deps.buffer[iter]), return PARSER_PASS_ERR; );
+    }
+
+    ptrdiff_t root = 0;
+    ASSERT_RET$(!tree_merge(tree, &range->tree, &root), PARSER_TREE_FAIL);
+
+    if(root)
+    {
+        Node* first = tree_node(tree, root);
+        while(node_left(first))
+            first = node_left(first);
+
+        node_set_left(first, tree_root(tree));
+        tree->root = root;
+    }
+
+    return PARSER_NOERR;
+}
+
+// Parses ranges of top-level definitions of prelexed source on several threads.
+// Returns false if source has to be parsed sequentially: it is small or some range has error
+static bool parse_parallel_(Tree* tree, Dependencies* deps, Token_stream* stream)
 {
-    assert(tree && tok_arr);
+    assert(tree && stream);
+    assert(!tree->root);
+
+    if(!stream->is_prelexed || stream->pos != 0)
+        return false;
+
+    ptrdiff_t n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if(n_threads > PARSER_MAX_THREADS)
+        n_threads = PARSER_MAX_THREADS;
+
+    if(stream->tokens.eof / PARSER_RANGE_MIN_SZ < n_threads)
+        n_threads = stream->tokens.eof / PARSER_RANGE_MIN_SZ;
+
+    if(n_threads < 2)
+        return false;
+
+    ptrdiff_t bounds[PARSER_MAX_THREADS + 1] = {};
+    ptrdiff_t n_ranges = split_tokens_(&stream->tokens, n_threads, bounds);
+    if(n_ranges < 2)
+        return false;
+
+    Parser_range_ ranges[PARSER_MAX_THREADS] = {};
+    pthread_t     threads[PARSER_MAX_THREADS] = {};
+    bool          is_started[PARSER_MAX_THREADS] = {};
+
+    for(ptrdiff_t iter = 0; iter < n_ranges; iter++)
+    {
+        token_stream_slice(&ranges[iter].stream, stream, bounds[iter], bounds[iter + 1]);
+
+        is_started[iter] = pthread_create(&threads[iter], nullptr, parse_range_, &ranges[iter]) == 0;
+        if(!is_started[iter])
+            parse_range_(&ranges[iter]);
+    }
 
-    TREE_         = tree;
-    TOKEN_ARRAY_  = tok_arr;
-    DEPENDENCIES_ = deps;
+    bool is_parsed = true;
+
+    for(ptrdiff_t iter = 0; iter < n_ranges; iter++)
+    {
+        if(is_started[iter])
+            pthread_join(threads[iter], nullptr);
+
+        if(ranges[iter].err)
+            is_parsed = false;
+
+        if(is_parsed && merge_range_(tree, deps, &ranges[iter]))
+            is_parsed = false;
+    }
+
+    for(ptrdiff_t iter = 0; iter < n_ranges; iter++)
+    {
+        tree_dstr(&ranges[iter].tree);
+        dep_dtor(&ranges[iter].deps);
+    }
+
+    if(!is_parsed)
+    {
+        tree_dstr(tree);
+        *tree = {};
+
+        if(deps)
+            dep_dtor(deps);
+    }
+
+    return is_parsed;
+}
+
+parser_err parse(Tree* tree, Dependencies* deps, Token_stream* stream)
+{
+    assert(tree && stream);
+
+    Parser_context ctx = {tree, stream, deps};
 
     MSG$("\n\n----------------------Parsing started----------------------\n\n");
 
-    parser_err err = general(&TREE_->root);
+    parser_err err = PARSER_NOERR;
+    if(!parse_parallel_(tree, deps, stream))
+        err = general(&ctx, &tree->root);
 
     MSG$("\n\n----------------------Parsing finished----------------------\n\n");
 
-    if(err)
-        token_array_dump(tok_arr);
-        
-    tree_dump(TREE_, "DUMP");
-
-    TREE_         = nullptr;
-    TOKEN_ARRAY_  = nullptr;
-    DEPENDENCIES_ = nullptr;
+    tree_dump(tree, "DUMP");
 
     return err;
 }
@@ -3,6 +3,7 @@
 
 #include "../tree/Tree.h"
 #include "../common/depend.h"
+#include "lexer.h"
 
 enum parser_err
 {
@@ -12,6 +13,6 @@ enum parser_err
     PARSER_TREE_FAIL = 3,
 };
 
-parser_err parse(Tree* tree, Dependencies* deps, Token_array* tok_arr);
+parser_err parse(Tree* tree, Dependencies* deps, Token_stream* stream);
 
 #endif // PARSER_H
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <string.h>
 
 #include "Token.h"
 #include "../reserved_names.h"
@@ -19,39 +20,97 @@ static token_err array_resize_(Token_array* tok_arr)
     else
         new_cap = tok_arr->cap * TOK_CAP_MULTPLR;
 
-    Token* new_data = (Token*) realloc(tok_arr->data, (size_t) new_cap * sizeof(Token));
-    ASSERT_RET$(new_data, TOKEN_BAD_ALLOC);
+    // Arrays already grown stay valid if next realloc fails, 'cap' changes only after all
+    int8_t* new_kinds = (int8_t*) realloc(tok_arr->kinds, (size_t) new_cap * sizeof(int8_t));
+    ASSERT_RET$(new_kinds, TOKEN_BAD_ALLOC);
+    tok_arr->kinds = new_kinds;
 
-    tok_arr->data = new_data;
-    tok_arr->cap  = new_cap;
+    Token::Value* new_vals = (Token::Value*) realloc(tok_arr->vals, (size_t) new_cap * sizeof(Token::Value));
+    ASSERT_RET$(new_vals, TOKEN_BAD_ALLOC);
+    tok_arr->vals = new_vals;
+
+    uint32_t* new_offsets = (uint32_t*) realloc(tok_arr->offsets, (size_t) new_cap * sizeof(uint32_t));
+    ASSERT_RET$(new_offsets, TOKEN_BAD_ALLOC);
+    tok_arr->offsets = new_offsets;
+
+    tok_arr->cap = new_cap;
 
     return TOKEN_NOERR;
 }
 
-token_err token_array_add(Token_array* tok_arr, const Token* token)
+// Offsets beyond 4 GiB are saturated, they are used for diagnostics only
+token_err token_array_add(Token_array* tok_arr, const Token* token, ptrdiff_t offset)
 {
     assert(token && tok_arr);
 
     if(tok_arr->cap == tok_arr->size)
         PASS$(!array_resize_(tok_arr), return TOKEN_BAD_ALLOC; );
     
-    *(tok_arr->data + tok_arr->size) = *token;
+    tok_arr->kinds  [tok_arr->size] = (int8_t) token->type;
+    tok_arr->vals   [tok_arr->size] = token->val;
+    tok_arr->offsets[tok_arr->size] = (offset < UINT32_MAX) ? (uint32_t) offset : UINT32_MAX;
     tok_arr->size++;
 
     return TOKEN_NOERR;
 }
 
+Token token_array_get(const Token_array* tok_arr, ptrdiff_t index)
+{
+    assert(tok_arr);
+    assert(index >= 0 && index < tok_arr->size);
+
+    Token tok = {};
+    tok.type  = (token_type) tok_arr->kinds[index];
+    tok.val   = tok_arr->vals[index];
+
+    return tok;
+}
+
 void token_array_dstr(Token_array* tok_arr)
 {
     assert(tok_arr);
 
-    if(tok_arr->data)
-        free(tok_arr->data);
+    free(tok_arr->kinds);
+    free(tok_arr->vals);
+    free(tok_arr->offsets);
 
-    tok_arr->cap = 0;
-    tok_arr->size = 0;
-    tok_arr->eof = 0;
-    tok_arr->size = 0;
+    *tok_arr = {};
+}
+
+void token_location(const char data[], ptrdiff_t offset, ptrdiff_t* line, ptrdiff_t* column)
+{
+    assert(data && line && column);
+
+    *line   = 1;
+    *column = 1;
+
+    for(ptrdiff_t iter = 0; iter < offset; iter++)
+    {
+        if(data[iter] == '\n')
+        {
+            (*line)++;
+            *column = 1;
+        }
+        else if(((unsigned char) data[iter] & 0xC0) != 0x80)
+        {
+            (*column)++;
+        }
+    }
+}
+
+static const ptrdiff_t TOK_ARENA_CHUNK = 1 << 16;
+
+static uint64_t name_hash_(const char name[], ptrdiff_t name_sz)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for(ptrdiff_t iter = 0; iter < name_sz; iter++)
+    {
+        hash ^= (unsigned char) name[iter];
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
 }
 
 static token_err nametable_resize_(Token_nametable* tok_table)
@@ -73,37 +132,102 @@ static token_err nametable_resize_(Token_nametable* tok_table)
     return TOKEN_NOERR;
 }
 
-static ptrdiff_t nametable_find_(Token_nametable* tok_table, const char name[], ptrdiff_t name_sz)
+static void slot_place_(Token_nametable* tok_table, Token_name_slot slot)
+{
+    ptrdiff_t mask = tok_table->slots_cap - 1;
+    ptrdiff_t pos  = (ptrdiff_t) (slot.hash & (uint64_t) mask);
+
+    while(tok_table->slots[pos].index)
+        pos = (pos + 1) & mask;
+
+    tok_table->slots[pos] = slot;
+}
+
+// Index is kept at most half full
+static token_err slots_resize_(Token_nametable* tok_table)
+{
+    assert(tok_table);
+
+    Token_name_slot* old_slots = tok_table->slots;
+    ptrdiff_t        old_cap   = tok_table->slots_cap;
+
+    ptrdiff_t new_cap = old_cap ? old_cap * 2 : TOK_MIN_CAP * 2;
+
+    tok_table->slots = (Token_name_slot*) calloc((size_t) new_cap, sizeof(Token_name_slot));
+    if(!tok_table->slots)
+    {
+        tok_table->slots = old_slots;
+        ASSERT_RET$(0, TOKEN_BAD_ALLOC);
+    }
+
+    tok_table->slots_cap = new_cap;
+
+    for(ptrdiff_t iter = 0; iter < old_cap; iter++)
+    {
+        if(old_slots[iter].index)
+            slot_place_(tok_table, old_slots[iter]);
+    }
+
+    free(old_slots);
+
+    return TOKEN_NOERR;
+}
+
+static char* arena_alloc_(Token_nametable* tok_table, ptrdiff_t size)
 {
     assert(tok_table);
 
-    for(ptrdiff_t iter = 0; iter < tok_table->size; iter++)
+    Token_arena* chunk = tok_table->arena;
+
+    if(!chunk || chunk->cap - chunk->size < size)
     {
-        ptrdiff_t len = (ptrdiff_t) strlen(tok_table->name_arr[iter]);
+        ptrdiff_t cap = (size > TOK_ARENA_CHUNK) ? size : TOK_ARENA_CHUNK;
+
+        chunk = (Token_arena*) calloc(1, sizeof(Token_arena) + (size_t) cap);
+        if(!chunk)
+            return nullptr;
+
+        chunk->prev = tok_table->arena;
+        chunk->cap  = cap;
 
-        if(len == name_sz)
-            if(strncmp(name, tok_table->name_arr[iter], (size_t) name_sz) == 0)
-                return iter;
+        tok_table->arena = chunk;
     }
 
-    return -1;
+    char* ptr = (char*) (chunk + 1) + chunk->size;
+    chunk->size += size;
+
+    return ptr;
 }
 
 token_err token_nametable_add(Token_nametable* tok_table, char** dst_ptr, const char name[], ptrdiff_t name_sz)
 {
     assert(tok_table && name);
 
-    ptrdiff_t indx = nametable_find_(tok_table, name, name_sz);
-    if(indx != -1)
+    uint64_t  hash = name_hash_(name, name_sz);
+    ptrdiff_t mask = tok_table->slots_cap - 1;
+
+    if(tok_table->slots_cap)
     {
-        *dst_ptr = tok_table->name_arr[indx];
-        return TOKEN_NOERR;
+        for(ptrdiff_t pos = (ptrdiff_t) (hash & (uint64_t) mask); tok_table->slots[pos].index; pos = (pos + 1) & mask)
+        {
+            Token_name_slot* slot = &tok_table->slots[pos];
+
+            if(slot->hash == hash && slot->len == name_sz &&
+               memcmp(tok_table->name_arr[slot->index - 1], name, (size_t) name_sz) == 0)
+            {
+                *dst_ptr = tok_table->name_arr[slot->index - 1];
+                return TOKEN_NOERR;
+            }
+        }
     }
 
     if(tok_table->cap == tok_table->size)
         PASS$(!nametable_resize_(tok_table), return TOKEN_BAD_ALLOC; );
+
+    if((tok_table->size + 1) * 2 > tok_table->slots_cap)
+        PASS$(!slots_resize_(tok_table), return TOKEN_BAD_ALLOC; );
     
-    char* new_ptr = (char*) calloc((size_t) name_sz + 1, sizeof(char));
+    char* new_ptr = arena_alloc_(tok_table, name_sz + 1);
     ASSERT_RET$(new_ptr, TOKEN_BAD_ALLOC);
 
     memcpy(new_ptr, name, (size_t) name_sz);
@@ -112,6 +236,8 @@ token_err token_nametable_add(Token_nametable* tok_table, char** dst_ptr, const
     tok_table->name_arr[tok_table->size] = new_ptr;
     tok_table->size++;
 
+    slot_place_(tok_table, {.index = tok_table->size, .len = name_sz, .hash = hash});
+
     *dst_ptr = new_ptr;
 
     return TOKEN_NOERR;
@@ -121,15 +247,21 @@ void token_nametable_dstr(Token_nametable* tok_table)
 {
     assert(tok_table);
 
-    for(ptrdiff_t iter = 0; iter < tok_table->size; iter++)
-        free(tok_table->name_arr[iter]);
+    while(tok_table->arena)
+    {
+        Token_arena* prev = tok_table->arena->prev;
+        free(tok_table->arena);
+        tok_table->arena = prev;
+    }
 
-    if(tok_table->name_arr)
-        free(tok_table->name_arr);
+    free(tok_table->name_arr);
+    free(tok_table->slots);
     
-    tok_table->cap = 0;
-    tok_table->size = 0;
-    tok_table->name_arr = nullptr;
+    tok_table->cap       = 0;
+    tok_table->size      = 0;
+    tok_table->name_arr  = nullptr;
+    tok_table->slots     = nullptr;
+    tok_table->slots_cap = 0;
 }
 
 #define DEF_OP(NAME, STD_NAME, MANGLE)          \
@@ -156,7 +288,7 @@ char* std_demangle(const Token* tok)
 {
     assert(tok);
     
-    static char buffer[BUFSIZ] = "";
+    static thread_local char buffer[BUFSIZ] = "";
 
     switch(tok->type)
     {
@@ -267,7 +399,7 @@ char* demangle(const Token* tok)
 {
     assert(tok);
     
-    static char buffer[BUFSIZ] = "";
+    static thread_local char buffer[BUFSIZ] = "";
 
     switch(tok->type)
     {
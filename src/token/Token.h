@@ -61,9 +61,14 @@ struct Token
     } val = {};
 };
 
+// Tokens are stored field by field: scanning kinds touches one byte per token.
+// Offsets of tokens in source are resolved to line and column only for diagnostics
 struct Token_array
 {
-    Token* data = nullptr;
+    int8_t*       kinds   = nullptr;    // token_type
+    Token::Value* vals    = nullptr;
+    uint32_t*     offsets = nullptr;
+
     ptrdiff_t size = 0;
     ptrdiff_t cap  = 0;
 
@@ -71,12 +76,34 @@ struct Token_array
     ptrdiff_t eof  = 0;
 };
 
+// Slot of name index, 'index' is position in name_arr plus one (0 if slot is empty)
+struct Token_name_slot
+{
+    ptrdiff_t index;
+    ptrdiff_t len;
+    uint64_t  hash;
+};
+
+// Chunk of name bytes, names never move once written
+struct Token_arena
+{
+    Token_arena* prev;
+
+    ptrdiff_t    size;
+    ptrdiff_t    cap;
+};
+
 struct Token_nametable 
 {
     char** name_arr = nullptr;
 
     ptrdiff_t size = 0;
     ptrdiff_t cap  = 0;
+
+    Token_name_slot* slots     = nullptr;
+    ptrdiff_t        slots_cap = 0; // power of 2
+
+    Token_arena*     arena     = nullptr;
 };
 
 enum token_err
@@ -87,7 +114,8 @@ enum token_err
     TOKEN_UNKNWN_SYMB = 3,
 };
 
-token_err token_array_add(Token_array* tok_arr, const Token* token);
+token_err token_array_add(Token_array* tok_arr, const Token* token, ptrdiff_t offset);
+Token     token_array_get(const Token_array* tok_arr, ptrdiff_t index);
 void      token_array_dstr(Token_array* tok_arr);
 
 void      token_array_dump(Token_array* tok_arr);
@@ -97,6 +125,13 @@ void      token_dump_init(FILE* dump_stream);
 token_err token_nametable_add(Token_nametable* tok_table, char** dst_ptr, const char name[], ptrdiff_t name_sz);
 void      token_nametable_dstr(Token_nametable* tok_table);
 
+// Parses numeric literal at the beginning of data of 'data_sz' bytes,
+// returns its length (0 if data doesn't start with digit)
+ptrdiff_t token_number(const char data[], ptrdiff_t data_sz, double* num);
+
+// Line and column (both from 1, column in UTF-8 letters) of byte 'offset' of source
+void      token_location(const char data[], ptrdiff_t offset, ptrdiff_t* line, ptrdiff_t* column);
+
 char*     std_demangle(const Token* tok);
 char*     demangle(const Token* tok);
 
@@ -55,7 +55,7 @@ void token_array_dump(Token_array* tok_arr)
 
     PRINT("<tr><th>name</th><th>std name</th><th>mangle</th></tr>\n");
 
-    if(!tok_arr->data)
+    if(!tok_arr->kinds)
     {
         PRINT("<tr><th colspan=\"3\" class = \"error\">\n\tDATA IS NULL\n</th></tr>\n"
               "</tbody></table>\n");
@@ -68,10 +68,13 @@ void token_array_dump(Token_array* tok_arr)
             PRINT("<tr style = \"height: 40px; color: yellow\">\n");
         else
             PRINT("<tr style = \"height: 40px;\">\n");
-        switch(tok_arr->data[iter].type)
+
+        Token tok = token_array_get(tok_arr, iter);
+
+        switch(tok.type)
         {
             case TYPE_OP:
-                switch(tok_arr->data[iter].val.op)
+                switch(tok.val.op)
                 {
                     #include "../reserved_operators.inc"
 
@@ -81,7 +84,7 @@ void token_array_dump(Token_array* tok_arr)
                 break;
                 
             case TYPE_AUX:
-                switch(tok_arr->data[iter].val.aux)
+                switch(tok.val.aux)
                 {
                     #include "../reserved_auxiliary.inc"
 
@@ -91,7 +94,7 @@ void token_array_dump(Token_array* tok_arr)
                 break;
             
             case TYPE_KEYWORD:
-                switch(tok_arr->data[iter].val.key)
+                switch(tok.val.key)
                 {
                     #include "../reserved_keywords.inc"
 
@@ -101,7 +104,7 @@ void token_array_dump(Token_array* tok_arr)
                 break;
             
             case TYPE_EMBED:
-                switch(tok_arr->data[iter].val.emb)
+                switch(tok.val.emb)
                 {
                     #include "../reserved_embedded.inc"
 
@@ -111,11 +114,11 @@ void token_array_dump(Token_array* tok_arr)
                 break;
             
             case TYPE_ID:
-                PRINT("<td>  %s  </td>\n<td>  [%p]  </td>\n<td>  TYPE_ID  </td>\n", tok_arr->data[iter].val.name, tok_arr->data[iter].val.name);
+                PRINT("<td>  %s  </td>\n<td>  [%p]  </td>\n<td>  TYPE_ID  </td>\n", tok.val.name, tok.val.name);
                 break;
             
             case TYPE_NUMBER:
-                PRINT("<td>  %lg  </td>\n<td>  --//--  </td>\n<td>  TYPE_NUMBER  </td>\n", tok_arr->data[iter].val.num);
+                PRINT("<td>  %lg  </td>\n<td>  --//--  </td>\n<td>  TYPE_NUMBER  </td>\n", tok.val.num);
                 break;
             
             case TYPE_EOF:
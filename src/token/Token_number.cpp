@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string.h>
+
+#include "Token.h"
+
+// Powers of ten exactly representable in double
+static const double POW10_[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static const int      POW10_MAX_    = 22;
+static const uint64_t MANTISSA_MAX_ = (uint64_t) 1 << 53;
+
+static const ptrdiff_t LITERAL_BUF_SZ_ = 128;
+
+static inline bool is_digit_(char sym)
+{
+    return sym >= '0' && sym <= '9';
+}
+
+// Data isn't null-terminated, so strtod works on copy of first 'len' bytes
+static ptrdiff_t strtod_bounded_(const char data[], ptrdiff_t len, double* num)
+{
+    assert(data && num);
+
+    char  local[LITERAL_BUF_SZ_] = "";
+    char* buf = local;
+
+    if(len >= LITERAL_BUF_SZ_)
+    {
+        buf = (char*) calloc((size_t) len + 1, sizeof(char));
+        if(!buf)
+        {
+            *num = 0;
+            return len;
+        }
+    }
+
+    memcpy(buf, data, (size_t) len);
+    buf[len] = '\0';
+
+    char* end = nullptr;
+    *num = strtod(buf, &end);
+    ptrdiff_t n_read = end - buf;
+
+    if(buf != local)
+        free(buf);
+
+    return n_read;
+}
+
+ptrdiff_t token_number(const char data[], ptrdiff_t data_sz, double* num)
+{
+    assert(data && num);
+
+// Byte of data or '\0' past its end
+#define AT_(POS) ((POS) < data_sz ? data[POS] : '\0')
+
+    if(!is_digit_(AT_(0)))
+        return 0;
+
+    // Hexadecimal form is left to strtod
+    if(data[0] == '0' && (AT_(1) == 'x' || AT_(1) == 'X'))
+        return strtod_bounded_(data, (data_sz < LITERAL_BUF_SZ_ - 1) ? data_sz : LITERAL_BUF_SZ_ - 1, num);
+
+    ptrdiff_t pos      = 0;
+    uint64_t  mantissa = 0;
+    int       n_digits = 0;     // significant digits in mantissa
+    int       exp10    = 0;
+    bool      is_exact = true;  // all digits are kept in mantissa
+
+    for(; is_digit_(AT_(pos)); pos++)
+    {
+        if(mantissa == 0 && AT_(pos) == '0')
+            continue;
+
+        if(n_digits < 19)
+        {
+            mantissa = mantissa * 10 + (uint64_t) (AT_(pos) - '0');
+            n_digits++;
+        }
+        else
+        {
+            exp10++;
+            is_exact &= AT_(pos) == '0';
+        }
+    }
+
+    bool is_integer = true;
+
+    if(AT_(pos) == '.')
+    {
+        is_integer = false;
+
+        for(pos++; is_digit_(AT_(pos)); pos++)
+        {
+            if(mantissa == 0 && AT_(pos) == '0')
+            {
+                exp10--;
+                continue;
+            }
+
+            if(n_digits < 19)
+            {
+                mantissa = mantissa * 10 + (uint64_t) (AT_(pos) - '0');
+                n_digits++;
+                exp10--;
+            }
+            else
+            {
+                is_exact &= AT_(pos) == '0';
+            }
+        }
+    }
+
+    // Exponent is taken only if it has digits, as in strtod
+    if(AT_(pos) == 'e' || AT_(pos) == 'E')
+    {
+        ptrdiff_t exp_pos = pos + 1;
+        bool      is_neg  = false;
+
+        if(AT_(exp_pos) == '+' || AT_(exp_pos) == '-')
+        {
+            is_neg = AT_(exp_pos) == '-';
+            exp_pos++;
+        }
+
+        if(is_digit_(AT_(exp_pos)))
+        {
+            is_integer = false;
+
+            int exp = 0;
+            for(; is_digit_(AT_(exp_pos)); exp_pos++)
+            {
+                if(exp < 100000)
+                    exp = exp * 10 + (AT_(exp_pos) - '0');
+            }
+
+            exp10 += is_neg ? -exp : exp;
+            pos    = exp_pos;
+        }
+    }
+
+    // Integer literal is exact if it fits mantissa of double
+    if(is_integer && is_exact && exp10 == 0 && mantissa <= MANTISSA_MAX_)
+    {
+        *num = (double) mantissa;
+        return pos;
+    }
+
+    // Both mantissa and power of ten are exact, so single operation rounds correctly
+    if(is_exact && mantissa <= MANTISSA_MAX_ && exp10 >= -POW10_MAX_ && exp10 <= POW10_MAX_)
+    {
+        if(exp10 < 0)
+            *num = (double) mantissa / POW10_[-exp10];
+        else
+            *num = (double) mantissa * POW10_[exp10];
+
+        return pos;
+    }
+
+    // Rare long or extreme literals
+    strtod_bounded_(data, pos, num);
+
+    return pos;
+
+#undef AT_
+}
@@ -5,40 +5,49 @@
 #include "transpiler.h"
 #include "../common/dumpsystem.h"
 
-static FILE* OSTREAM = nullptr;
+// Output and error state of one degenerator() call
+struct Degenerator_context
+{
+    Tree* tree    = nullptr;
+    FILE* ostream = nullptr;
+
+    int indentation = 0;
 
-static degenerator_err IS_ERROR = DEGENERATOR_NOERR;
+    degenerator_err is_error = DEGENERATOR_NOERR;
+};
 
-#define semantic_error(MSG_, TOK_)                                                      \
+#define semantic_error(MSG_, NODE_)                                                     \
 do                                                                                      \
 {                                                                                       \
-    IS_ERROR = DEGENERATOR_SEMANTIC_ERROR;                                                \
-    fprintf(stderr, "\x1b[31mSemantic error:\x1b[0m %s : %s\n", (MSG_), std_demangle(TOK_));\
+    ctx->is_error = DEGENERATOR_SEMANTIC_ERROR;                                         \
+    Token tok_ = node_token(ctx->tree, (NODE_));                                        \
+    fprintf(stderr, "\x1b[31mSemantic error:\x1b[0m %s : %s\n", (MSG_), std_demangle(&tok_));\
     FILE* stream_ = dumpsystem_get_opened_stream();                                     \
                                                                                         \
     if(stream_)                                                                         \
     {                                                                                   \
         fprintf(stream_, "<span class = \"error\">Semantic error: %s : %s\n</span>"     \
                          "\t\t\t\tat %s:%d:%s\n",                                       \
-                         (MSG_), std_demangle(TOK_),                                    \
+                         (MSG_), std_demangle(&tok_),                                    \
                          __FILE__, __LINE__, __PRETTY_FUNCTION__);                      \
                                                                                         \
         return DEGENERATOR_PASS_ERROR;                                                         \
     }                                                                                   \
 } while(0)                                                                              \
 
-#define format_error(MSG_, TOK_)                                                        \
+#define format_error(MSG_, NODE_)                                                       \
 do                                                                                      \
 {                                                                                       \
-    IS_ERROR = DEGENERATOR_FORMAT_ERROR;                                                  \
-    fprintf(stderr, "\x1b[31mFormat error:\x1b[0m %s : %s\n", (MSG_), std_demangle(TOK_));  \
+    ctx->is_error = DEGENERATOR_FORMAT_ERROR;                                           \
+    Token tok_ = node_token(ctx->tree, (NODE_));                                        \
+    fprintf(stderr, "\x1b[31mFormat error:\x1b[0m %s : %s\n", (MSG_), std_demangle(&tok_));  \
     FILE* stream_ = dumpsystem_get_opened_stream();                                     \
                                                                                         \
     if(stream_)                                                                         \
     {                                                                                   \
         fprintf(stream_, "<span class = \"error\">Format error: %s : %s\n</span>"       \
                          "\t\t\t\tat %s : %d : %s\n",                                   \
-                         (MSG_), std_demangle(TOK_),                                        \
+                         (MSG_), std_demangle(&tok_),                                        \
                          __FILE__, __LINE__, __PRETTY_FUNCTION__);                      \
                                                                                         \
         return DEGENERATOR_NOERR;                                                         \
@@ -47,51 +56,56 @@ do
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-static int INDENTATION = 0;
+#define print_tab(fmt, ...) fprintf(ctx->ostream, "%*s" fmt, ctx->indentation * 4, "", ##__VA_ARGS__)
+#define print(fmt, ...)     fprintf(ctx->ostream, fmt, ##__VA_ARGS__)
 
-#define print_tab(fmt, ...) fprintf(OSTREAM, "%*s" fmt, INDENTATION * 4, "", ##__VA_ARGS__)
-#define print(fmt, ...)     fprintf(OSTREAM, fmt, ##__VA_ARGS__)
+static const char* demangle_node_(const Degenerator_context* ctx, const Node* node)
+{
+    Token tok = node_token(ctx->tree, node);
 
-static degenerator_err expression(Node* node);
-static degenerator_err statement(Node* node);
+    return demangle(&tok);
+}
 
-static degenerator_err number(Node* node)
+static degenerator_err expression(Degenerator_context* ctx, Node* node);
+static degenerator_err statement(Degenerator_context* ctx, Node* node);
+
+static degenerator_err number(Degenerator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_NUMBER);
+    assert(node_type(node) == TYPE_NUMBER);
 
-    if(node->left || node->right)
-        format_error("Number has descendants", &node->tok);
+    if(node_left(node) || node_right(node))
+        format_error("Number has descendants", node);
 
-    print("%lg", node->tok.val.num);
+    print("%lg", node_num(ctx->tree, node));
 
     return DEGENERATOR_NOERR;
 }
 
-static degenerator_err variable(Node* node)
+static degenerator_err variable(Degenerator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_ID);
+    assert(node_type(node) == TYPE_ID);
 
     Token tok = {};
-    if(node->left)
+    if(node_left(node))
     {
         tok.type = TYPE_KEYWORD;
         tok.val.key = TOK_CONST;
         print("%s ", demangle(&tok));
 
-        semantic_error("Variable has 'const' specifier in expression", &node->tok);
+        semantic_error("Variable has 'const' specifier in expression", node);
     }
     
-    print("%s", demangle(&node->tok));
+    print("%s", demangle_node_(ctx, node));
 
-    if(node->right)
+    if(node_right(node))
     {
         tok.type = TYPE_OP;
         tok.val.op = TOK_SHIFT;
         print(" %s (", demangle(&tok));
 
-        PASS$(!expression(node->right), return DEGENERATOR_PASS_ERROR; );
+        PASS$(!expression(ctx, node_right(node)), return DEGENERATOR_PASS_ERROR; );
         
         print(")");
     }
@@ -99,48 +113,48 @@ static degenerator_err variable(Node* node)
     return DEGENERATOR_NOERR;
 }
 
-static degenerator_err embedded(Node* node)
+static degenerator_err embedded(Degenerator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_EMBED);
+    assert(node_type(node) == TYPE_EMBED);
 
-    switch(node->tok.val.emb)
+    switch(node_emb(node))
     {
         case TOK_SIN : case TOK_COS : case TOK_PRINT : case TOK_INT :
         {
-            if(!node->right || node->left)
-                format_error("Embedded '' requires 1 argument", &node->tok);
+            if(!node_right(node) || node_left(node))
+                format_error("Embedded '' requires 1 argument", node);
 
-            print("%s(", demangle(&node->tok));
+            print("%s(", demangle_node_(ctx, node));
 
-            PASS$(!expression(node->right), return DEGENERATOR_PASS_ERROR; );
+            PASS$(!expression(ctx, node_right(node)), return DEGENERATOR_PASS_ERROR; );
 
             print(")");
             break;
         }
         case TOK_SCAN:
         {
-            if(node->right || node->left)
-                format_error("Embedded 'scan' cannot has arguments", &node->tok);
+            if(node_right(node) || node_left(node))
+                format_error("Embedded 'scan' cannot has arguments", node);
 
-            print("%s()", demangle(&node->tok));
+            print("%s()", demangle_node_(ctx, node));
             break;
         }
         case TOK_SHOW:
         {
-            if(!node->right || !node->left)
-                format_error("Embedded 'show' requires 2 arguments", &node->tok);
+            if(!node_right(node) || !node_left(node))
+                format_error("Embedded 'show' requires 2 arguments", node);
             
-            if(node->left->tok.type != TYPE_ID)
-                format_error("Embedded 'show' requires variable as first argument", &node->left->tok);
+            if(node_type(node_left(node)) != TYPE_ID)
+                format_error("Embedded 'show' requires variable as first argument", node_left(node));
 
-            print("%s(", demangle(&node->tok));
+            print("%s(", demangle_node_(ctx, node));
 
-            variable(node->left);
+            variable(ctx, node_left(node));
         
             print(", ");
 
-            PASS$(!expression(node->right), return DEGENERATOR_PASS_ERROR; );
+            PASS$(!expression(ctx, node_right(node)), return DEGENERATOR_PASS_ERROR; );
 
             print(")");
             break;
@@ -154,50 +168,50 @@ static degenerator_err embedded(Node* node)
     return DEGENERATOR_NOERR;
 }
     
-static degenerator_err call_parameter(Node* node)
+static degenerator_err call_parameter(Degenerator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_AUX && node->tok.val.aux == TOK_PARAMETER);
+    assert(node_type(node) == TYPE_AUX && node_aux(node) == TOK_PARAMETER);
 
-    if(node->left)
+    if(node_left(node))
     {
-        PASS$(!call_parameter(node->left), return DEGENERATOR_PASS_ERROR; );
+        PASS$(!call_parameter(ctx, node_left(node)), return DEGENERATOR_PASS_ERROR; );
 
         Token tok = {.type = TYPE_OP};
         tok.val.op = TOK_COMMA;
         print("%s ", demangle(&tok));
     }
 
-    if(!node->right)
-        format_error("Missing argument", &node->right->tok);
+    if(!node_right(node))
+        format_error("Missing argument", node_right(node));
     
-    PASS$(!expression(node->right), return DEGENERATOR_PASS_ERROR; );
+    PASS$(!expression(ctx, node_right(node)), return DEGENERATOR_PASS_ERROR; );
 
     return DEGENERATOR_NOERR;
 }
 
-static degenerator_err call(Node* node)
+static degenerator_err call(Degenerator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_AUX && node->tok.val.aux == TOK_CALL);
+    assert(node_type(node) == TYPE_AUX && node_aux(node) == TOK_CALL);
 
-    if(node->left->tok.type != TYPE_ID)
-        format_error("Left descendant of call is not function", &node->left->tok);
+    if(node_type(node_left(node)) != TYPE_ID)
+        format_error("Left descendant of call is not function", node_left(node));
     
-    print("%s(", demangle(&node->left->tok));
-    if(node->right)
-        PASS$(!call_parameter(node->right), return DEGENERATOR_PASS_ERROR; );
+    print("%s(", demangle_node_(ctx, node_left(node)));
+    if(node_right(node))
+        PASS$(!call_parameter(ctx, node_right(node)), return DEGENERATOR_PASS_ERROR; );
     
     print(")");
 
     return DEGENERATOR_NOERR;
 }
 
-static ptrdiff_t get_priority(Token* tok)
+static ptrdiff_t get_priority(const Node* node)
 {
-    assert(tok);
+    assert(node);
 
-    switch(tok->type)
+    switch(node_type(node))
     {
         case TYPE_EMBED : case TYPE_ID : case TYPE_NUMBER :
         {
@@ -205,18 +219,18 @@ static ptrdiff_t get_priority(Token* tok)
         }
         case TYPE_OP:
         {
-            if(tok->val.op == TOK_NOT)
+            if(node_op(node) == TOK_NOT)
                 return 9;
-            else if(tok->val.op == TOK_POWER)
+            else if(node_op(node) == TOK_POWER)
                 return 8;
-            else if(tok->val.op == TOK_MUL || tok->val.op == TOK_DIV)
+            else if(node_op(node) == TOK_MUL || node_op(node) == TOK_DIV)
                 return 7;
-            else if(tok->val.op == TOK_ADD || tok->val.op == TOK_SUB)
+            else if(node_op(node) == TOK_ADD || node_op(node) == TOK_SUB)
                 return 6;
-            else if(tok->val.op == TOK_EQ  || tok->val.op == TOK_NEQ   || tok->val.op == TOK_LEQ ||
-                    tok->val.op == TOK_GEQ || tok->val.op == TOK_GREAT || tok->val.op == TOK_LESS)
+            else if(node_op(node) == TOK_EQ  || node_op(node) == TOK_NEQ   || node_op(node) == TOK_LEQ ||
+                    node_op(node) == TOK_GEQ || node_op(node) == TOK_GREAT || node_op(node) == TOK_LESS)
                 return 5;
-            else if(tok->val.op == TOK_AND || tok->val.op == TOK_OR)
+            else if(node_op(node) == TOK_AND || node_op(node) == TOK_OR)
                 return 4;
             else
                 return -777;
@@ -229,61 +243,61 @@ static ptrdiff_t get_priority(Token* tok)
     }
 }
 
-static degenerator_err expression(Node* node)
+static degenerator_err expression(Degenerator_context* ctx, Node* node)
 {
     assert(node);
 
-    if(node->tok.type == TYPE_NUMBER)
+    if(node_type(node) == TYPE_NUMBER)
     {
-        PASS$(!number(node), return DEGENERATOR_PASS_ERROR; );
+        PASS$(!number(ctx, node), return DEGENERATOR_PASS_ERROR; );
         return DEGENERATOR_NOERR;
     }
     
-    if(node->tok.type == TYPE_ID)
+    if(node_type(node) == TYPE_ID)
     {
-        PASS$(!variable(node), return DEGENERATOR_PASS_ERROR; );
+        PASS$(!variable(ctx, node), return DEGENERATOR_PASS_ERROR; );
         return DEGENERATOR_NOERR;
     }
 
-    if(node->tok.type == TYPE_EMBED)
+    if(node_type(node) == TYPE_EMBED)
     {
-        PASS$(!embedded(node), return DEGENERATOR_PASS_ERROR; );
+        PASS$(!embedded(ctx, node), return DEGENERATOR_PASS_ERROR; );
         return DEGENERATOR_NOERR;
     }
 
-    if(node->tok.type == TYPE_AUX && node->tok.val.aux == TOK_CALL)
+    if(node_type(node) == TYPE_AUX && node_aux(node) == TOK_CALL)
     {
-        PASS$(!call(node), return DEGENERATOR_PASS_ERROR; );
+        PASS$(!call(ctx, node), return DEGENERATOR_PASS_ERROR; );
         return DEGENERATOR_NOERR;
     }
 
-    if(node->tok.type != TYPE_OP)
-        format_error("Unexpected token in expression", &node->tok);
+    if(node_type(node) != TYPE_OP)
+        format_error("Unexpected token in expression", node);
 
-    ptrdiff_t op_priority = get_priority(&node->tok);
+    ptrdiff_t op_priority = get_priority(node);
     ptrdiff_t priority    = 0;
 
-    if(node->left)
+    if(node_left(node))
     {
-        priority = get_priority(&node->left->tok);
+        priority = get_priority(node_left(node));
         if(op_priority >= priority)
             print("(");
 
-        PASS$(!expression(node->left), return DEGENERATOR_PASS_ERROR; );
+        PASS$(!expression(ctx, node_left(node)), return DEGENERATOR_PASS_ERROR; );
     
         if(op_priority >= priority)
             print(")");
     }
 
-    print(" %s ", demangle(&node->tok));
+    print(" %s ", demangle_node_(ctx, node));
 
-    if(node->right)
+    if(node_right(node))
     {
-        priority = get_priority(&node->right->tok);
+        priority = get_priority(node_right(node));
         if(op_priority >= priority)
             print("(");
 
-        PASS$(!expression(node->right), return DEGENERATOR_PASS_ERROR; );
+        PASS$(!expression(ctx, node_right(node)), return DEGENERATOR_PASS_ERROR; );
     
         if(op_priority >= priority)
             print(")");
@@ -292,33 +306,34 @@ static degenerator_err expression(Node* node)
     return DEGENERATOR_NOERR;
 }
 
-static degenerator_err conditional(Node* node)
+static degenerator_err conditional(Degenerator_context* ctx, Node* node)
 {
     assert(node);
-    if(!node->left || !node->right || node->right->tok.type != TYPE_AUX || node->right->tok.val.aux != TOK_DECISION)
-        format_error("Conditional statement missing or wrong descendant", &node->tok);
+    if(!node_left(node) || !node_right(node) ||
+       node_type(node_right(node)) != TYPE_AUX || node_aux(node_right(node)) != TOK_DECISION)
+        format_error("Conditional statement missing or wrong descendant", node);
 
-    print_tab("%s(", demangle(&node->tok));
+    print_tab("%s(", demangle_node_(ctx, node));
 
-    PASS$(!expression(node->left), return DEGENERATOR_PASS_ERROR; );
+    PASS$(!expression(ctx, node_left(node)), return DEGENERATOR_PASS_ERROR; );
     print(")\n");
 
     Token tok = {.type = TYPE_OP};
     tok.val.op = TOK_LFPAR;
     print_tab("%s\n", demangle(&tok));
-    INDENTATION++;
+    ctx->indentation++;
 
-    if(!node->right->left)
-        semantic_error("Conditional statement missing positive branch (no body statements)", &node->tok);
+    if(!node_left(node_right(node)))
+        semantic_error("Conditional statement missing positive branch (no body statements)", node);
 
-    PASS$(!statement(node->right->left), return DEGENERATOR_PASS_ERROR; );
+    PASS$(!statement(ctx, node_left(node_right(node))), return DEGENERATOR_PASS_ERROR; );
 
-    INDENTATION--;
+    ctx->indentation--;
     tok = {.type = TYPE_OP};
     tok.val.op = TOK_RFPAR;
     print_tab("%s\n", demangle(&tok));
 
-    if(!node->right->right)
+    if(!node_right(node_right(node)))
     {
         print("\n");
         return DEGENERATOR_NOERR;
@@ -331,11 +346,11 @@ static degenerator_err conditional(Node* node)
     tok.type = TYPE_OP;
     tok.val.op = TOK_LFPAR;
     print_tab("%s\n", demangle(&tok));
-    INDENTATION++;
+    ctx->indentation++;
 
-    PASS$(!statement(node->right->right), return DEGENERATOR_PASS_ERROR; );
+    PASS$(!statement(ctx, node_right(node_right(node))), return DEGENERATOR_PASS_ERROR; );
 
-    INDENTATION--;
+    ctx->indentation--;
     tok = {.type = TYPE_OP};
     tok.val.op = TOK_RFPAR;
     print_tab("%s\n\n", demangle(&tok));
@@ -343,29 +358,29 @@ static degenerator_err conditional(Node* node)
     return DEGENERATOR_NOERR;
 }
 
-static degenerator_err cycle(Node* node)
+static degenerator_err cycle(Degenerator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_KEYWORD && node->tok.val.key == TOK_WHILE);
+    assert(node_type(node) == TYPE_KEYWORD && node_key(node) == TOK_WHILE);
 
-    if(!node->left || !node->right)
-        format_error("Cycle statement missing descendant", &node->tok);
+    if(!node_left(node) || !node_right(node))
+        format_error("Cycle statement missing descendant", node);
 
     print("\n");
-    print_tab("%s(", demangle(&node->tok));
+    print_tab("%s(", demangle_node_(ctx, node));
 
-    PASS$(!expression(node->left), return DEGENERATOR_PASS_ERROR; );
+    PASS$(!expression(ctx, node_left(node)), return DEGENERATOR_PASS_ERROR; );
 
     print(")\n");
 
     Token tok = {.type = TYPE_OP};
     tok.val.op = TOK_LFPAR;
     print_tab("%s\n", demangle(&tok));
-    INDENTATION++;
+    ctx->indentation++;
 
-    PASS$(!statement(node->right), return DEGENERATOR_PASS_ERROR; );
+    PASS$(!statement(ctx, node_right(node)), return DEGENERATOR_PASS_ERROR; );
 
-    INDENTATION--;
+    ctx->indentation--;
     tok = {.type = TYPE_OP};
     tok.val.op = TOK_RFPAR;
     print_tab("%s\n", demangle(&tok));
@@ -373,16 +388,16 @@ static degenerator_err cycle(Node* node)
     return DEGENERATOR_NOERR;
 }
 
-static degenerator_err terminational(Node* node)
+static degenerator_err terminational(Degenerator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_KEYWORD && node->tok.val.key == TOK_RETURN);
+    assert(node_type(node) == TYPE_KEYWORD && node_key(node) == TOK_RETURN);
 
-    if(node->left || !node->right)
-        format_error("Terminational statement missing or wrong descendant", &node->tok);
+    if(node_left(node) || !node_right(node))
+        format_error("Terminational statement missing or wrong descendant", node);
 
-    print_tab("%s ", demangle(&node->tok));
-    PASS$(!expression(node->right), return DEGENERATOR_PASS_ERROR; );
+    print_tab("%s ", demangle_node_(ctx, node));
+    PASS$(!expression(ctx, node_right(node)), return DEGENERATOR_PASS_ERROR; );
 
     Token tok = {.type = TYPE_OP};
     tok.val.op = TOK_SEMICOLON;
@@ -391,47 +406,47 @@ static degenerator_err terminational(Node* node)
     return DEGENERATOR_NOERR;
 }
 
-static degenerator_err assignment(Node* node)
+static degenerator_err assignment(Degenerator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_OP && node->tok.val.op == TOK_ASSIGN);
+    assert(node_type(node) == TYPE_OP && node_op(node) == TOK_ASSIGN);
 
-    if(!node->left)
-        format_error("Assignment requires lvalue", &node->tok);
+    if(!node_left(node))
+        format_error("Assignment requires lvalue", node);
 
-    if(node->left->tok.type != TYPE_ID)
-        format_error("Assignment requires identifier as lvalue", &node->left->tok);
+    if(node_type(node_left(node)) != TYPE_ID)
+        format_error("Assignment requires identifier as lvalue", node_left(node));
 
     print_tab("");
 
-    if(node->left->left)
+    if(node_left(node_left(node)))
     {
-        if(node->left->left->tok.type != TYPE_KEYWORD || node->left->left->tok.val.key != TOK_CONST)
-            format_error("Variable has wrong left descendant ('const' expected)", &node->left->left->tok);
+        if(node_type(node_left(node_left(node))) != TYPE_KEYWORD || node_key(node_left(node_left(node))) != TOK_CONST)
+            format_error("Variable has wrong left descendant ('const' expected)", node_left(node_left(node)));
 
-        print("%s ", demangle(&node->left->left->tok));
+        print("%s ", demangle_node_(ctx, node_left(node_left(node))));
     }
     
-    print("%s", demangle(&node->left->tok));
+    print("%s", demangle_node_(ctx, node_left(node)));
 
     Token tok = {};
     
-    if(node->left->right)
+    if(node_right(node_left(node)))
     {
         tok = {.type = TYPE_OP};
         tok.val.op = TOK_LQPAR;
         print("%s", demangle(&tok));
 
-        PASS$(!expression(node->left->right), return DEGENERATOR_PASS_ERROR; );
+        PASS$(!expression(ctx, node_right(node_left(node))), return DEGENERATOR_PASS_ERROR; );
 
         tok = {.type = TYPE_OP};
         tok.val.op = TOK_RQPAR;
         print("%s", demangle(&tok));
     }
 
-    print(" %s ", demangle(&node->tok));
+    print(" %s ", demangle_node_(ctx, node));
 
-    PASS$(!expression(node->right), return DEGENERATOR_PASS_ERROR; );
+    PASS$(!expression(ctx, node_right(node)), return DEGENERATOR_PASS_ERROR; );
 
     tok = {.type = TYPE_OP};
     tok.val.op = TOK_SEMICOLON;
@@ -440,43 +455,43 @@ static degenerator_err assignment(Node* node)
     return DEGENERATOR_NOERR;
 }
 
-static degenerator_err statement(Node* node)
+static degenerator_err statement(Degenerator_context* ctx, Node* node)
 {
     assert(node);
 
-    if(node->tok.type != TYPE_AUX || node->tok.val.aux != TOK_STATEMENT)
-        format_error("'statement' expected", &node->tok);
+    if(node_type(node) != TYPE_AUX || node_aux(node) != TOK_STATEMENT)
+        format_error("'statement' expected", node);
 
-    if(node->left)
-        PASS$(!statement(node->left), return DEGENERATOR_PASS_ERROR; );
+    if(node_left(node))
+        PASS$(!statement(ctx, node_left(node)), return DEGENERATOR_PASS_ERROR; );
 
-    if(node->right->tok.type == TYPE_KEYWORD)
+    if(node_type(node_right(node)) == TYPE_KEYWORD)
     {
-        if(node->right->tok.val.key == TOK_IF)
+        if(node_key(node_right(node)) == TOK_IF)
         {
-            PASS$(!conditional(node->right), return DEGENERATOR_PASS_ERROR; );
+            PASS$(!conditional(ctx, node_right(node)), return DEGENERATOR_PASS_ERROR; );
             return DEGENERATOR_NOERR;
         }
-        else if(node->right->tok.val.key == TOK_WHILE)
+        else if(node_key(node_right(node)) == TOK_WHILE)
         {
-            PASS$(!cycle(node->right), return DEGENERATOR_PASS_ERROR; );
+            PASS$(!cycle(ctx, node_right(node)), return DEGENERATOR_PASS_ERROR; );
             return DEGENERATOR_NOERR;
         }
-        else if(node->right->tok.val.key == TOK_RETURN)
+        else if(node_key(node_right(node)) == TOK_RETURN)
         {
-            PASS$(!terminational(node->right), return DEGENERATOR_PASS_ERROR; );
+            PASS$(!terminational(ctx, node_right(node)), return DEGENERATOR_PASS_ERROR; );
             return DEGENERATOR_NOERR;
         }
     }
 
-    if(node->right->tok.type == TYPE_OP && node->right->tok.val.op == TOK_ASSIGN)
+    if(node_type(node_right(node)) == TYPE_OP && node_op(node_right(node)) == TOK_ASSIGN)
     {
-        PASS$(!assignment(node->right), return DEGENERATOR_PASS_ERROR; );
+        PASS$(!assignment(ctx, node_right(node)), return DEGENERATOR_PASS_ERROR; );
         return DEGENERATOR_NOERR;
     }
 
     print_tab("");
-    PASS$(!expression(node->right), return DEGENERATOR_PASS_ERROR; );
+    PASS$(!expression(ctx, node_right(node)), return DEGENERATOR_PASS_ERROR; );
 
     Token tok = {.type = TYPE_OP};
     tok.val.op = TOK_SEMICOLON;
@@ -485,68 +500,69 @@ static degenerator_err statement(Node* node)
     return DEGENERATOR_NOERR;
 }
 
-static degenerator_err parameter(Node* node)
+static degenerator_err parameter(Degenerator_context* ctx, Node* node)
 {
     assert(node);
     
-    if(node->tok.type != TYPE_AUX || node->tok.val.aux != TOK_PARAMETER)
-        format_error("'parameter' expected", &node->tok);
+    if(node_type(node) != TYPE_AUX || node_aux(node) != TOK_PARAMETER)
+        format_error("'parameter' expected", node);
 
-    if(node->left)
+    if(node_left(node))
     {
-        PASS$(!parameter(node->left), return DEGENERATOR_PASS_ERROR; );
+        PASS$(!parameter(ctx, node_left(node)), return DEGENERATOR_PASS_ERROR; );
 
         Token tok = {.type = TYPE_OP};
         tok.val.op = TOK_COMMA;
         print("%s ", demangle(&tok));
     }
 
-    if(node->right->tok.type != TYPE_ID)
-        format_error("Parameter is not id", &node->right->tok);
+    if(node_type(node_right(node)) != TYPE_ID)
+        format_error("Parameter is not id", node_right(node));
 
-    if(node->right->right)
-        format_error("Parameter cannot be array", &node->right->tok);
+    if(node_right(node_right(node)))
+        format_error("Parameter cannot be array", node_right(node));
     
-    if(node->right->left)
+    if(node_left(node_right(node)))
     {
-        if(node->right->left->tok.type != TYPE_KEYWORD || node->right->left->tok.val.key != TOK_CONST)
-            format_error("Variable has wrong left descendant ('const' expected)", &node->right->tok);
+        if(node_type(node_left(node_right(node))) != TYPE_KEYWORD ||
+           node_key(node_left(node_right(node))) != TOK_CONST)
+            format_error("Variable has wrong left descendant ('const' expected)", node_right(node));
         
-        print("%s ", demangle(&node->right->left->tok));
+        print("%s ", demangle_node_(ctx, node_left(node_right(node))));
     }
 
-    print("%s", demangle(&node->right->tok));
+    print("%s", demangle_node_(ctx, node_right(node)));
 
     return DEGENERATOR_NOERR;
 }
 
-static degenerator_err function(Node* node)
+static degenerator_err function(Degenerator_context* ctx, Node* node)
 {
     assert(node);
-    assert(node->tok.type == TYPE_AUX && node->tok.val.aux == TOK_DEFINE);
+    assert(node_type(node) == TYPE_AUX && node_aux(node) == TOK_DEFINE);
         
     print("\n\n");
-    print_tab("%s(", demangle(&node->left->left->tok));
+    print_tab("%s(", demangle_node_(ctx, node_left(node_left(node))));
 
-    Node* param = node->left->right;
+    Node* param = node_right(node_left(node));
     if(param)
-        PASS$(!parameter(param), return DEGENERATOR_PASS_ERROR; );
+        PASS$(!parameter(ctx, param), return DEGENERATOR_PASS_ERROR; );
 
     print(")\n");
 
     Token tok = {.type = TYPE_OP};
     tok.val.op = TOK_LFPAR;
     print_tab("%s\n", demangle(&tok));
-    INDENTATION++;
+    ctx->indentation++;
 
-    Node* stmnt = node->right;
+    Node* stmnt = node_right(node);
     if(stmnt)
-        PASS$(!statement(stmnt), return DEGENERATOR_PASS_ERROR; );
+        PASS$(!statement(ctx, stmnt), return DEGENERATOR_PASS_ERROR; );
 
-    if(stmnt->right->tok.type != TYPE_KEYWORD || stmnt->right->tok.val.key != TOK_RETURN)
-        semantic_error("Missing terminational", &node->right->left->left->tok);
+    if(node_type(node_right(stmnt)) != TYPE_KEYWORD || node_key(node_right(stmnt)) != TOK_RETURN)
+        semantic_error("Missing terminational", node_left(node_left(node_right(node))));
 
-    INDENTATION--;
+    ctx->indentation--;
     tok = {.type = TYPE_OP};
     tok.val.op = TOK_RFPAR;
     print_tab("%s\n", demangle(&tok));
@@ -554,30 +570,30 @@ static degenerator_err function(Node* node)
     return DEGENERATOR_NOERR;
 }
 
-static degenerator_err generate_first_line(Node* node)
+static degenerator_err generate_first_line(Degenerator_context* ctx, Node* node)
 {
     assert(node);
     
-    if(node->left)
-        PASS$(!generate_first_line(node->left), return DEGENERATOR_PASS_ERROR; );
+    if(node_left(node))
+        PASS$(!generate_first_line(ctx, node_left(node)), return DEGENERATOR_PASS_ERROR; );
 
-    if(node->tok.type != TYPE_AUX || node->tok.val.aux != TOK_STATEMENT)
-        format_error("'statement' expected (first line)", &node->tok);
+    if(node_type(node) != TYPE_AUX || node_aux(node) != TOK_STATEMENT)
+        format_error("'statement' expected (first line)", node);
 
-    if(!node->right)
-        format_error("Missing 'statement' body (first line)", &node->tok);
+    if(!node_right(node))
+        format_error("Missing 'statement' body (first line)", node);
 
-    if(node->right->tok.type == TYPE_OP && node->right->tok.val.op == TOK_ASSIGN)
+    if(node_type(node_right(node)) == TYPE_OP && node_op(node_right(node)) == TOK_ASSIGN)
     {
-        PASS$(!assignment(node->right), return DEGENERATOR_PASS_ERROR; );
+        PASS$(!assignment(ctx, node_right(node)), return DEGENERATOR_PASS_ERROR; );
     }
-    else if(node->right->tok.type == TYPE_AUX && node->right->tok.val.aux == TOK_DEFINE)
+    else if(node_type(node_right(node)) == TYPE_AUX && node_aux(node_right(node)) == TOK_DEFINE)
     {
-        PASS$(!function(node->right), return DEGENERATOR_PASS_ERROR; );
+        PASS$(!function(ctx, node_right(node)), return DEGENERATOR_PASS_ERROR; );
     }
     else
     {
-        format_error("Assignment or function definition expected (first line)", &node->right->tok);
+        format_error("Assignment or function definition expected (first line)", node_right(node));
     }
 
     return DEGENERATOR_NOERR;
@@ -587,11 +603,10 @@ degenerator_err degenerator(Tree* tree, FILE* ostream)
 {
     assert(ostream && tree);
 
-    OSTREAM = ostream;
-
-    PASS$(!generate_first_line(tree->root), return DEGENERATOR_PASS_ERROR; );
+    Degenerator_context  context = {tree, ostream};
+    Degenerator_context* ctx     = &context;
 
-    OSTREAM = nullptr;
+    PASS$(!generate_first_line(ctx, tree_root(tree)), return DEGENERATOR_PASS_ERROR; );
 
-    return IS_ERROR;
+    return ctx->is_error;
 }
@@ -1,22 +1,11 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/stat.h>
 
 #include "transpiler.h"
 #include "../common/dumpsystem.h"
 #include "../common/jumps.h"
 #include "../common/args.h"
-
-static int get_file_sz_(const char filename[], size_t* sz)
-{
-    struct stat buff = {};
-    if(stat(filename, &buff) == -1)
-        return -1;
-    
-    *sz = (size_t) buff.st_size;
-    
-    return 0;
-}
+#include "../common/input.h"
 
 int main(int argc, char* argv[])
 {
@@ -25,15 +14,12 @@ int main(int argc, char* argv[])
 
     char  infile_name[FILENAME_MAX]  = "";
     char  outfile_name[FILENAME_MAX] = "";
-    char* data = nullptr;
-
-    FILE* istream = nullptr;
     FILE* ostream = nullptr;
 
-    Tree tree = {};
+    Input           input     = {};
+    Tree            tree      = {};
     Token_nametable tok_table = {};
 
-    size_t file_sz = 0;
     args_msg msg = ARGS_NOMSG;
 
     msg = process_args(argc, argv, infile_name, outfile_name);
@@ -45,27 +31,12 @@ int main(int argc, char* argv[])
     }
 
 TRY__
-    ASSERT$(get_file_sz_(infile_name, &file_sz) != -1,
-                                                          TRANSP_INFILE_FAIL,      FAIL__);
-
-    data = (char*) calloc(file_sz + 1, sizeof(char));
-    ASSERT$(data,                                         TRANSP_BAD_ALLOC,        FAIL__);
-
-    istream = fopen(infile_name, "r");
-    ASSERT$(istream,                                      TRANSP_INFILE_FAIL,      FAIL__);
+    ASSERT$(!input_open(&input, infile_name),             TRANSP_INFILE_FAIL,      FAIL__);
 
-    file_sz = fread(data, sizeof(char), file_sz, istream);
-    ASSERT$(!ferror(istream),                             TRANSP_READ_FAIL,        FAIL__);
-
-    fclose(istream);
-    istream = nullptr;
-
-    data = (char*) realloc(data, (file_sz + 1) * sizeof(char));
-    ASSERT$(data,                                         TRANSP_BAD_ALLOC,        FAIL__);
-    data[file_sz] = 0; // null-termination of buffer
-
-    ASSERT$(!tree_read(&tree, &tok_table, data, (ptrdiff_t) file_sz),
+    ASSERT$(!tree_read(&tree, &tok_table, input.data, input.size),
                                                           TRANSP_FORMAT_ERROR,     FAIL__);
+    // Input is closed in FINALLY__, binary tree uses names from it
+
     tree_dump(&tree, "Dump");
     token_nametable_dump(&tok_table);
 
@@ -77,21 +48,14 @@ TRY__
     fclose(ostream);
     ostream = nullptr;
 
-    free(data);
-    data = nullptr;
-
 CATCH__
     ERROR__ = 1;
 
-    if(istream)
-        fclose(istream);
-    
     if(ostream)
         fclose(ostream);
-    
-    free(data);
 
 FINALLY__
+    input_close(&input);
 
     tree_dstr(&tree);
     token_nametable_dstr(&tok_table);
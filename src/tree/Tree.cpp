@@ -21,39 +21,43 @@
             return (ERROR);                     \
     } while(0)                                  \
 
-static tree_err ptr_arr_resize_(Tree* tree)
+static_assert(sizeof(Node) == 16, "Node has to stay compact");
+
+static tree_err nodes_resize_(Tree* tree)
 {
     assert(tree);
-    
-    ptrdiff_t new_cap = tree->ptr_arr_cap;
+
+    ptrdiff_t new_cap = tree->cap * 2;
     if(new_cap == 0)
-        new_cap = TREE_PTR_ARR_MIN_CAP;
+        new_cap = TREE_MIN_CAP;
+
+    ASSERT(new_cap <= INT32_MAX, TREE_BAD_ALLOC);
 
-    Node** temp = (Node**) realloc(tree->ptr_arr, (size_t) new_cap * sizeof(Node*));
+    Node* temp = (Node*) realloc(tree->nodes, (size_t) new_cap * sizeof(Node));
     ASSERT(temp, TREE_BAD_ALLOC);
-    
-    assert(new_cap >= tree->ptr_arr_cap);
-    memset(temp + tree->ptr_arr_cap, 0, (size_t) (new_cap - tree->ptr_arr_cap));
 
-    tree->ptr_arr     = temp;
-    tree->ptr_arr_cap = new_cap;
-    
+    tree->nodes = temp;
+    tree->cap   = new_cap;
+
     return TREE_NOERR;
 }
 
-static tree_err add_chunk_(Tree* tree)
+static tree_err values_resize_(Tree* tree)
 {
     assert(tree);
 
-    if(tree->cap / TREE_CHUNK_SIZE == tree->ptr_arr_cap)
-        PASS(!ptr_arr_resize_(tree), TREE_BAD_ALLOC);
-    
-    Node* temp = (Node*) calloc(TREE_CHUNK_SIZE, sizeof(Node));
+    ptrdiff_t new_cap = tree->values_cap * 2;
+    if(new_cap == 0)
+        new_cap = TREE_MIN_CAP;
+
+    ASSERT(new_cap <= UINT32_MAX, TREE_BAD_ALLOC);
+
+    Token::Value* temp = (Token::Value*) realloc(tree->values, (size_t) new_cap * sizeof(Token::Value));
     ASSERT(temp, TREE_BAD_ALLOC);
 
-    tree->ptr_arr[tree->cap / TREE_CHUNK_SIZE] = temp;
-    tree->cap += TREE_CHUNK_SIZE;
-    
+    tree->values     = temp;
+    tree->values_cap = new_cap;
+
     return TREE_NOERR;
 }
 
@@ -61,83 +65,322 @@ tree_err tree_dstr(Tree* tree)
 {
     assert(tree);
 
-    for(ptrdiff_t iter = 0; iter < tree->cap / TREE_CHUNK_SIZE; iter++)
-        free(tree->ptr_arr[iter]);
-    
-    free(tree->ptr_arr);
-    
+    free(tree->nodes);
+    free(tree->values);
+
     return TREE_NOERR;
 }
 
-tree_err tree_add(Tree* tree, Node** base_ptr, const Token* data)
+tree_err tree_add(Tree* tree, ptrdiff_t* index, const Token* data)
 {
-    assert(tree && base_ptr && data);
-
-    if(tree->cap == tree->size)
-        PASS(!add_chunk_(tree), TREE_BAD_ALLOC);
-
-    Node* new_node = &tree->ptr_arr[tree->size / TREE_CHUNK_SIZE][tree->size % TREE_CHUNK_SIZE];
-    *new_node  = {*data, nullptr, nullptr};
-    *base_ptr  = new_node;
+    assert(tree && index && data);
+    ASSERT(data->type > TYPE_NOTYPE && data->type < TYPE_DIRECTIVE_BEGIN, TREE_FORMAT_ERROR);
+
+    // Slot 0 stands for absent node
+    if(tree->size == 0)
+        tree->size = 1;
+
+    if(tree->cap <= tree->size)
+        PASS(!nodes_resize_(tree), TREE_BAD_ALLOC);
+
+    Node node = {};
+    node.type = (uint8_t) data->type;
+
+    switch(data->type)
+    {
+        case TYPE_OP:      node.value = (uint32_t) data->val.op;  break;
+        case TYPE_KEYWORD: node.value = (uint32_t) data->val.key; break;
+        case TYPE_EMBED:   node.value = (uint32_t) data->val.emb; break;
+        case TYPE_AUX:     node.value = (uint32_t) data->val.aux; break;
+        case TYPE_NUMBER: case TYPE_ID:
+        {
+            if(tree->values_cap == tree->values_sz)
+                PASS(!values_resize_(tree), TREE_BAD_ALLOC);
+
+            node.value = (uint32_t) tree->values_sz;
+            tree->values[tree->values_sz] = data->val;
+            tree->values_sz++;
+            break;
+        }
+        case TYPE_EOF: case TYPE_NOTYPE: case TYPE_DIRECTIVE_BEGIN: case TYPE_DIRECTIVE_END:
+        default:
+            assert(0 && "Type is checked");
+    }
+
+    tree->nodes[tree->size] = node;
+    *index = tree->size;
 
     tree->size++;
 
     return TREE_NOERR;
 }
 
-static tree_err tree_copy_(Tree* tree, Node** ptr, Node* orig)
+tree_err tree_merge(Tree* tree, Tree* part, ptrdiff_t* part_root)
 {
-    assert(tree && ptr && orig);
+    assert(tree && part && part_root);
+
+    *part_root = 0;
+
+    if(part->size)
+    {
+        if(tree->size == 0)
+            tree->size = 1;
+
+        while(tree->cap < tree->size + part->size - 1)
+            PASS(!nodes_resize_(tree), TREE_BAD_ALLOC);
+
+        while(tree->values_cap < tree->values_sz + part->values_sz)
+            PASS(!values_resize_(tree), TREE_BAD_ALLOC);
+
+        // Descendants are relative, so only indices of values are shifted
+        Node* moved = tree->nodes + tree->size;
+        memcpy(moved, part->nodes + 1, (size_t) (part->size - 1) * sizeof(Node));
+
+        for(ptrdiff_t iter = 0; iter < part->size - 1; iter++)
+        {
+            if(moved[iter].type == TYPE_NUMBER || moved[iter].type == TYPE_ID)
+                moved[iter].value += (uint32_t) tree->values_sz;
+        }
+
+        if(part->values_sz)
+            memcpy(tree->values + tree->values_sz, part->values, (size_t) part->values_sz * sizeof(Token::Value));
 
-    PASS(!tree_add(tree, ptr, &orig->tok), TREE_BAD_ALLOC);
+        if(part->root)
+            *part_root = part->root + tree->size - 1;
 
-    if(orig->left)
-        PASS(!tree_copy_(tree, &(*ptr)->left, orig->left), TREE_BAD_ALLOC);
+        tree->size      += part->size - 1;
+        tree->values_sz += part->values_sz;
+    }
+
+    tree_dstr(part);
+    *part = {};
 
-    if(orig->right)
-        PASS(!tree_copy_(tree, &(*ptr)->right, orig->right), TREE_BAD_ALLOC);
-    
     return TREE_NOERR;
 }
 
-tree_err tree_copy(Tree* tree, Node** base_ptr, Node* origin)
+// Grows array of elements of 'elem_sz' bytes twice
+static tree_err stack_resize_(void** stack, ptrdiff_t* cap, size_t elem_sz)
 {
-    assert(tree && base_ptr && origin);
+    assert(stack && cap);
+
+    ptrdiff_t new_cap = *cap * 2;
+    if(new_cap == 0)
+        new_cap = TREE_MIN_CAP;
+
+    void* temp = realloc(*stack, (size_t) new_cap * elem_sz);
+    PASS(temp, TREE_BAD_ALLOC);
+
+    *stack = temp;
+    *cap   = new_cap;
 
-    PASS(!tree_copy_(tree, base_ptr, origin), TREE_BAD_ALLOC);
-    
     return TREE_NOERR;
 }
 
-static void (*VISITOR_FUNCTION_)(Node*, size_t depth) = nullptr;
-static size_t VISITOR_DEPTH_ = (size_t) -1;
+struct Copy_frame_
+{
+    ptrdiff_t origin;
+    ptrdiff_t parent;       // copy to link to, 0 for root of copy
+    bool      is_right;
+};
 
-static void tree_visitor_(Node* node)
+tree_err tree_copy(Tree* tree, ptrdiff_t* index, ptrdiff_t origin)
 {
-    assert(node);
+    assert(tree && index && origin);
+
+    Copy_frame_* stack = nullptr;
+    ptrdiff_t    size  = 0;
+    ptrdiff_t    cap   = 0;
+
+    tree_err err = stack_resize_((void**) &stack, &cap, sizeof(Copy_frame_));
+    if(!err)
+        stack[size++] = {origin, 0, false};
+
+    // Right descendant is pushed first, so nodes are added in the same order as recursive copy did
+    while(!err && size)
+    {
+        Copy_frame_ frame = stack[--size];
 
-    VISITOR_DEPTH_++;    
+        Token     tok  = node_token(tree, tree_node(tree, frame.origin));
+        ptrdiff_t copy = 0;
+        if((err = tree_add(tree, &copy, &tok)))
+            break;
 
-    if(node->left)
-        tree_visitor_(node->left);
+        if(!frame.parent)
+            *index = copy;
+        else if(frame.is_right)
+            node_set_right(tree_node(tree, frame.parent), tree_node(tree, copy));
+        else
+            node_set_left (tree_node(tree, frame.parent), tree_node(tree, copy));
 
-    VISITOR_FUNCTION_(node, VISITOR_DEPTH_);
-    
-    if(node->right)
-        tree_visitor_(node->right);
+        ptrdiff_t left  = tree_index(tree, node_left (tree_node(tree, frame.origin)));
+        ptrdiff_t right = tree_index(tree, node_right(tree_node(tree, frame.origin)));
 
-    VISITOR_DEPTH_--;
+        if(cap - size < 2 && (err = stack_resize_((void**) &stack, &cap, sizeof(Copy_frame_))))
+            break;
+
+        if(right)
+            stack[size++] = {right, copy, true};
+        if(left)
+            stack[size++] = {left,  copy, false};
+    }
+
+    free(stack);
+
+    return err;
 }
 
-tree_err tree_visitor(Tree* tree, void (*function)(Node* node, size_t depth))
+struct Tree_iterator_frame
 {
-    assert(tree && function);
-    assert(tree->root);
+    ptrdiff_t index;
+    size_t    depth;
+    int       n_passed;     // descendants already stepped into
+};
 
-    VISITOR_FUNCTION_ = function;
-    VISITOR_DEPTH_    = (size_t) -1;
+static tree_err iterator_push_(Tree_iterator* iter, const Node* node, size_t depth)
+{
+    assert(iter);
 
-    tree_visitor_(tree->root);
+    if(!node)
+        return TREE_NOERR;
+
+    if(iter->size == iter->cap)
+        PASS(!stack_resize_((void**) &iter->stack, &iter->cap, sizeof(Tree_iterator_frame)), TREE_BAD_ALLOC);
+
+    iter->stack[iter->size++] = {tree_index(iter->tree, node), depth, 0};
 
     return TREE_NOERR;
 }
+
+tree_err tree_iterator_init(Tree_iterator* iter, const Tree* tree, Node* start, tree_order order)
+{
+    assert(iter && tree);
+
+    *iter = {};
+    iter->tree  = tree;
+    iter->order = order;
+
+    return iterator_push_(iter, start, 0);
+}
+
+tree_err tree_iterator_next(Tree_iterator* iter, Node** node, size_t* depth)
+{
+    assert(iter && node);
+
+    *node = nullptr;
+
+    while(iter->size)
+    {
+        // Frame is copied, since pushing may move stack
+        Tree_iterator_frame* top   = &iter->stack[iter->size - 1];
+        Tree_iterator_frame  frame = *top;
+        Node*                cur   = tree_node(iter->tree, frame.index);
+
+        if(frame.n_passed == 2)
+            iter->size--;
+        else
+            top->n_passed++;
+
+        switch(frame.n_passed)
+        {
+            case 0:
+                PASS(!iterator_push_(iter, node_left(cur), frame.depth + 1), TREE_BAD_ALLOC);
+                if(iter->order != TREE_PREORDER)
+                    continue;
+                break;
+            case 1:
+                PASS(!iterator_push_(iter, node_right(cur), frame.depth + 1), TREE_BAD_ALLOC);
+                if(iter->order != TREE_INORDER)
+                    continue;
+                break;
+            default:
+                if(iter->order != TREE_POSTORDER)
+                    continue;
+                break;
+        }
+
+        *node = cur;
+        if(depth)
+            *depth = frame.depth;
+
+        break;
+    }
+
+    return TREE_NOERR;
+}
+
+void tree_iterator_dstr(Tree_iterator* iter)
+{
+    assert(iter);
+
+    free(iter->stack);
+    *iter = {};
+}
+
+tree_err tree_visitor(Tree* tree, Tree_visitor_function function, void* context, tree_order order)
+{
+    assert(tree && function);
+
+    Tree_iterator iter = {};
+    tree_err      err  = tree_iterator_init(&iter, tree, tree_root(tree), order);
+
+    Node*  node  = nullptr;
+    size_t depth = 0;
+
+    while(!err && !(err = tree_iterator_next(&iter, &node, &depth)) && node)
+        function(tree, node, depth, context);
+
+    tree_iterator_dstr(&iter);
+
+    return err;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Token node_token(const Tree* tree, const Node* node)
+{
+    assert(tree && node);
+
+    Token tok = {};
+    tok.type  = node_type(node);
+
+    switch(tok.type)
+    {
+        case TYPE_OP:      tok.val.op  = node_op(node);     break;
+        case TYPE_KEYWORD: tok.val.key = node_key(node);    break;
+        case TYPE_EMBED:   tok.val.emb = node_emb(node);    break;
+        case TYPE_AUX:     tok.val.aux = node_aux(node);    break;
+        case TYPE_NUMBER: case TYPE_ID:
+            tok.val = tree->values[node->value];
+            break;
+        case TYPE_EOF: case TYPE_NOTYPE: case TYPE_DIRECTIVE_BEGIN: case TYPE_DIRECTIVE_END:
+        default:
+            assert(0 && "Token can't be node");
+    }
+
+    return tok;
+}
+
+void node_set_number(Tree* tree, Node* node, const Node* donor, double num)
+{
+    assert(tree && node && donor);
+    assert(donor->type == TYPE_NUMBER || donor->type == TYPE_ID);
+
+    uint32_t slot = donor->value;
+    tree->values[slot].num = num;
+
+    *node = {};
+    node->type  = TYPE_NUMBER;
+    node->value = slot;
+}
+
+void node_replace(Node* node, const Node* origin)
+{
+    assert(node && origin);
+
+    Node* left  = node_left(origin);
+    Node* right = node_right(origin);
+
+    *node = *origin;
+    node_set_left(node, left);
+    node_set_right(node, right);
+}
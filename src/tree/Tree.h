@@ -7,26 +7,31 @@
 
 #include "../token/Token.h"
 
-const ptrdiff_t TREE_PTR_ARR_MIN_CAP = 8;
-const ptrdiff_t TREE_CHUNK_SIZE      = 512;
+const ptrdiff_t TREE_MIN_CAP = 64;
 
+// Nodes are kept in one pool of tree. Descendants are indices relative to node itself (0 if there is
+// no descendant), so links stay valid when pool is moved, merged or written out.
+// Numbers and names are kept in pool of values, 'value' is index there
 struct Node
 {
-    Token tok = {};
+    uint8_t  type  = TYPE_NOTYPE;   // token_type
+    uint32_t value = 0;             // operator, keyword, embedded, auxiliary or index of value
 
-    Node* left  = 0;
-    Node* right = 0;
+    int32_t  left  = 0;
+    int32_t  right = 0;
 };
 
 struct Tree
 {
-    Node**    ptr_arr     = nullptr;
-    ptrdiff_t ptr_arr_cap = 0;
+    Node*         nodes      = nullptr;  // nodes[0] is unused, so that index 0 means no node
+    ptrdiff_t     size       = 0;
+    ptrdiff_t     cap        = 0;
 
-    ptrdiff_t size = 0;
-    ptrdiff_t cap  = 0;
+    Token::Value* values     = nullptr;
+    ptrdiff_t     values_sz  = 0;
+    ptrdiff_t     values_cap = 0;
 
-    Node*     root = nullptr;
+    ptrdiff_t     root       = 0;
 };
 
 enum tree_err
@@ -39,15 +44,150 @@ enum tree_err
 
 tree_err tree_dstr(Tree* tree);
 
-tree_err tree_add(Tree* tree, Node** base_ptr, const Token* data);
-tree_err tree_copy(Tree* tree, Node** base_ptr, Node* origin);
+// Adds node without descendants, its index is written to 'index'. Pool of nodes may be moved,
+// so nodes are addressed by indices while tree grows
+tree_err tree_add(Tree* tree, ptrdiff_t* index, const Token* data);
+// Copies subtree of 'origin' to the end of pool in pre-order, index of copy is written to 'index'
+tree_err tree_copy(Tree* tree, ptrdiff_t* index, ptrdiff_t origin);
 
-tree_err tree_visitor(Tree* tree, void (*function)(Node* node, size_t depth));
+// Appends nodes of 'part' to 'tree', 'part' becomes empty. Roots aren't linked, index of root of 'part'
+// in 'tree' is written to 'part_root'
+tree_err tree_merge(Tree* tree, Tree* part, ptrdiff_t* part_root);
+
+enum tree_order
+{
+    TREE_PREORDER  = 0,
+    TREE_INORDER   = 1,
+    TREE_POSTORDER = 2,
+};
+
+struct Tree_iterator_frame;
+
+// Traversal keeps its path on heap instead of native stack, so depth of tree is limited only by memory.
+// All state is in iterator, any number of traversals may run at once. Tree mustn't grow meanwhile
+struct Tree_iterator
+{
+    const Tree*          tree  = nullptr;
+    tree_order           order = TREE_INORDER;
+
+    Tree_iterator_frame* stack = nullptr;
+    ptrdiff_t            size  = 0;
+    ptrdiff_t            cap   = 0;
+};
+
+// Traverses subtree of 'start' (may be nullptr)
+tree_err tree_iterator_init(Tree_iterator* iter, const Tree* tree, Node* start, tree_order order);
+// Writes next node and its depth relative to 'start', node is nullptr when traversal is over
+tree_err tree_iterator_next(Tree_iterator* iter, Node** node, size_t* depth = nullptr);
+void     tree_iterator_dstr(Tree_iterator* iter);
+
+// Context is passed to every call of function, tree_visitor keeps no state of its own
+typedef void (*Tree_visitor_function)(const Tree* tree, Node* node, size_t depth, void* context);
+tree_err tree_visitor(Tree* tree, Tree_visitor_function function, void* context = nullptr,
+                      tree_order order = TREE_INORDER);
+
+enum tree_fold_mode
+{
+    TREE_FOLD_REAL    = 0, // double arithmetic of Processor
+    TREE_FOLD_INTEGER = 1, // integer arithmetic with 32-bit immediates of x86-64
+};
+
+// Folds constant subexpressions and 'const' globals, applies identities (x+0, x*1, x*0)
+tree_err tree_fold(Tree* tree, tree_fold_mode mode);
 
 tree_err tree_read(Tree* tree, Token_nametable* tok_table, const char data[], ptrdiff_t data_sz);
 void     tree_write(Tree* tree, FILE* ostream);
 
+// Binary format (.treeb): nodes in pre-order with indices of descendants and table of names.
+// tree_read recognizes it by magic number. Names of nodes point into 'data', it has to outlive tree
+bool     tree_is_binary(const char data[], ptrdiff_t data_sz);
+tree_err tree_read_binary(Tree* tree, const char data[], ptrdiff_t data_sz);
+tree_err tree_write_binary(Tree* tree, FILE* ostream);
+
 void     tree_dump_init(FILE* dumpstream = nullptr);
 void     tree_dump(Tree* tree, const char msg[], tree_err errcode = TREE_NOERR);
 
+///////////////////////////////////////////////////////////////////////////////
+// Access to nodes. Pointers to nodes are valid until next node is added
+
+inline Node* tree_node(const Tree* tree, ptrdiff_t index)
+{
+    return index ? tree->nodes + index : nullptr;
+}
+
+inline Node* tree_root(const Tree* tree)
+{
+    return tree_node(tree, tree->root);
+}
+
+inline ptrdiff_t tree_index(const Tree* tree, const Node* node)
+{
+    return node ? node - tree->nodes : 0;
+}
+
+inline Node* node_left(const Node* node)
+{
+    return node->left ? const_cast<Node*>(node) + node->left : nullptr;
+}
+
+inline Node* node_right(const Node* node)
+{
+    return node->right ? const_cast<Node*>(node) + node->right : nullptr;
+}
+
+// Descendant has to be in the same pool, nullptr unlinks descendant
+inline void node_set_left(Node* node, const Node* left)
+{
+    node->left = left ? (int32_t) (left - node) : 0;
+}
+
+inline void node_set_right(Node* node, const Node* right)
+{
+    node->right = right ? (int32_t) (right - node) : 0;
+}
+
+inline token_type node_type(const Node* node)
+{
+    return (token_type) node->type;
+}
+
+inline token_operators node_op(const Node* node)
+{
+    return (token_operators) node->value;
+}
+
+inline token_keywords node_key(const Node* node)
+{
+    return (token_keywords) node->value;
+}
+
+inline token_embedded node_emb(const Node* node)
+{
+    return (token_embedded) node->value;
+}
+
+inline token_auxiliary node_aux(const Node* node)
+{
+    return (token_auxiliary) node->value;
+}
+
+inline double node_num(const Tree* tree, const Node* node)
+{
+    return tree->values[node->value].num;
+}
+
+inline char* node_name(const Tree* tree, const Node* node)
+{
+    return tree->values[node->value].name;
+}
+
+// Token of node, as lexer produced it
+Token node_token(const Tree* tree, const Node* node);
+
+// Turns node into number without descendants, value takes slot of 'donor' (number or name)
+void  node_set_number(Tree* tree, Node* node, const Node* donor, double num);
+
+// Node takes place of 'origin' with its descendants
+void  node_replace(Node* node, const Node* origin);
+
 #endif // TREE_H
\ No newline at end of file
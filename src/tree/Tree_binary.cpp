@@ -0,0 +1,391 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include "Tree.h"
+#include "../common/dumpsystem.h"
+
+// Layout of .treeb: header, nodes in pre-order (root is node 0), table of null-terminated names.
+// Numbers are stored in byte order of host
+static const char MAGIC_[8] = {'B', 'L', 'R', 'T', 'R', 'E', 'E', '\x01'};
+
+static const uint32_t NIL_ = UINT32_MAX;
+
+struct Binary_header_
+{
+    char     magic[8];
+    uint32_t n_nodes;
+    uint32_t strings_sz;
+};
+
+struct Binary_node_
+{
+    uint32_t type;      // token_type
+    uint32_t left;      // index of descendant, NIL_ if there is none
+    uint32_t right;
+    uint32_t value;     // operator, keyword, embedded, auxiliary or offset of name in table of names
+    double   num;
+};
+
+static_assert(sizeof(Binary_header_) % alignof(Binary_node_) == 0, "Nodes have to be aligned in file");
+
+#define DEF_OP(NAME, STD_NAME, MANGLE) + 1
+static const uint32_t N_OPERATORS_ = 0
+    #include "../reserved_operators.inc"
+    ;
+#undef DEF_OP
+
+#define DEF_KEY(NAME, STD_NAME, MANGLE) + 1
+static const uint32_t N_KEYWORDS_ = 0
+    #include "../reserved_keywords.inc"
+    ;
+#undef DEF_KEY
+
+#define DEF_EMB(NAME, STD_NAME, MANGLE) + 1
+static const uint32_t N_EMBEDDED_ = 0
+    #include "../reserved_embedded.inc"
+    ;
+#undef DEF_EMB
+
+#define DEF_AUX(NAME, MANGLE) + 1
+static const uint32_t N_AUXILIARY_ = 0
+    #include "../reserved_auxiliary.inc"
+    ;
+#undef DEF_AUX
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct Binary_writer_
+{
+    Binary_node_* nodes      = nullptr;
+    uint32_t      n_nodes    = 0;
+    uint32_t      nodes_cap  = 0;
+
+    char*         strings     = nullptr;
+    uint32_t      strings_sz  = 0;
+    uint32_t      strings_cap = 0;
+
+    uint32_t*     slots     = nullptr;  // offset of name plus one, 0 if slot is empty
+    uint32_t      slots_cap = 0;
+    uint32_t      n_names   = 0;
+};
+
+static uint64_t name_hash_(const char name[])
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for(; *name; name++)
+    {
+        hash ^= (unsigned char) *name;
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+static tree_err grow_(void** buffer, uint32_t* cap, size_t elem_sz, uint32_t min_cap)
+{
+    uint32_t new_cap = *cap ? *cap * 2 : min_cap;
+    ASSERT_RET$(new_cap > *cap, TREE_BAD_ALLOC);
+
+    void* temp = realloc(*buffer, (size_t) new_cap * elem_sz);
+    ASSERT_RET$(temp, TREE_BAD_ALLOC);
+
+    *buffer = temp;
+    *cap    = new_cap;
+
+    return TREE_NOERR;
+}
+
+// Table of names is rehashed at load 1/2, slots keep offsets in table
+static tree_err slots_rehash_(Binary_writer_* writer)
+{
+    uint32_t  new_cap = writer->slots_cap ? writer->slots_cap * 2 : 64;
+    uint32_t* temp    = (uint32_t*) calloc(new_cap, sizeof(uint32_t));
+    ASSERT_RET$(temp, TREE_BAD_ALLOC);
+
+    for(uint32_t iter = 0; iter < writer->slots_cap; iter++)
+    {
+        uint32_t offset = writer->slots[iter];
+        if(!offset)
+            continue;
+
+        uint32_t pos = (uint32_t) name_hash_(writer->strings + offset - 1) & (new_cap - 1);
+        while(temp[pos])
+            pos = (pos + 1) & (new_cap - 1);
+
+        temp[pos] = offset;
+    }
+
+    free(writer->slots);
+    writer->slots     = temp;
+    writer->slots_cap = new_cap;
+
+    return TREE_NOERR;
+}
+
+// Each name is stored once
+static tree_err intern_(Binary_writer_* writer, const char name[], uint32_t* offset)
+{
+    if((writer->n_names + 1) * 2 > writer->slots_cap)
+        PASS$(!slots_rehash_(writer), return TREE_BAD_ALLOC; );
+
+    uint32_t mask = writer->slots_cap - 1;
+    uint32_t pos  = (uint32_t) name_hash_(name) & mask;
+
+    for(; writer->slots[pos]; pos = (pos + 1) & mask)
+    {
+        if(strcmp(writer->strings + writer->slots[pos] - 1, name) == 0)
+        {
+            *offset = writer->slots[pos] - 1;
+            return TREE_NOERR;
+        }
+    }
+
+    size_t name_sz = strlen(name) + 1;
+    ASSERT_RET$(name_sz < NIL_ - writer->strings_sz, TREE_BAD_ALLOC);
+
+    while(writer->strings_sz + name_sz > writer->strings_cap)
+        PASS$(!grow_((void**) &writer->strings, &writer->strings_cap, sizeof(char), 1024), return TREE_BAD_ALLOC; );
+
+    memcpy(writer->strings + writer->strings_sz, name, name_sz);
+
+    *offset = writer->strings_sz;
+    writer->slots[pos] = writer->strings_sz + 1;
+    writer->strings_sz += (uint32_t) name_sz;
+    writer->n_names++;
+
+    return TREE_NOERR;
+}
+
+struct Write_frame_
+{
+    const Node* node;
+    uint32_t    parent;     // record to link to, NIL_ for root
+    bool        is_right;
+};
+
+static tree_err write_record_(Binary_writer_* writer, const Tree* tree, const Node* node, uint32_t* index)
+{
+    assert(writer && tree && node && index);
+
+    if(writer->n_nodes == writer->nodes_cap)
+        PASS$(!grow_((void**) &writer->nodes, &writer->nodes_cap, sizeof(Binary_node_), 256), return TREE_BAD_ALLOC; );
+
+    Binary_node_ record = {(uint32_t) node_type(node), NIL_, NIL_, 0, 0};
+
+    switch(node_type(node))
+    {
+        case TYPE_OP: case TYPE_KEYWORD: case TYPE_EMBED: case TYPE_AUX:
+            record.value = node->value;
+            break;
+        case TYPE_NUMBER:  record.num = node_num(tree, node); break;
+        case TYPE_ID:
+        {
+            PASS$(!intern_(writer, node_name(tree, node), &record.value), return TREE_BAD_ALLOC; );
+            break;
+        }
+        case TYPE_EOF: case TYPE_NOTYPE: case TYPE_DIRECTIVE_BEGIN: case TYPE_DIRECTIVE_END:
+        default:
+            ASSERT_RET$(0, TREE_FORMAT_ERROR);
+    }
+
+    *index = writer->n_nodes;
+    writer->nodes[writer->n_nodes++] = record;
+
+    return TREE_NOERR;
+}
+
+// Right descendant is pushed first, so records are written in pre-order
+static tree_err write_nodes_(Binary_writer_* writer, const Tree* tree, const Node* root)
+{
+    assert(writer && tree && root);
+
+    Write_frame_* stack = nullptr;
+    uint32_t      size  = 0;
+    uint32_t      cap   = 0;
+
+    tree_err err = grow_((void**) &stack, &cap, sizeof(Write_frame_), 64);
+    if(!err)
+        stack[size++] = {root, NIL_, false};
+
+    while(!err && size)
+    {
+        Write_frame_ frame = stack[--size];
+
+        // Array of records may move, so parent is addressed by index
+        uint32_t cur = NIL_;
+        if((err = write_record_(writer, tree, frame.node, &cur)))
+            break;
+
+        if(frame.parent != NIL_ && frame.is_right)
+            writer->nodes[frame.parent].right = cur;
+        else if(frame.parent != NIL_)
+            writer->nodes[frame.parent].left  = cur;
+
+        if(cap - size < 2 && (err = grow_((void**) &stack, &cap, sizeof(Write_frame_), 64)))
+            break;
+
+        if(node_right(frame.node))
+            stack[size++] = {node_right(frame.node), cur, true};
+        if(node_left(frame.node))
+            stack[size++] = {node_left(frame.node),  cur, false};
+    }
+
+    free(stack);
+
+    return err;
+}
+
+tree_err tree_write_binary(Tree* tree, FILE* ostream)
+{
+    assert(tree && ostream);
+
+    Binary_writer_ writer = {};
+    tree_err err = TREE_NOERR;
+
+    if(tree->root)
+        err = write_nodes_(&writer, tree, tree_root(tree));
+
+    if(!err)
+    {
+        Binary_header_ header = {};
+        memcpy(header.magic, MAGIC_, sizeof(MAGIC_));
+        header.n_nodes    = writer.n_nodes;
+        header.strings_sz = writer.strings_sz;
+
+        fwrite(&header, sizeof(header), 1, ostream);
+        fwrite(writer.nodes,   sizeof(Binary_node_), writer.n_nodes, ostream);
+        fwrite(writer.strings, sizeof(char), writer.strings_sz, ostream);
+    }
+
+    free(writer.nodes);
+    free(writer.strings);
+    free(writer.slots);
+
+    return err;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool tree_is_binary(const char data[], ptrdiff_t data_sz)
+{
+    assert(data);
+
+    return data_sz >= (ptrdiff_t) sizeof(MAGIC_) && memcmp(data, MAGIC_, sizeof(MAGIC_)) == 0;
+}
+
+static bool is_valid_value_(const Binary_node_* record, uint32_t strings_sz)
+{
+    switch(record->type)
+    {
+        case TYPE_OP:      return record->value < N_OPERATORS_;
+        case TYPE_KEYWORD: return record->value < N_KEYWORDS_;
+        case TYPE_EMBED:   return record->value < N_EMBEDDED_;
+        case TYPE_AUX:     return record->value < N_AUXILIARY_;
+        case TYPE_NUMBER:  return !record->value;
+        case TYPE_ID:      return record->value < strings_sz;
+        default:           return false;
+    }
+}
+
+// Every node except root is descendant of exactly one node with lower index, so nodes form a tree
+static bool is_valid_links_(const Binary_node_ nodes[], uint32_t n_nodes, uint32_t strings_sz)
+{
+    bool* is_linked = (bool*) calloc(n_nodes, sizeof(bool));
+    ASSERT$(is_linked, TREE_BAD_ALLOC, return false; );
+
+    bool is_valid = true;
+
+    for(uint32_t iter = 0; iter < n_nodes && is_valid; iter++)
+    {
+        is_valid = is_valid_value_(&nodes[iter], strings_sz);
+
+        uint32_t children[] = {nodes[iter].left, nodes[iter].right};
+        for(uint32_t child : children)
+        {
+            if(child == NIL_)
+                continue;
+
+            if(child <= iter || child >= n_nodes || is_linked[child])
+                is_valid = false;
+            else
+                is_linked[child] = true;
+        }
+    }
+
+    for(uint32_t iter = 1; iter < n_nodes && is_valid; iter++)
+        is_valid = is_linked[iter];
+
+    free(is_linked);
+
+    return is_valid;
+}
+
+// Tree must be empty, so that node 'index' is added right after unused node 0 of pool
+static inline Node* node_at_(Tree* tree, uint32_t index)
+{
+    return tree_node(tree, (ptrdiff_t) index + 1);
+}
+
+tree_err tree_read_binary(Tree* tree, const char data[], ptrdiff_t data_sz)
+{
+    assert(tree && data);
+    assert(tree->size == 0 && !tree->root);
+
+    ASSERT_RET$(tree_is_binary(data, data_sz) && data_sz >= (ptrdiff_t) sizeof(Binary_header_), TREE_FORMAT_ERROR);
+    ASSERT_RET$((uintptr_t) data % alignof(Binary_node_) == 0, TREE_READ_FAIL);
+
+    const Binary_header_* header  = (const Binary_header_*) data;
+    const Binary_node_*   nodes   = (const Binary_node_*) (data + sizeof(Binary_header_));
+    const char*           strings = data + sizeof(Binary_header_) + (size_t) header->n_nodes * sizeof(Binary_node_);
+
+    ASSERT_RET$(data_sz == (ptrdiff_t) (sizeof(Binary_header_) + (size_t) header->n_nodes * sizeof(Binary_node_) +
+                                        header->strings_sz), TREE_FORMAT_ERROR);
+    ASSERT_RET$(!header->strings_sz || strings[header->strings_sz - 1] == '\0', TREE_FORMAT_ERROR);
+    ASSERT_RET$(is_valid_links_(nodes, header->n_nodes, header->strings_sz), TREE_FORMAT_ERROR);
+
+    for(uint32_t iter = 0; iter < header->n_nodes; iter++)
+    {
+        Token tok = {};
+        tok.type  = (token_type) nodes[iter].type;
+
+        switch(tok.type)
+        {
+            case TYPE_OP:      tok.val.op  = (token_operators) nodes[iter].value; break;
+            case TYPE_KEYWORD: tok.val.key = (token_keywords)  nodes[iter].value; break;
+            case TYPE_EMBED:   tok.val.emb = (token_embedded)  nodes[iter].value; break;
+            case TYPE_AUX:     tok.val.aux = (token_auxiliary) nodes[iter].value; break;
+            case TYPE_NUMBER:  tok.val.num = nodes[iter].num;                     break;
+
+            // Names are used in place, nothing writes to them
+            case TYPE_ID:      tok.val.name = const_cast<char*>(strings + nodes[iter].value); break;
+
+            case TYPE_EOF: case TYPE_NOTYPE: case TYPE_DIRECTIVE_BEGIN: case TYPE_DIRECTIVE_END:
+            default:
+                assert(0 && "Node type is validated");
+        }
+
+        ptrdiff_t temp = 0;
+        PASS$(!tree_add(tree, &temp, &tok), return TREE_BAD_ALLOC; );
+    }
+
+    for(uint32_t iter = 0; iter < header->n_nodes; iter++)
+    {
+        Node* node = node_at_(tree, iter);
+
+        if(nodes[iter].left != NIL_)
+            node_set_left (node, node_at_(tree, nodes[iter].left));
+
+        if(nodes[iter].right != NIL_)
+            node_set_right(node, node_at_(tree, nodes[iter].right));
+    }
+
+    if(header->n_nodes)
+        tree->root = tree_index(tree, node_at_(tree, 0));
+
+    tree_dump(tree, "Dump");
+
+    return TREE_NOERR;
+}
@@ -22,8 +22,6 @@ static const char TREE_DUMPFILE[] = "logs/tree_dump.html";
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-static FILE* TEMP_GRAPH_STREAM = nullptr;
-
 static const char GRAPHVIZ_PNG_NAME[]  = "graphviz_dump";
 static const char GRAPHVIZ_TEMP_FILE[] = "graphviz_temp.txt";
 
@@ -64,13 +62,14 @@ static char* graphviz_png_()
     return filename;
 }
 
-static void tree_print_node_(Node* node, size_t)
+static void tree_print_node_(const Tree* tree, Node* node, size_t, void* context)
 {
-    FILE* stream = TEMP_GRAPH_STREAM;
+    FILE* stream = (FILE*) context;
 
-    PRINT("node%p[label = \"%s\", ", node, std_demangle(&node->tok));
+    Token tok = node_token(tree, node);
+    PRINT("node%p[label = \"%s\", ", node, std_demangle(&tok));
 
-    switch(node->tok.type)
+    switch(tok.type)
     {
         case TYPE_OP:
             PRINT("shape = diamond, color = red]");
@@ -99,10 +98,10 @@ static void tree_print_node_(Node* node, size_t)
     }
     PRINT("\n");
     
-    if(node->left  != nullptr)
-        PRINT("node%p -> node%p [color = green];\n", node, node->left);
-    if(node->right != nullptr)
-        PRINT("node%p -> node%p [color = orange];\n", node, node->right);
+    if(node_left(node)  != nullptr)
+        PRINT("node%p -> node%p [color = green];\n", node, node_left(node));
+    if(node_right(node) != nullptr)
+        PRINT("node%p -> node%p [color = orange];\n", node, node_right(node));
 }
 
 static void tree_graph_dump_(Tree* tree, const char* graphviz_png_name)
@@ -116,11 +115,9 @@ static void tree_graph_dump_(Tree* tree, const char* graphviz_png_name)
         perror(__FILE__": can't open temporary dump file");
         return;
     }
-    TEMP_GRAPH_STREAM = stream;
-
     PRINT("%s", GRAPHVIZ_INTRO);
 
-    tree_visitor(tree, &tree_print_node_);
+    tree_visitor(tree, &tree_print_node_, stream);
 
     PRINT("%s", GRAPHVIZ_OUTRO);
 
@@ -0,0 +1,365 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <math.h>
+
+#include "Tree.h"
+
+struct Fold_const_
+{
+    const char* name;
+    double      value;
+};
+
+// Mode and collected constants of one tree_fold() call
+struct Fold_context
+{
+    Tree*          tree = nullptr;
+    tree_fold_mode mode = TREE_FOLD_REAL;
+
+    Fold_const_* consts     = nullptr;
+    ptrdiff_t    consts_sz  = 0;
+    ptrdiff_t    consts_cap = 0;
+};
+
+// Exact comparison without -Wfloat-equal
+static bool is_equal_(double lhs, double rhs)
+{
+    return lhs <= rhs && lhs >= rhs;
+}
+
+static bool is_number_(const Fold_context* ctx, const Node* node, double* value = nullptr)
+{
+    if(!node || node_type(node) != TYPE_NUMBER || node_left(node) || node_right(node))
+        return false;
+
+    if(value)
+        *value = node_num(ctx->tree, node);
+
+    return true;
+}
+
+static bool is_pure_(const Fold_context* ctx, const Node* node)
+{
+    if(!node)
+        return true;
+
+    if(node_type(node) == TYPE_EMBED || (node_type(node) == TYPE_AUX && node_aux(node) == TOK_CALL))
+        return false;
+
+    // Division by zero traps at runtime
+    double divisor = 0;
+    if(node_type(node) == TYPE_OP && node_op(node) == TOK_DIV &&
+       (!is_number_(ctx, node_right(node), &divisor) || is_equal_(divisor, 0)))
+        return false;
+
+    return is_pure_(ctx, node_left(node)) && is_pure_(ctx, node_right(node));
+}
+
+// Backend emits number as it is: ELF as imm32, Processor with "%lg"
+static bool is_representable_(const Fold_context* ctx, double value)
+{
+    if(ctx->mode == TREE_FOLD_INTEGER)
+        return value >= INT32_MIN && value <= INT32_MAX;
+
+    if(!isfinite(value))
+        return false;
+
+    char str[64] = "";
+    snprintf(str, sizeof(str), "%lg", value);
+
+    return is_equal_(strtod(str, nullptr), value);
+}
+
+static bool evaluate_(const Fold_context* ctx, token_operators op, double lhs, double rhs, double* result)
+{
+    assert(result);
+
+    if(ctx->mode == TREE_FOLD_INTEGER)
+    {
+        if(!is_representable_(ctx, lhs) || !is_representable_(ctx, rhs))
+            return false;
+
+        int64_t a = (int64_t) lhs;
+        int64_t b = (int64_t) rhs;
+        int64_t c = 0;
+
+        switch(op)
+        {
+            case TOK_ADD:   c = a + b;  break;
+            case TOK_SUB:   c = a - b;  break;
+            case TOK_MUL:   c = a * b;  break;
+            case TOK_DIV:
+            {
+                if(b == 0)
+                    return false;
+
+                c = a / b;
+                break;
+            }
+            case TOK_EQ:    c = a == b; break;
+            case TOK_NEQ:   c = a != b; break;
+            case TOK_LEQ:   c = a <= b; break;
+            case TOK_GEQ:   c = a >= b; break;
+            case TOK_LESS:  c = a <  b; break;
+            case TOK_GREAT: c = a >  b; break;
+            case TOK_AND:   c = a && b; break;
+            case TOK_OR:    c = a || b; break;
+            // ELF backend has no power operator, its error isn't hidden
+            case TOK_POWER: case TOK_SHIFT: case TOK_NOT:
+            case TOK_LRPAR: case TOK_RRPAR: case TOK_ASSIGN: case TOK_LFPAR: case TOK_RFPAR:
+            case TOK_LQPAR: case TOK_RQPAR: case TOK_COMMA:  case TOK_SEMICOLON:
+            default:
+                return false;
+        }
+
+        *result = (double) c;
+    }
+    else
+    {
+        switch(op)
+        {
+            case TOK_ADD:   *result = lhs + rhs;      break;
+            case TOK_SUB:   *result = lhs - rhs;      break;
+            case TOK_MUL:   *result = lhs * rhs;      break;
+            case TOK_POWER: *result = pow(lhs, rhs);  break;
+            case TOK_DIV:
+            {
+                if(is_equal_(rhs, 0))
+                    return false;
+
+                *result = lhs / rhs;
+                break;
+            }
+            case TOK_EQ:    *result =  is_equal_(lhs, rhs);                 break;
+            case TOK_NEQ:   *result = !is_equal_(lhs, rhs);                 break;
+            case TOK_LEQ:   *result = lhs <= rhs;                           break;
+            case TOK_GEQ:   *result = lhs >= rhs;                           break;
+            case TOK_LESS:  *result = lhs <  rhs;                           break;
+            case TOK_GREAT: *result = lhs >  rhs;                           break;
+            case TOK_AND:   *result = !is_equal_(lhs, 0) && !is_equal_(rhs, 0); break;
+            case TOK_OR:    *result = !is_equal_(lhs, 0) || !is_equal_(rhs, 0); break;
+            case TOK_SHIFT: case TOK_NOT:
+            case TOK_LRPAR: case TOK_RRPAR: case TOK_ASSIGN: case TOK_LFPAR: case TOK_RFPAR:
+            case TOK_LQPAR: case TOK_RQPAR: case TOK_COMMA:  case TOK_SEMICOLON:
+            default:
+                return false;
+        }
+    }
+
+    return is_representable_(ctx, *result);
+}
+
+static void simplify_(const Fold_context* ctx, Node* node)
+{
+    assert(node && node_type(node) == TYPE_OP);
+
+    token_operators op = node_op(node);
+
+    double lhs = 0;
+    double rhs = 0;
+    bool is_lhs = is_number_(ctx, node_left(node),  &lhs);
+    bool is_rhs = is_number_(ctx, node_right(node), &rhs);
+
+    if(op == TOK_NOT)
+    {
+        if(node_left(node) || !is_rhs)
+            return;
+
+        // Operand is truncated to integer before test, as ELF backend does
+        if(ctx->mode == TREE_FOLD_INTEGER)
+        {
+            if(!is_representable_(ctx, rhs))
+                return;
+
+            rhs = (double) (int64_t) rhs;
+        }
+
+        node_set_number(ctx->tree, node, node_right(node), is_equal_(rhs, 0));
+        return;
+    }
+
+    if(!node_left(node) || !node_right(node))
+        return;
+
+    // Folded value takes slot of number operand, so pool of values doesn't grow
+    double result = 0;
+    if(is_lhs && is_rhs && evaluate_(ctx, op, lhs, rhs, &result))
+    {
+        node_set_number(ctx->tree, node, node_left(node), result);
+        return;
+    }
+
+    switch(op)
+    {
+        case TOK_ADD:
+        {
+            if(is_rhs && is_equal_(rhs, 0))
+                node_replace(node, node_left(node));
+            else if(is_lhs && is_equal_(lhs, 0))
+                node_replace(node, node_right(node));
+            break;
+        }
+        case TOK_SUB:
+        {
+            if(is_rhs && is_equal_(rhs, 0))
+                node_replace(node, node_left(node));
+            break;
+        }
+        case TOK_MUL:
+        {
+            if(is_rhs && is_equal_(rhs, 1))
+                node_replace(node, node_left(node));
+            else if(is_lhs && is_equal_(lhs, 1))
+                node_replace(node, node_right(node));
+            else if(is_rhs && is_equal_(rhs, 0) && is_pure_(ctx, node_left(node)))
+                node_set_number(ctx->tree, node, node_right(node), 0);
+            else if(is_lhs && is_equal_(lhs, 0) && is_pure_(ctx, node_right(node)))
+                node_set_number(ctx->tree, node, node_left(node), 0);
+            break;
+        }
+        case TOK_DIV:
+        {
+            if(is_rhs && is_equal_(rhs, 1))
+                node_replace(node, node_left(node));
+            break;
+        }
+        case TOK_EQ:    case TOK_NEQ:   case TOK_LEQ:    case TOK_GEQ:   case TOK_GREAT: case TOK_LESS:
+        case TOK_AND:   case TOK_OR:    case TOK_POWER:  case TOK_SHIFT: case TOK_NOT:
+        case TOK_LRPAR: case TOK_RRPAR: case TOK_ASSIGN: case TOK_LFPAR: case TOK_RFPAR:
+        case TOK_LQPAR: case TOK_RQPAR: case TOK_COMMA:  case TOK_SEMICOLON:
+        default:
+            break;
+    }
+}
+
+static void substitute_(const Fold_context* ctx, Node* node)
+{
+    assert(node && node_type(node) == TYPE_ID);
+
+    for(ptrdiff_t iter = 0; iter < ctx->consts_sz; iter++)
+    {
+        if(strcmp(ctx->consts[iter].name, node_name(ctx->tree, node)) == 0)
+        {
+            node_set_number(ctx->tree, node, node, ctx->consts[iter].value);
+            return;
+        }
+    }
+}
+
+static void fold_(const Fold_context* ctx, Node* node)
+{
+    assert(node);
+
+    // Function header consists of names only
+    if(node_type(node) == TYPE_AUX && node_aux(node) == TOK_FUNCTION)
+        return;
+
+    // Variable being assigned (or shown) and function name stay, only index is folded
+    if((node_type(node) == TYPE_OP && node_op(node) == TOK_ASSIGN) || node_type(node) == TYPE_EMBED ||
+       (node_type(node) == TYPE_AUX && node_aux(node) == TOK_CALL))
+    {
+        if(node_left(node) && node_right(node_left(node)))
+            fold_(ctx, node_right(node_left(node)));
+
+        if(node_right(node))
+            fold_(ctx, node_right(node));
+
+        return;
+    }
+
+    if(node_left(node))
+        fold_(ctx, node_left(node));
+
+    if(node_right(node))
+        fold_(ctx, node_right(node));
+
+    if(node_type(node) == TYPE_ID && !node_left(node) && !node_right(node))
+        substitute_(ctx, node);
+    else if(node_type(node) == TYPE_OP)
+        simplify_(ctx, node);
+}
+
+static tree_err add_const_(Fold_context* ctx, const char* name, double value)
+{
+    if(ctx->consts_sz == ctx->consts_cap)
+    {
+        ptrdiff_t new_cap = ctx->consts_cap ? ctx->consts_cap * 2 : TREE_MIN_CAP;
+
+        Fold_const_* temp = (Fold_const_*) realloc(ctx->consts, (size_t) new_cap * sizeof(Fold_const_));
+        if(!temp)
+            return TREE_BAD_ALLOC;
+
+        ctx->consts     = temp;
+        ctx->consts_cap = new_cap;
+    }
+
+    ctx->consts[ctx->consts_sz] = {name, value};
+    ctx->consts_sz++;
+
+    return TREE_NOERR;
+}
+
+// Folds initializers of globals in order of declaration, so constant can be used in next ones
+static tree_err fold_globals_(Fold_context* ctx, Node* node)
+{
+    assert(node);
+
+    if(node_left(node))
+    {
+        tree_err err = fold_globals_(ctx, node_left(node));
+        if(err)
+            return err;
+    }
+
+    Node* assign = node_right(node);
+    if(!assign || node_type(assign) != TYPE_OP || node_op(assign) != TOK_ASSIGN)
+        return TREE_NOERR;
+
+    fold_(ctx, assign);
+
+    Node* var = node_left(assign);
+    double value = 0;
+
+    if(var && node_type(var) == TYPE_ID && node_left(var) && !node_right(var) &&
+       node_type(node_left(var)) == TYPE_KEYWORD && node_key(node_left(var)) == TOK_CONST &&
+       is_number_(ctx, node_right(assign), &value) && is_representable_(ctx, value))
+    {
+        return add_const_(ctx, node_name(ctx->tree, var), value);
+    }
+
+    return TREE_NOERR;
+}
+
+static void fold_functions_(const Fold_context* ctx, Node* node)
+{
+    assert(node);
+
+    if(node_left(node))
+        fold_functions_(ctx, node_left(node));
+
+    if(node_right(node) && node_type(node_right(node)) == TYPE_AUX && node_aux(node_right(node)) == TOK_DEFINE)
+        fold_(ctx, node_right(node));
+}
+
+tree_err tree_fold(Tree* tree, tree_fold_mode mode)
+{
+    assert(tree);
+
+    if(!tree->root)
+        return TREE_NOERR;
+
+    Fold_context ctx = {};
+    ctx.tree = tree;
+    ctx.mode = mode;
+
+    tree_err err = fold_globals_(&ctx, tree_root(tree));
+    if(!err)
+        fold_functions_(&ctx, tree_root(tree));
+
+    free(ctx.consts);
+
+    return err;
+}
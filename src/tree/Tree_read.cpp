@@ -6,28 +6,23 @@
 #include "Tree.h"
 #include "../common/dumpsystem.h"
 
-static ptrdiff_t clean_whitespaces_(const char data[], ptrdiff_t pos)
+static ptrdiff_t clean_whitespaces_(const char data[], ptrdiff_t data_sz, ptrdiff_t pos)
 {
     assert(data);
 
-    while(isspace(data[pos]))
+    while(pos < data_sz && isspace(data[pos]))
         pos++;
     
     return pos;
 }
 
-static bool get_number(const char data[], double* num, int* n_read)
+// Whether data of 'data_sz' bytes starts with 'name'
+static bool is_prefix_(const char data[], ptrdiff_t data_sz, const char name[], ptrdiff_t name_sz)
 {
-    if(isdigit(*data))
-    {
-        sscanf(data, "%lg%n", num, n_read);
-        return true;
-    }
-
-    return false;
+    return data_sz >= name_sz && memcmp(data, name, (size_t) name_sz) == 0;
 }
 
-static void wordlen_(const char data[], int* n_read)
+static void wordlen_(const char data[], ptrdiff_t data_sz, int* n_read)
 {
     assert(data && n_read);
     assert(*data == '\'');
@@ -35,7 +30,7 @@ static void wordlen_(const char data[], int* n_read)
     (*n_read)++;
 
     int last_quote = 0;
-    while(data[*n_read] != ')' && data[*n_read] != '(' && data[*n_read])
+    while(*n_read < data_sz && data[*n_read] != ')' && data[*n_read] != '(')
     {
         if(data[*n_read] == '\'')
             last_quote = *n_read;
@@ -47,42 +42,42 @@ static void wordlen_(const char data[], int* n_read)
 }
 
 #define DEF_KEY(NAME, STD_NAME, MANGLE)                             \
-    if(strncmp(data + pos, (STD_NAME), sizeof(STD_NAME) - 1) == 0)  \
+    if(is_prefix_(data + pos, data_sz - pos, (STD_NAME), (ptrdiff_t) sizeof(STD_NAME) - 1))  \
     {                                                               \
         tmp.type = TYPE_KEYWORD;                                    \
         tmp.val.key = TOK_##MANGLE;                                 \
         pos += (ptrdiff_t) sizeof(STD_NAME) - 1;                                \
-        PASS$(!token_array_add(tok_arr, &tmp), return TOKEN_BAD_ALLOC; ); \
+        PASS$(!token_array_add(tok_arr, &tmp, tok_start), return TOKEN_BAD_ALLOC; ); \
         continue;                                           \
     }                                                       \
 
 #define DEF_OP(NAME, STD_NAME, MANGLE)                    \
-    if(strncmp(data + pos, (STD_NAME), sizeof(STD_NAME) - 1) == 0)  \
+    if(is_prefix_(data + pos, data_sz - pos, (STD_NAME), (ptrdiff_t) sizeof(STD_NAME) - 1))  \
     {                                                       \
         tmp.type = TYPE_OP;                                 \
         tmp.val.op = TOK_##MANGLE;                          \
         pos += (ptrdiff_t) sizeof(STD_NAME) - 1;                            \
-        PASS$(!token_array_add(tok_arr, &tmp), return TOKEN_BAD_ALLOC; ); \
+        PASS$(!token_array_add(tok_arr, &tmp, tok_start), return TOKEN_BAD_ALLOC; ); \
         continue;                                           \
     }                                                       \
 
 #define DEF_EMB(NAME, STD_NAME, MANGLE)                   \
-    if(strncmp(data + pos, (STD_NAME), sizeof(STD_NAME) - 1) == 0)  \
+    if(is_prefix_(data + pos, data_sz - pos, (STD_NAME), (ptrdiff_t) sizeof(STD_NAME) - 1))  \
     {                                                       \
         tmp.type = TYPE_EMBED;                              \
         tmp.val.emb = TOK_##MANGLE;                         \
         pos += (ptrdiff_t) sizeof(STD_NAME) - 1;                            \
-        PASS$(!token_array_add(tok_arr, &tmp), return TOKEN_BAD_ALLOC; ); \
+        PASS$(!token_array_add(tok_arr, &tmp, tok_start), return TOKEN_BAD_ALLOC; ); \
         continue;                                           \
     }                                                       \
 
 #define DEF_AUX(STD_NAME, MANGLE)                                         \
-    if(strncmp(data + pos, (STD_NAME), sizeof(STD_NAME) - 1) == 0)        \
+    if(is_prefix_(data + pos, data_sz - pos, (STD_NAME), (ptrdiff_t) sizeof(STD_NAME) - 1))        \
     {                                                                     \
         tmp.type = TYPE_AUX;                                              \
         tmp.val.aux = TOK_##MANGLE;                                       \
         pos += (ptrdiff_t) sizeof(STD_NAME) - 1;                                      \
-        PASS$(!token_array_add(tok_arr, &tmp), return TOKEN_BAD_ALLOC; ); \
+        PASS$(!token_array_add(tok_arr, &tmp, tok_start), return TOKEN_BAD_ALLOC; ); \
         continue;                                                         \
     }                                                                     \
 
@@ -96,28 +91,30 @@ static token_err lexer_(Token_array* tok_arr, Token_nametable* tok_table, const
 
     while(true)
     {
-        pos = clean_whitespaces_(data, pos);   
+        pos = clean_whitespaces_(data, data_sz, pos);   
         if(pos == data_sz)
             break;
         
+        ptrdiff_t tok_start = pos;
         int n_read = 0;
         tmp = {};
 
-        if(get_number(data + pos, &tmp.val.num, &n_read))
+        ptrdiff_t num_len = token_number(data + pos, data_sz - pos, &tmp.val.num);
+        if(num_len)
         {
             tmp.type = TYPE_NUMBER;
-            PASS$(!token_array_add(tok_arr, &tmp), return TOKEN_BAD_ALLOC; );
+            PASS$(!token_array_add(tok_arr, &tmp, tok_start), return TOKEN_BAD_ALLOC; );
 
-            pos += n_read;
+            pos += num_len;
             continue;
         }
         if(data[pos] == '\'')
         {
-            wordlen_(data + pos, &n_read);
+            wordlen_(data + pos, data_sz - pos, &n_read);
 
             tmp.type = TYPE_ID;
             PASS$(!token_nametable_add(tok_table, &tmp.val.name, data + pos + 1, n_read - 2), return TOKEN_BAD_ALLOC; );
-            PASS$(!token_array_add(tok_arr, &tmp), return TOKEN_BAD_ALLOC; );
+            PASS$(!token_array_add(tok_arr, &tmp, tok_start), return TOKEN_BAD_ALLOC; );
 
             pos += n_read;
             continue;
@@ -133,7 +130,7 @@ static token_err lexer_(Token_array* tok_arr, Token_nametable* tok_table, const
 
     tok_arr->eof = tok_arr->size;
     tmp.type = TYPE_EOF;
-    PASS$(!token_array_add(tok_arr, &tmp), return TOKEN_BAD_ALLOC; );
+    PASS$(!token_array_add(tok_arr, &tmp, pos), return TOKEN_BAD_ALLOC; );
 
     return TOKEN_NOERR;
 }
@@ -147,7 +144,7 @@ static void consume(Token* tok, Token_array* tok_arr)
     assert(tok);
     assert(tok_arr->pos <= tok_arr->eof);
 
-    *tok = tok_arr->data[tok_arr->pos];
+    *tok = token_array_get(tok_arr, tok_arr->pos);
     tok_arr->pos++;
 }
 
@@ -157,21 +154,23 @@ static void peek(Token* tok, ptrdiff_t offset, Token_array* tok_arr)
 
     if(tok_arr->pos + offset < 0 || tok_arr->pos + offset > tok_arr->eof)
     {
-        *tok = tok_arr->data[tok_arr->eof];
+        *tok = token_array_get(tok_arr, tok_arr->eof);
         
         return;
     }
 
-    *tok = tok_arr->data[tok_arr->pos + offset];
+    *tok = token_array_get(tok_arr, tok_arr->pos + offset);
 }
 
 #define format_error(TOK) ASSERT$(0, Tree read: wrong format, return TREE_FORMAT_ERROR; )
 
-static tree_err read_node_(Node** base, Tree* tree, Token_array* tok_arr)
+static tree_err read_node_(ptrdiff_t* base, Tree* tree, Token_array* tok_arr)
 {
     assert(base);
     
     Token tok = {};
+    ptrdiff_t left  = 0;
+    ptrdiff_t right = 0;
 
     consume(&tok, tok_arr);
     if(tok.type != TYPE_OP || tok.val.op != TOK_LRPAR)
@@ -179,22 +178,26 @@ static tree_err read_node_(Node** base, Tree* tree, Token_array* tok_arr)
     
     peek(&tok, 0, tok_arr);
     if(tok.type == TYPE_OP && tok.val.op == TOK_LRPAR)
-        PASS$(!read_node_(base, tree, tok_arr), return TREE_BAD_ALLOC; );
+        PASS$(!read_node_(&left, tree, tok_arr), return TREE_BAD_ALLOC; );
     
     consume(&tok, tok_arr);
+    if(tok.type == TYPE_EOF || tok.type == TYPE_NOTYPE)
+        format_error(&tok);
 
-    Node* tmp = *base;
     PASS$(!tree_add(tree, base, &tok), return TREE_BAD_ALLOC; );
-    (*base)->left = tmp;
 
     peek(&tok, 0, tok_arr);
     if(tok.type == TYPE_OP && tok.val.op == TOK_LRPAR)
-        PASS$(!read_node_(&(*base)->right, tree, tok_arr), return TREE_BAD_ALLOC; );
+        PASS$(!read_node_(&right, tree, tok_arr), return TREE_BAD_ALLOC; );
     
     consume(&tok, tok_arr);
     if(tok.type != TYPE_OP || tok.val.op != TOK_RRPAR)
         format_error(&tok);
 
+    Node* node = tree_node(tree, *base);
+    node_set_left (node, tree_node(tree, left));
+    node_set_right(node, tree_node(tree, right));
+
     return TREE_NOERR;
 }
 
@@ -202,6 +205,14 @@ tree_err tree_read(Tree* tree, Token_nametable* tok_table, const char data[], pt
 {
     assert(tree && tok_table && data);
 
+    if(tree_is_binary(data, data_sz))
+    {
+        tree_err tree_error = tree_read_binary(tree, data, data_sz);
+        PASS$(!tree_error, return tree_error; );
+
+        return TREE_NOERR;
+    }
+
     Token_array tok_arr = {};
 
     token_err token_error = lexer_(&tok_arr, tok_table, data, data_sz);
@@ -5,51 +5,44 @@
 
 #define PRINT(format, ...) fprintf(stream, format, ##__VA_ARGS__)
 
-static void tree_print_node_(Node* node, FILE* stream)
+// Depth is number of enclosing definitions and compound statements, used for indentation
+static void tree_print_node_(const Tree* tree, const Node* node, FILE* stream, int depth)
 {
     assert(stream);
 
-    static int depth = 0;
-    bool depth_rised = false;
+    Token tok = node_token(tree, node);
 
-    if(node->tok.type == TYPE_KEYWORD)
+    if(tok.type == TYPE_KEYWORD)
     {
-        if(node->tok.val.key == TOK_IF || node->tok.val.key == TOK_WHILE)
-        {
+        if(tok.val.key == TOK_IF || tok.val.key == TOK_WHILE)
             depth++;
-            depth_rised = true;
-        }
     }
-    else if (node->tok.type == TYPE_AUX && node->tok.val.aux == TOK_DEFINE)
+    else if (tok.type == TYPE_AUX && tok.val.aux == TOK_DEFINE)
     {
         depth++;
-        depth_rised = true;
     }
 
     PRINT("(");
 
-    if(node->left)
-        tree_print_node_(node->left, stream);
+    if(node_left(node))
+        tree_print_node_(tree, node_left(node), stream, depth);
 
-    if(node->tok.type == TYPE_ID)
-        PRINT("\'%s\'", std_demangle(&node->tok));
-    else if(node->tok.type == TYPE_AUX && (node->tok.val.aux == TOK_STATEMENT || node->tok.val.aux == TOK_DECISION))
-        PRINT("\n%*s%s", depth * 4, "", std_demangle(&node->tok));
+    if(tok.type == TYPE_ID)
+        PRINT("\'%s\'", std_demangle(&tok));
+    else if(tok.type == TYPE_AUX && (tok.val.aux == TOK_STATEMENT || tok.val.aux == TOK_DECISION))
+        PRINT("\n%*s%s", depth * 4, "", std_demangle(&tok));
     else
-        PRINT("%s", std_demangle(&node->tok));
+        PRINT("%s", std_demangle(&tok));
 
-    if(node->right)
-        tree_print_node_(node->right, stream);
+    if(node_right(node))
+        tree_print_node_(tree, node_right(node), stream, depth);
     
     PRINT(")");
-
-    if(depth_rised)
-        depth--;
 }
 
 void tree_write(Tree* tree, FILE* ostream)
 {
     assert(ostream);
 
-    tree_print_node_(tree->root, ostream);
+    tree_print_node_(tree, tree_root(tree), ostream, 0);
 }